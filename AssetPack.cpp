@@ -0,0 +1,216 @@
+#include "AssetPack.h"
+
+#include <limits.h>
+#include <stdio.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Rounds up to the next multiple of ASSET_PACK_ALIGN
+static Uint64 alignOffset(Uint64 offset)
+{
+    return (offset+ASSET_PACK_ALIGN-1)/ASSET_PACK_ALIGN*ASSET_PACK_ALIGN;
+}
+
+bool writeAssetPack(const char *path, const std::vector<const char*> &names, const std::vector<SDL_Surface*> &surfaces)
+{
+    if (names.size() != surfaces.size()) { return false; }
+
+    // Builds the index
+    AssetPackHeader header;
+    memcpy(header.magic, ASSET_PACK_MAGIC, sizeof(header.magic));
+    header.version = ASSET_PACK_VERSION;
+    header.entryCount = (Uint32)names.size();
+    header.reserved = 0;
+
+    std::vector<AssetPackEntry> entries(names.size());
+    Uint64 offset = alignOffset(sizeof(AssetPackHeader)+sizeof(AssetPackEntry)*entries.size());
+    for (size_t i = 0; i < names.size(); i++) {
+        SDL_Surface *surface = surfaces[i];
+        if (strlen(names[i]) >= (size_t)ASSET_PACK_NAME_LENGTH) {
+            printf("Asset name too long for pack: %s\n", names[i]);
+            return false;
+        }
+        if (surface->format->format != SDL_PIXELFORMAT_RGBA32) {
+            printf("Asset %s is not RGBA32.\n", names[i]);
+            return false;
+        }
+        memset(&entries[i], 0, sizeof(AssetPackEntry));
+        strcpy(entries[i].name, names[i]);
+        entries[i].width = surface->w;
+        entries[i].height = surface->h;
+        entries[i].pitch = surface->w*4;
+        entries[i].offset = offset;
+        entries[i].size = (Uint64)entries[i].pitch*surface->h;
+        offset = alignOffset(offset+entries[i].size);
+    }
+
+    FILE *file = fopen(path, "wb");
+    if (!file) {
+        printf("Unable to open %s for writing.\n", path);
+        return false;
+    }
+
+    bool success = fwrite(&header, sizeof(header), 1, file) == 1;
+    if (success && !entries.empty()) {
+        success = fwrite(&entries[0], sizeof(AssetPackEntry), entries.size(), file) == entries.size();
+    }
+
+    // Pixel rows (tightly packed, padding between images)
+    for (size_t i = 0; i < entries.size() && success; i++) {
+        success = fseek(file, (long)entries[i].offset, SEEK_SET) == 0;
+        SDL_Surface *surface = surfaces[i];
+        SDL_LockSurface(surface);
+        for (int y = 0; y < surface->h && success; y++) {
+            success = fwrite((Uint8*)surface->pixels + y*surface->pitch, entries[i].pitch, 1, file) == 1;
+        }
+        SDL_UnlockSurface(surface);
+    }
+
+    // Pads the end so the last image is a whole aligned block
+    if (success && offset > 0) {
+        success = fseek(file, (long)offset-1, SEEK_SET) == 0 && fputc(0, file) != EOF;
+    }
+
+    if (fclose(file) != 0) { success = false; }
+    if (!success) {
+        printf("Unable to write %s.\n", path);
+    }
+    return success;
+}
+
+AssetPack::AssetPack()
+{
+    mData = NULL;
+    mSize = 0;
+    mHeader = NULL;
+    mEntries = NULL;
+    #ifdef _WIN32
+    mFile = INVALID_HANDLE_VALUE;
+    mMapping = NULL;
+    #else
+    mFile = -1;
+    #endif
+}
+
+AssetPack::~AssetPack()
+{
+    close();
+}
+
+bool AssetPack::open(const char *path)
+{
+    close();
+
+    // Maps the whole file read-only
+    #ifdef _WIN32
+    mFile = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (mFile == INVALID_HANDLE_VALUE) { return false; }
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx((HANDLE)mFile, &fileSize)) { close(); return false; }
+    mSize = (size_t)fileSize.QuadPart;
+    mMapping = CreateFileMappingA((HANDLE)mFile, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (!mMapping) { close(); return false; }
+    mData = (const Uint8*)MapViewOfFile((HANDLE)mMapping, FILE_MAP_READ, 0, 0, 0);
+    if (!mData) { close(); return false; }
+    #else
+    mFile = ::open(path, O_RDONLY);
+    if (mFile < 0) { return false; }
+    struct stat info;
+    if (fstat(mFile, &info) != 0) { close(); return false; }
+    mSize = (size_t)info.st_size;
+    if (mSize == 0) { close(); return false; }
+    void *data = mmap(NULL, mSize, PROT_READ, MAP_PRIVATE, mFile, 0);
+    if (data == MAP_FAILED) { close(); return false; }
+    mData = (const Uint8*)data;
+    #endif
+
+    // Checks the header and that every image lies inside the file
+    if (mSize < sizeof(AssetPackHeader)) {
+        printf("Asset pack %s is truncated.\n", path);
+        close();
+        return false;
+    }
+    mHeader = (const AssetPackHeader*)mData;
+    if (memcmp(mHeader->magic, ASSET_PACK_MAGIC, sizeof(mHeader->magic)) != 0 || mHeader->version != ASSET_PACK_VERSION) {
+        printf("Asset pack %s has the wrong format or version.\n", path);
+        close();
+        return false;
+    }
+    if (sizeof(AssetPackHeader)+(Uint64)sizeof(AssetPackEntry)*mHeader->entryCount > mSize) {
+        printf("Asset pack %s is truncated.\n", path);
+        close();
+        return false;
+    }
+    mEntries = (const AssetPackEntry*)(mData+sizeof(AssetPackHeader));
+    for (Uint32 i = 0; i < mHeader->entryCount; i++) {
+        const AssetPackEntry &entry = mEntries[i];
+
+        // Nothing here can wrap: offset and size are checked without adding them, and the products are
+        // taken in 64 bits. Sizes also have to fit the ints SDL takes
+        bool inside = entry.offset <= mSize && entry.size <= mSize-entry.offset;
+        bool sized = entry.pitch <= INT_MAX && entry.height <= INT_MAX && entry.pitch >= (Uint64)entry.width*4 &&
+                     entry.size >= (Uint64)entry.pitch*entry.height;
+        if (!inside || !sized || entry.name[ASSET_PACK_NAME_LENGTH-1] != '\0') {
+            printf("Asset pack %s has a bad entry.\n", path);
+            close();
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void AssetPack::close()
+{
+    #ifdef _WIN32
+    if (mData) { UnmapViewOfFile(mData); }
+    if (mMapping) { CloseHandle((HANDLE)mMapping); }
+    if (mFile != INVALID_HANDLE_VALUE) { CloseHandle((HANDLE)mFile); }
+    mMapping = NULL;
+    mFile = INVALID_HANDLE_VALUE;
+    #else
+    if (mData) { munmap((void*)mData, mSize); }
+    if (mFile >= 0) { ::close(mFile); }
+    mFile = -1;
+    #endif
+    mData = NULL;
+    mSize = 0;
+    mHeader = NULL;
+    mEntries = NULL;
+}
+
+const AssetPackEntry *AssetPack::find(const char *name)
+{
+    if (!mHeader) { return NULL; }
+    for (Uint32 i = 0; i < mHeader->entryCount; i++) {
+        if (strcmp(mEntries[i].name, name) == 0) {
+            return &mEntries[i];
+        }
+    }
+    return NULL;
+}
+
+SDL_Surface *AssetPack::createSurface(const char *name)
+{
+    const AssetPackEntry *entry = find(name);
+    if (!entry) { return NULL; }
+
+    // SDL only reads these pixels (blit source / texture upload), the mapping stays read-only
+    SDL_Surface *surface = SDL_CreateRGBSurfaceWithFormatFrom((void*)(mData+entry->offset), entry->width, entry->height, 32, entry->pitch, SDL_PIXELFORMAT_RGBA32);
+    if (!surface) {
+        printf("Unable to wrap packed image %s. SDL Error: %s\n", name, SDL_GetError());
+        return NULL;
+    }
+
+    // Copies pixels as-is when blitted (same as loadKeyedImage)
+    SDL_SetSurfaceBlendMode(surface, SDL_BLENDMODE_NONE);
+    return surface;
+}
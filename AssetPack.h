@@ -0,0 +1,77 @@
+#ifndef ASSET_PACK_H
+#define ASSET_PACK_H
+
+#include <SDL.h>
+#include <vector>
+
+// Pack file layout (little-endian, written and read on the same kind of machine):
+//   AssetPackHeader, then entryCount AssetPackEntry records, then pixel data
+// Pixels are RGBA32 with the color key already turned into alpha, each image
+// starting on an ASSET_PACK_ALIGN byte boundary
+const char ASSET_PACK_MAGIC[4] = {'S', 'C', 'P', 'K'};
+const Uint32 ASSET_PACK_VERSION = 1;
+const Uint32 ASSET_PACK_ALIGN = 64;
+const int ASSET_PACK_NAME_LENGTH = 64;
+
+struct AssetPackHeader
+{
+    char magic[4];
+    Uint32 version;
+    Uint32 entryCount;
+    Uint32 reserved;
+};
+
+struct AssetPackEntry
+{
+    // Path the game asks for, e.g. "DS_Game/fighterspr.png"
+    char name[ASSET_PACK_NAME_LENGTH];
+    Uint32 width;
+    Uint32 height;
+    Uint32 pitch;
+    Uint32 reserved;
+    Uint64 offset;
+    Uint64 size;
+};
+
+// Writes images (RGBA32 surfaces, e.g. from loadKeyedImage) to a pack file
+bool writeAssetPack(const char *path, const std::vector<const char*> &names, const std::vector<SDL_Surface*> &surfaces);
+
+// Read-only view of a pack file mapped into memory
+class AssetPack
+{
+    public:
+        // Initialization
+        AssetPack();
+
+        // Unmaps the file
+        ~AssetPack();
+
+        // Maps a pack file and checks its index, returns false if it's missing or invalid
+        bool open(const char *path);
+
+        // Unmaps the file (surfaces from createSurface() must be freed first)
+        void close();
+
+        // Finds an image by name, NULL if it isn't in the pack
+        const AssetPackEntry *find(const char *name);
+
+        // Wraps a packed image in a surface pointing straight at the mapped pixels
+        // (no copy; NULL if it isn't in the pack)
+        SDL_Surface *createSurface(const char *name);
+
+    private:
+        const Uint8 *mData;
+        size_t mSize;
+        const AssetPackHeader *mHeader;
+        const AssetPackEntry *mEntries;
+
+        // Platform mapping handles
+        #ifdef _WIN32
+        void *mFile;
+        void *mMapping;
+        #else
+        int mFile;
+        #endif
+};
+
+#endif
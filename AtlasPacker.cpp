@@ -0,0 +1,71 @@
+#include "AtlasPacker.h"
+
+#include <algorithm>
+
+// A horizontal strip of a page, as tall as the first (tallest) rect put on it
+struct Shelf
+{
+    int page;
+    int y;
+    int height;
+    int usedWidth;
+};
+
+// Sorts rect indices tallest first (wider first on ties)
+struct TallerFirst
+{
+    const std::vector<PackRect> *rects;
+
+    bool operator() (int a, int b) const
+    {
+        if ((*rects)[a].h != (*rects)[b].h) { return (*rects)[a].h > (*rects)[b].h; }
+        return (*rects)[a].w > (*rects)[b].w;
+    }
+};
+
+int packRects(std::vector<PackRect> &rects, int pageWidth, int pageHeight, int padding)
+{
+    std::vector<int> order(rects.size());
+    for (size_t i = 0; i < rects.size(); i++) { order[i] = (int)i; }
+    TallerFirst cmp = {&rects};
+    std::stable_sort(order.begin(), order.end(), cmp);
+
+    std::vector<Shelf> shelves;
+    // Height used on each page so far
+    std::vector<int> pageUsed;
+
+    for (size_t n = 0; n < order.size(); n++) {
+        PackRect &rect = rects[order[n]];
+        int w = rect.w+padding;
+        int h = rect.h+padding;
+        if (w > pageWidth || h > pageHeight) { return -1; }
+
+        // First shelf with room
+        bool placed = false;
+        for (size_t s = 0; s < shelves.size() && !placed; s++) {
+            if (h <= shelves[s].height && shelves[s].usedWidth+w <= pageWidth) {
+                rect.page = shelves[s].page;
+                rect.x = shelves[s].usedWidth;
+                rect.y = shelves[s].y;
+                shelves[s].usedWidth += w;
+                placed = true;
+            }
+        }
+        if (placed) { continue; }
+
+        // Otherwise opens a new shelf on the first page with height left
+        int page = 0;
+        while (page < (int)pageUsed.size() && pageUsed[page]+h > pageHeight) { page++; }
+        if (page == (int)pageUsed.size()) { pageUsed.push_back(0); }
+
+        Shelf shelf = {page, pageUsed[page], h, w};
+        shelves.push_back(shelf);
+        pageUsed[page] += h;
+
+        rect.page = page;
+        rect.x = 0;
+        rect.y = shelf.y;
+    }
+
+    return (int)pageUsed.size();
+}
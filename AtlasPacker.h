@@ -0,0 +1,21 @@
+#ifndef ATLAS_PACKER_H
+#define ATLAS_PACKER_H
+
+#include <vector>
+
+// One rectangle to place in an atlas (w/h in, x/y/page out)
+struct PackRect
+{
+    int w;
+    int h;
+    int x;
+    int y;
+    int page;
+};
+
+// Places rects on as few pageWidth x pageHeight pages as it can
+// Shelf packing, tallest first, with padding pixels between neighbours
+// Returns the number of pages used, or -1 if a rect can't fit on any page
+int packRects(std::vector<PackRect> &rects, int pageWidth, int pageHeight, int padding);
+
+#endif
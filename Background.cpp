@@ -0,0 +1,198 @@
+#include "Background.h"
+
+#include <stdio.h>
+
+#include "DirtyRects.h"
+#include "LTexture.h"
+
+int moveBackground(int by1, int by2, int bs, int backgroundHeight, int screenHeight)
+{
+    if (by1+bs < screenHeight) {
+        by1+=bs;
+    } else {
+        by1 = by2-backgroundHeight+bs;
+    }
+
+    return by1;
+}
+
+TileCache::TileCache(int slots) : mTiles(slots), mLastUse(slots)
+{
+    clear();
+}
+
+void TileCache::clear()
+{
+    for (size_t i = 0; i < mTiles.size(); i++) {
+        mTiles[i] = -1;
+        mLastUse[i] = 0;
+    }
+    mClock = 0;
+}
+
+int TileCache::find(int tile)
+{
+    for (size_t i = 0; i < mTiles.size(); i++) {
+        if (mTiles[i] == tile) {
+            mLastUse[i] = ++mClock;
+            return (int)i;
+        }
+    }
+    return -1;
+}
+
+int TileCache::insert(int tile)
+{
+    // Empty slots have never been used, so they come out oldest
+    int slot = 0;
+    for (size_t i = 1; i < mTiles.size(); i++) {
+        if (mLastUse[i] < mLastUse[slot])
+            slot = (int)i;
+    }
+    mTiles[slot] = tile;
+    mLastUse[slot] = ++mClock;
+    return slot;
+}
+
+int TileCache::getTile(int slot) { return mTiles[slot]; }
+
+int TileCache::getSlotCount() { return (int)mTiles.size(); }
+
+ScrollingBackground::ScrollingBackground()
+{
+    mSource = NULL;
+    mWidth = 0;
+    mHeight = 0;
+    mTileCount = 0;
+    mUploads = 0;
+}
+
+ScrollingBackground::~ScrollingBackground() { free(); }
+
+bool ScrollingBackground::load(SDL_Surface *source)
+{
+    free();
+    if (!source) { return false; }
+
+    // Tiles upload straight from the source rows, so they have to be in the texture format
+    if (source->format->format != SDL_PIXELFORMAT_RGBA32) {
+        SDL_Surface *converted = SDL_ConvertSurfaceFormat(source, SDL_PIXELFORMAT_RGBA32, 0);
+        SDL_FreeSurface(source);
+        if (!converted) {
+            printf("Unable to convert background. SDL Error: %s\n", SDL_GetError());
+            return false;
+        }
+        source = converted;
+    }
+    mSource = source;
+    mWidth = source->w;
+    mHeight = source->h;
+    mTileCount = (mHeight+BACKGROUND_TILE_HEIGHT-1)/BACKGROUND_TILE_HEIGHT;
+
+    // Never more textures than tiles (a short image just stays resident)
+    int slots = mTileCount < BACKGROUND_CACHE_TILES ? mTileCount : BACKGROUND_CACHE_TILES;
+    mCache = TileCache(slots);
+    for (int i = 0; i < slots; i++) {
+        SDL_Texture *texture = SDL_CreateTexture(gRenderer, SDL_PIXELFORMAT_RGBA32, SDL_TEXTUREACCESS_STATIC, mWidth, BACKGROUND_TILE_HEIGHT);
+        if (!texture) {
+            printf("Unable to create background tile. SDL Error: %s\n", SDL_GetError());
+            free();
+            return false;
+        }
+        SDL_SetTextureBlendMode(texture, SDL_BLENDMODE_BLEND);
+        mTextures.push_back(texture);
+    }
+
+    return true;
+}
+
+void ScrollingBackground::free()
+{
+    for (size_t i = 0; i < mTextures.size(); i++) {
+        SDL_DestroyTexture(mTextures[i]);
+    }
+    mTextures.clear();
+    mCache = TileCache(0);
+
+    SDL_FreeSurface(mSource);
+    mSource = NULL;
+    mWidth = 0;
+    mHeight = 0;
+    mTileCount = 0;
+    mUploads = 0;
+}
+
+void ScrollingBackground::render(int y, int screenHeight)
+{
+    if (mTextures.empty() || y >= screenHeight) { return; }
+
+    // Tiles overlapping rows 0 to screenHeight-1
+    int first = y < 0 ? -y/BACKGROUND_TILE_HEIGHT : 0;
+    int last = (screenHeight-1-y)/BACKGROUND_TILE_HEIGHT;
+    if (last >= mTileCount) { last = mTileCount-1; }
+
+    for (int tile = first; tile <= last; tile++) {
+        int rows = tileRows(tile);
+        SDL_Rect source = {0, 0, mWidth, rows};
+        SDL_Rect dest = {0, y+tile*BACKGROUND_TILE_HEIGHT, mWidth, rows};
+
+        // Slots get reused, so partial redraws tell tiles apart by image and tile number
+        if (gDirty.isRecording()) {
+            SDL_Color modulation = {0xFF, 0xFF, 0xFF, 0xFF};
+            gDirty.record(dest, mixKey(mixKey(drawKey(NULL, source, modulation), (int)(size_t)mSource), tile));
+            continue;
+        }
+
+        int slot = slotFor(tile);
+        if (slot < 0) { continue; }
+        SDL_RenderCopy(gRenderer, mTextures[slot], &source, &dest);
+        gDrawCalls++;
+    }
+}
+
+void ScrollingBackground::prefetch(int y, int lookahead)
+{
+    // The copy scrolls down, so the next tiles in are the ones in the lookahead rows above the screen
+    if (mTextures.empty() || y >= 0 || lookahead <= 0) { return; }
+
+    int first = -lookahead-y < 0 ? 0 : (-lookahead-y)/BACKGROUND_TILE_HEIGHT;
+    int last = (-1-y)/BACKGROUND_TILE_HEIGHT;
+    if (last >= mTileCount) { last = mTileCount-1; }
+
+    // Nearest the screen first
+    for (int tile = last; tile >= first; tile--) {
+        if (mCache.find(tile) < 0) {
+            slotFor(tile);
+            return;
+        }
+    }
+}
+
+int ScrollingBackground::getWidth() { return mWidth; }
+
+int ScrollingBackground::getHeight() { return mHeight; }
+
+int ScrollingBackground::getUploads() { return mUploads; }
+
+int ScrollingBackground::slotFor(int tile)
+{
+    int slot = mCache.find(tile);
+    if (slot >= 0) { return slot; }
+
+    slot = mCache.insert(tile);
+    SDL_Rect rows = {0, 0, mWidth, tileRows(tile)};
+    const Uint8 *pixels = (const Uint8*)mSource->pixels+tile*BACKGROUND_TILE_HEIGHT*mSource->pitch;
+    if (SDL_UpdateTexture(mTextures[slot], &rows, pixels, mSource->pitch) < 0) {
+        printf("Unable to upload background tile. SDL Error: %s\n", SDL_GetError());
+        mCache.clear();
+        return -1;
+    }
+    mUploads++;
+    return slot;
+}
+
+int ScrollingBackground::tileRows(int tile)
+{
+    int rows = mHeight-tile*BACKGROUND_TILE_HEIGHT;
+    return rows < BACKGROUND_TILE_HEIGHT ? rows : BACKGROUND_TILE_HEIGHT;
+}
@@ -0,0 +1,100 @@
+#ifndef BACKGROUND_H
+#define BACKGROUND_H
+
+#include <SDL.h>
+#include <vector>
+
+// Scrolls one of the two stacked background copies down by bs pixels
+// by1 is the copy being moved, by2 the other one; once by1 reaches the bottom of
+// the screen it wraps to sit right above by2. Returns by1's new y
+int moveBackground(int by1, int by2, int bs, int backgroundHeight, int screenHeight);
+
+// Rows of the background image in one tile (each tile is one texture)
+const int BACKGROUND_TILE_HEIGHT = 256;
+
+// Tile textures kept at once: enough for a screen plus the seam between copies and prefetched tiles
+const int BACKGROUND_CACHE_TILES = 6;
+
+// How far above the screen tiles get uploaded before they scroll into view
+const int BACKGROUND_PREFETCH_ROWS = BACKGROUND_TILE_HEIGHT;
+
+// Which tile sits in each of a fixed number of slots, evicting the least recently used
+class TileCache
+{
+    public:
+        // Initialization
+        TileCache(int slots = BACKGROUND_CACHE_TILES);
+
+        // Empties every slot
+        void clear();
+
+        // Gets the slot holding tile and marks it used (-1 if it isn't cached)
+        int find(int tile);
+
+        // Gives tile a slot (an empty one, or else the least recently used) and marks it used
+        int insert(int tile);
+
+        // Gets the tile in a slot (-1 if empty)
+        int getTile(int slot);
+
+        // Gets how many slots there are
+        int getSlotCount();
+
+    private:
+        std::vector<int> mTiles;
+        std::vector<unsigned int> mLastUse;
+        unsigned int mClock;
+};
+
+// A tall background image drawn in BACKGROUND_TILE_HEIGHT strips
+// Only strips on the screen (or about to scroll onto it) have textures. They're uploaded
+// from the source image into a fixed set of cached textures as needed, so the video memory
+// used is the same however tall the image is
+class ScrollingBackground
+{
+    public:
+        // Initialization
+        ScrollingBackground();
+
+        // Deallocation
+        ~ScrollingBackground();
+
+        // Takes ownership of the source image and creates the tile textures (needs gRenderer)
+        // Packed images point into the asset pack, which has to stay open until free()
+        bool load(SDL_Surface *source);
+
+        // Frees the textures and the source image
+        void free();
+
+        // Draws the tiles of a copy of the image (top edge at y) that land on rows 0 to screenHeight-1
+        void render(int y, int screenHeight);
+
+        // Uploads the first uncached tile of a copy that scrolls into view within lookahead rows
+        // At most one per call, so streaming never stalls a frame for long
+        void prefetch(int y, int lookahead = BACKGROUND_PREFETCH_ROWS);
+
+        // Gets image dimensions
+        int getWidth();
+        int getHeight();
+
+        // Gets how many tiles have been uploaded since load()
+        int getUploads();
+
+    private:
+        // Gets the slot holding tile, uploading it first if it isn't cached (-1 if that fails)
+        int slotFor(int tile);
+
+        // Rows in a tile (the last one can be short)
+        int tileRows(int tile);
+
+        SDL_Surface *mSource;
+        std::vector<SDL_Texture*> mTextures;
+        TileCache mCache;
+
+        int mWidth;
+        int mHeight;
+        int mTileCount;
+        int mUploads;
+};
+
+#endif
@@ -0,0 +1,740 @@
+#include <SDL.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+#include "Background.h"
+#include "Collision.h"
+#include "DirtyRects.h"
+#include "Enemies.h"
+#include "JobSystem.h"
+#include "LTexture.h"
+#include "ProjectileKernel.h"
+#include "Projectiles.h"
+#include "Random.h"
+
+// Microbenchmarks for the game's hot paths, results are printed as JSON
+// Usage (from the repo root): Benchmarks [--out results.json] [--quick]
+
+// Play area the benchmarks run in (same as the game window)
+const int WORLD_WIDTH = 480;
+const int WORLD_HEIGHT = 640;
+
+// Each benchmark repeats until it has run this long and at least MIN_REPS times
+double gMinSeconds = 0.25;
+const int MIN_REPS = 5;
+const int MAX_REPS = 100000;
+
+// One benchmark's numbers, times are per operation
+struct BenchResult
+{
+    std::string name;
+    // Extra JSON members describing the problem size
+    std::string params;
+    int ops;
+    int reps;
+    double medianNs;
+    double minNs;
+};
+
+std::vector<BenchResult> gResults;
+
+// Runs body (which does ops operations) until the time budget is spent and records the result
+typedef void (*BenchBody)(void *context);
+
+void runBench(const char *name, const std::string &params, int ops, BenchBody body, void *context)
+{
+    Uint64 frequency = SDL_GetPerformanceFrequency();
+
+    // Warm up caches and lazy allocations first
+    body(context);
+
+    std::vector<double> samples;
+    Uint64 started = SDL_GetPerformanceCounter();
+    while ((int)samples.size() < MIN_REPS ||
+           ((int)samples.size() < MAX_REPS && (SDL_GetPerformanceCounter()-started) < gMinSeconds*frequency)) {
+        Uint64 before = SDL_GetPerformanceCounter();
+        body(context);
+        Uint64 after = SDL_GetPerformanceCounter();
+        samples.push_back((after-before)*1e9/frequency/ops);
+    }
+    std::sort(samples.begin(), samples.end());
+
+    BenchResult result = {name, params, ops, (int)samples.size(), samples[samples.size()/2], samples[0]};
+    gResults.push_back(result);
+    fprintf(stderr, "%-28s %-36s %10.2f ns/op\n", name, params.c_str(), result.medianNs);
+}
+
+std::string intParam(const char *key, int value)
+{
+    char text[64];
+    snprintf(text, sizeof(text), "\"%s\": %d", key, value);
+    return text;
+}
+
+std::string stringParam(const char *key, const char *value)
+{
+    return std::string("\"")+key+"\": \""+value+"\"";
+}
+
+// Projectile add/remove (what addNode/delNode/clrList used to be)
+struct PoolBench
+{
+    ProjectilePool pool;
+    // Packed index to remove at each step, always below the live count at that point
+    std::vector<int> removeOrder;
+};
+
+void benchSpawnRemove(void *context)
+{
+    PoolBench &bench = *(PoolBench*)context;
+    int capacity = bench.pool.capacity();
+    for (int i = 0; i < capacity; i++) {
+        bench.pool.spawn(i % WORLD_WIDTH, i % WORLD_HEIGHT);
+    }
+    for (int i = 0; i < capacity; i++) {
+        bench.pool.removeAt(bench.removeOrder[i]);
+    }
+}
+
+void benchSpawnClear(void *context)
+{
+    PoolBench &bench = *(PoolBench*)context;
+    int capacity = bench.pool.capacity();
+    for (int i = 0; i < capacity; i++) {
+        bench.pool.spawn(i % WORLD_WIDTH, i % WORLD_HEIGHT);
+    }
+    bench.pool.clear();
+}
+
+void runPoolBenches()
+{
+    PoolBench bench;
+    int capacity = bench.pool.capacity();
+    for (int i = 0; i < capacity; i++) {
+        bench.removeOrder.push_back(rand() % (capacity-i));
+    }
+
+    runBench("projectile_spawn_remove", intParam("count", capacity), capacity*2, benchSpawnRemove, &bench);
+    runBench("projectile_spawn_clear", intParam("count", capacity), capacity, benchSpawnClear, &bench);
+}
+
+// Projectile movement and culling through the kernel
+struct KernelBench
+{
+    std::vector<int> posX;
+    std::vector<int> posY;
+    std::vector<int> velX;
+    std::vector<int> velY;
+    std::vector<unsigned char> kill;
+    CollisionBox bounds;
+    SimdPath path;
+};
+
+void fillKernelBench(KernelBench &bench, int count)
+{
+    bench.posX.resize(count);
+    bench.posY.resize(count);
+    bench.velX.resize(count);
+    bench.velY.resize(count);
+    bench.kill.resize(count);
+    for (int i = 0; i < count; i++) {
+        // Some start outside so both kill outcomes show up
+        bench.posX[i] = rand() % (WORLD_WIDTH+64)-32;
+        bench.posY[i] = rand() % (WORLD_HEIGHT+64)-32;
+        // Velocities flip sign each element so positions don't drift away over many reps
+        bench.velX[i] = (i & 1) ? 3 : -3;
+        bench.velY[i] = (i & 2) ? 12 : -12;
+    }
+    CollisionBox bounds = {0, 0, WORLD_WIDTH, WORLD_HEIGHT};
+    bench.bounds = bounds;
+}
+
+void benchKernelUniform(void *context)
+{
+    KernelBench &bench = *(KernelBench*)context;
+    int count = (int)bench.posX.size();
+    integrateProjectiles(&bench.posX[0], &bench.posY[0], 0, -12, count, bench.bounds, &bench.kill[0], bench.path);
+    integrateProjectiles(&bench.posX[0], &bench.posY[0], 0, 12, count, bench.bounds, &bench.kill[0], bench.path);
+}
+
+void benchKernelPerShot(void *context)
+{
+    KernelBench &bench = *(KernelBench*)context;
+    int count = (int)bench.posX.size();
+    integrateProjectiles(&bench.posX[0], &bench.posY[0], &bench.velX[0], &bench.velY[0], count,
+                         bench.bounds, &bench.kill[0], bench.path);
+}
+
+// Runs every supported path on the same input and compares against scalar
+// Odd count so the SIMD paths' scalar tail gets checked too
+bool checkSimdPaths()
+{
+    const int count = 1027;
+    KernelBench reference;
+    fillKernelBench(reference, count);
+    KernelBench input = reference;
+
+    bool success = true;
+    for (int uniform = 0; uniform < 2; uniform++) {
+        KernelBench expected = input;
+        if (uniform) {
+            integrateProjectiles(&expected.posX[0], &expected.posY[0], 5, -12, count, expected.bounds, &expected.kill[0], SIMD_SCALAR);
+        } else {
+            integrateProjectiles(&expected.posX[0], &expected.posY[0], &expected.velX[0], &expected.velY[0], count,
+                                 expected.bounds, &expected.kill[0], SIMD_SCALAR);
+        }
+
+        for (int p = SIMD_SCALAR+1; p < SIMD_PATH_COUNT; p++) {
+            SimdPath path = (SimdPath)p;
+            if (!simdPathSupported(path)) { continue; }
+
+            KernelBench actual = input;
+            if (uniform) {
+                integrateProjectiles(&actual.posX[0], &actual.posY[0], 5, -12, count, actual.bounds, &actual.kill[0], path);
+            } else {
+                integrateProjectiles(&actual.posX[0], &actual.posY[0], &actual.velX[0], &actual.velY[0], count,
+                                     actual.bounds, &actual.kill[0], path);
+            }
+            if (actual.posX != expected.posX || actual.posY != expected.posY || actual.kill != expected.kill) {
+                fprintf(stderr, "Error: %s kernel (%s velocity) doesn't match scalar\n",
+                        simdPathName(path), uniform ? "uniform" : "per-shot");
+                success = false;
+            }
+        }
+    }
+    return success;
+}
+
+void runKernelBenches()
+{
+    for (int p = SIMD_SCALAR; p < SIMD_PATH_COUNT; p++) {
+        SimdPath path = (SimdPath)p;
+        if (!simdPathSupported(path)) { continue; }
+
+        KernelBench bullets;
+        fillKernelBench(bullets, MAX_PROJECTILES);
+        bullets.path = path;
+        runBench("projectile_update_uniform", intParam("count", MAX_PROJECTILES)+", "+stringParam("path", simdPathName(path)),
+                 MAX_PROJECTILES*2, benchKernelUniform, &bullets);
+
+        KernelBench shots;
+        fillKernelBench(shots, MAX_ENEMY_SHOTS);
+        shots.path = path;
+        runBench("projectile_update_per_shot", intParam("count", MAX_ENEMY_SHOTS)+", "+stringParam("path", simdPathName(path)),
+                 MAX_ENEMY_SHOTS, benchKernelPerShot, &shots);
+    }
+}
+
+// Bullet-versus-enemy collision, grid against the old every-pair loop, and pixel masks against bounds alone
+struct CollisionBench
+{
+    std::vector<int> bulletX;
+    std::vector<int> bulletY;
+    std::vector<CollisionBox> enemies;
+    std::vector<HitPair> hits;
+    std::vector<char> claimed;
+    SpatialHash grid;
+
+    // Enemy boxes grown by the bullet's size, and the masks (a diamond ship, a swept bullet)
+    std::vector<CollisionBox> grown;
+    CollisionMask enemyMask;
+    CollisionMask bulletMask;
+
+    CollisionBench() : grid(WORLD_WIDTH, WORLD_HEIGHT) {}
+};
+
+void benchCollisionGrid(void *context)
+{
+    CollisionBench &bench = *(CollisionBench*)context;
+    bench.hits.clear();
+    bench.grid.build(&bench.bulletX[0], &bench.bulletY[0], (int)bench.bulletX.size());
+    bench.grid.queryAll(&bench.enemies[0], (int)bench.enemies.size(), bench.hits);
+}
+
+void benchCollisionBruteForce(void *context)
+{
+    CollisionBench &bench = *(CollisionBench*)context;
+    bench.hits.clear();
+    std::fill(bench.claimed.begin(), bench.claimed.end(), 0);
+    for (size_t e = 0; e < bench.enemies.size(); e++) {
+        for (size_t b = 0; b < bench.bulletX.size(); b++) {
+            if (!bench.claimed[b] && boxContains(bench.enemies[e], bench.bulletX[b], bench.bulletY[b])) {
+                bench.claimed[b] = 1;
+                HitPair hit = {(int)e, (int)b};
+                bench.hits.push_back(hit);
+            }
+        }
+    }
+}
+
+bool benchMaskHit(void *context, int enemy, int bullet)
+{
+    CollisionBench &bench = *(CollisionBench*)context;
+    const CollisionBox &box = bench.enemies[enemy];
+    return bench.enemyMask.overlaps(box.x, box.y, bench.bulletMask, bench.bulletX[bullet], bench.bulletY[bullet]);
+}
+
+// What GameState::shootEnemies() does on one thread, with or without the masks
+void benchCollisionNarrow(CollisionBench &bench, HitTest hitTest)
+{
+    bench.hits.clear();
+    bench.grid.build(&bench.bulletX[0], &bench.bulletY[0], (int)bench.bulletX.size());
+    bench.grid.startCollect(&bench.grown[0], (int)bench.grown.size());
+    bench.grid.collect(&bench.grown[0], 0, (int)bench.grown.size(), hitTest, &bench);
+    bench.grid.claimCollected(bench.hits);
+}
+
+void benchCollisionBounds(void *context) { benchCollisionNarrow(*(CollisionBench*)context, NULL); }
+
+void benchCollisionMasks(void *context) { benchCollisionNarrow(*(CollisionBench*)context, benchMaskHit); }
+
+void runCollisionBenches()
+{
+    // 40x40 diamond, so the corners of its box are empty like a ship sprite's
+    CollisionMask enemyMask;
+    enemyMask.resize(40, 40);
+    for (int y = 0; y < 40; y++) {
+        for (int x = 0; x < 40; x++) {
+            if (abs(2*x-39)+abs(2*y-39) <= 40)
+                enemyMask.set(x, y);
+        }
+    }
+    // 4x10 bullet moving 8 pixels a tick
+    CollisionMask bullet;
+    bullet.resize(4, 10);
+    for (int y = 0; y < 10; y++) {
+        for (int x = 0; x < 4; x++) {
+            bullet.set(x, y);
+        }
+    }
+    CollisionMask bulletMask;
+    bulletMask.smearDown(bullet, 8);
+
+    const int bulletCounts[] = {64, 256, MAX_PROJECTILES};
+    const int enemyCounts[] = {8, 64, 512};
+
+    for (int b = 0; b < 3; b++) {
+        for (int e = 0; e < 3; e++) {
+            CollisionBench bench;
+            for (int i = 0; i < bulletCounts[b]; i++) {
+                bench.bulletX.push_back(rand() % WORLD_WIDTH);
+                bench.bulletY.push_back(rand() % WORLD_HEIGHT);
+            }
+            bench.claimed.resize(bulletCounts[b]);
+            // Enemies keep to the top half, like in the game
+            for (int i = 0; i < enemyCounts[e]; i++) {
+                CollisionBox box = {rand() % (WORLD_WIDTH-40), rand() % (WORLD_HEIGHT/2), 40, 40};
+                bench.enemies.push_back(box);
+                bench.grown.push_back(growBox(box, bulletMask.getWidth(), bulletMask.getHeight()));
+            }
+            bench.enemyMask = enemyMask;
+            bench.bulletMask = bulletMask;
+            bench.hits.reserve(bulletCounts[b]);
+
+            std::string params = intParam("bullets", bulletCounts[b])+", "+intParam("enemies", enemyCounts[e]);
+            runBench("collision_grid", params, 1, benchCollisionGrid, &bench);
+            runBench("collision_brute_force", params, 1, benchCollisionBruteForce, &bench);
+            runBench("collision_bounds", params, 1, benchCollisionBounds, &bench);
+            runBench("collision_masks", params, 1, benchCollisionMasks, &bench);
+        }
+    }
+}
+
+// Background scrolling, both copies per call like the game does
+struct BackgroundBench
+{
+    int y[2];
+    int steps;
+};
+
+void benchMoveBackground(void *context)
+{
+    BackgroundBench &bench = *(BackgroundBench*)context;
+    for (int i = 0; i < bench.steps; i++) {
+        bench.y[0] = moveBackground(bench.y[0], bench.y[1], 1, WORLD_HEIGHT*2, WORLD_HEIGHT);
+        bench.y[1] = moveBackground(bench.y[1], bench.y[0], 1, WORLD_HEIGHT*2, WORLD_HEIGHT);
+    }
+}
+
+void runBackgroundBenches()
+{
+    BackgroundBench bench = {{0, -WORLD_HEIGHT*2}, 10000};
+    runBench("move_background", intParam("steps", bench.steps), bench.steps, benchMoveBackground, &bench);
+}
+
+// The background streaming through its tile cache while it scrolls, one frame per op
+struct StreamBench
+{
+    ScrollingBackground *background;
+    int y[2];
+    int speed;
+};
+
+void benchStreamBackground(void *context)
+{
+    StreamBench &bench = *(StreamBench*)context;
+    int height = bench.background->getHeight();
+    bench.y[0] = moveBackground(bench.y[0], bench.y[1], bench.speed, height, WORLD_HEIGHT);
+    bench.y[1] = moveBackground(bench.y[1], bench.y[0], bench.speed, height, WORLD_HEIGHT);
+    bench.background->render(bench.y[0], WORLD_HEIGHT);
+    bench.background->render(bench.y[1], WORLD_HEIGHT);
+    bench.background->prefetch(bench.y[0]);
+    bench.background->prefetch(bench.y[1]);
+    SDL_RenderPresent(gRenderer);
+}
+
+// A mostly still screen (like the title) drawn whole, or redrawn only where it changed
+struct SceneBench
+{
+    ScrollingBackground *background;
+    LTexture *sprite;
+    int sprites;
+    // Only this one moves
+    int moverX;
+    bool partial;
+};
+
+void drawScene(SceneBench &bench)
+{
+    if (!gDirty.isRecording()) {
+        SDL_SetRenderDrawColor(gRenderer, 0, 0, 0, 0xFF);
+        SDL_RenderFillRect(gRenderer, NULL);
+    }
+    bench.background->render(0, WORLD_HEIGHT);
+    for (int i = 0; i < bench.sprites; i++) {
+        bench.sprite->render((i*37) % WORLD_WIDTH, (i*91) % WORLD_HEIGHT);
+    }
+    bench.sprite->render(bench.moverX, WORLD_HEIGHT/2);
+}
+
+void benchScene(void *context)
+{
+    SceneBench &bench = *(SceneBench*)context;
+    bench.moverX = (bench.moverX+3) % WORLD_WIDTH;
+    if (bench.partial) {
+        gDirty.beginFrame(WORLD_WIDTH, WORLD_HEIGHT);
+        drawScene(bench);
+        gDirty.endFrame();
+
+        const std::vector<SDL_Rect> &rects = gDirty.getRects();
+        for (size_t i = 0; i < rects.size(); i++) {
+            SDL_RenderSetClipRect(gRenderer, &rects[i]);
+            drawScene(bench);
+        }
+        SDL_RenderSetClipRect(gRenderer, NULL);
+    } else {
+        drawScene(bench);
+    }
+    SDL_RenderPresent(gRenderer);
+}
+
+// LTexture::render submission against a software renderer (includes the present, which does the drawing)
+struct RenderBench
+{
+    LTexture *texture;
+    int sprites;
+    double angle;
+};
+
+void benchRender(void *context)
+{
+    RenderBench &bench = *(RenderBench*)context;
+    SDL_SetRenderDrawColor(gRenderer, 0, 0, 0, 0xFF);
+    SDL_RenderClear(gRenderer);
+    for (int i = 0; i < bench.sprites; i++) {
+        bench.texture->render((i*37) % WORLD_WIDTH, (i*91) % WORLD_HEIGHT, NULL, bench.angle);
+    }
+    SDL_RenderPresent(gRenderer);
+}
+
+bool runRenderBenches()
+{
+    SDL_Surface *target = SDL_CreateRGBSurfaceWithFormat(0, WORLD_WIDTH, WORLD_HEIGHT, 32, SDL_PIXELFORMAT_RGBA32);
+    SDL_Surface *sprite = SDL_CreateRGBSurfaceWithFormat(0, 64, 64, 32, SDL_PIXELFORMAT_RGBA32);
+    if (!target || !sprite) {
+        printf("Unable to create benchmark surfaces. SDL Error: %s\n", SDL_GetError());
+        SDL_FreeSurface(target);
+        SDL_FreeSurface(sprite);
+        return false;
+    }
+
+    gRenderer = SDL_CreateSoftwareRenderer(target);
+    if (!gRenderer) {
+        printf("Software renderer could not be created. SDL Error: %s\n", SDL_GetError());
+        SDL_FreeSurface(target);
+        SDL_FreeSurface(sprite);
+        return false;
+    }
+
+    // A 32x32 sprite in the corner of a 64x64 "page", drawn whole and as an atlas view
+    SDL_FillRect(sprite, NULL, SDL_MapRGBA(sprite->format, 0, 0, 0, 0));
+    SDL_Rect spriteRect = {0, 0, 32, 32};
+    SDL_FillRect(sprite, &spriteRect, SDL_MapRGBA(sprite->format, 0xFF, 0x80, 0x20, 0xFF));
+
+    LTexture page;
+    LTexture view;
+    bool success = page.loadFromSurface(sprite);
+    if (success) {
+        view.setView(page.getTexture(), spriteRect);
+
+        const int sprites = 256;
+        RenderBench plain = {&page, sprites, 0.0};
+        RenderBench rotated = {&page, sprites, 30.0};
+        RenderBench atlas = {&view, sprites, 0.0};
+        runBench("texture_render", intParam("sprites", sprites)+", "+intParam("size", 64), sprites, benchRender, &plain);
+        runBench("texture_render_rotated", intParam("sprites", sprites)+", "+intParam("size", 64), sprites, benchRender, &rotated);
+        runBench("texture_render_view", intParam("sprites", sprites)+", "+intParam("size", 32), sprites, benchRender, &atlas);
+
+        // Ten screens tall, as long as the game's background
+        ScrollingBackground background;
+        SDL_Surface *backgroundImage = SDL_CreateRGBSurfaceWithFormat(0, WORLD_WIDTH, WORLD_HEIGHT*10, 32, SDL_PIXELFORMAT_RGBA32);
+        if (backgroundImage) {
+            SDL_FillRect(backgroundImage, NULL, SDL_MapRGBA(backgroundImage->format, 0x10, 0x10, 0x40, 0xFF));
+        }
+        success = background.load(backgroundImage);
+        if (success) {
+            StreamBench stream = {&background, {WORLD_HEIGHT-background.getHeight(), WORLD_HEIGHT-background.getHeight()*2}, 10};
+            runBench("background_stream", intParam("height", background.getHeight())+", "+intParam("tile_height", BACKGROUND_TILE_HEIGHT),
+                     1, benchStreamBackground, &stream);
+
+            const int stillSprites = 32;
+            SceneBench full = {&background, &page, stillSprites, 0, false};
+            SceneBench partial = {&background, &page, stillSprites, 0, true};
+            runBench("still_frame_full", intParam("sprites", stillSprites+1)+", "+intParam("moving", 1), 1, benchScene, &full);
+            runBench("still_frame_dirty_rects", intParam("sprites", stillSprites+1)+", "+intParam("moving", 1), 1, benchScene, &partial);
+        }
+    }
+
+    view.free();
+    page.free();
+    SDL_DestroyRenderer(gRenderer);
+    gRenderer = NULL;
+    SDL_FreeSurface(sprite);
+    SDL_FreeSurface(target);
+    return success;
+}
+
+// The systems the game splits into jobs, at full load
+struct JobBench
+{
+    JobSystem *jobs;
+    Random random;
+    EnemyStore enemies;
+    EnemyTarget target;
+    EnemyShotPool shots;
+    CollisionBox shotBounds;
+    SpatialHash grid;
+    std::vector<int> bulletX;
+    std::vector<int> bulletY;
+    std::vector<CollisionBox> boxes;
+    std::vector<HitPair> hits;
+
+    JobBench() : random(1), enemies(WORLD_HEIGHT), grid(WORLD_WIDTH, WORLD_HEIGHT) {}
+};
+
+// Range sizes per job, small enough that these loads split across every worker
+const int ENEMY_BENCH_GRAIN = 16;
+const int SHOT_BENCH_GRAIN = 256;
+const int BOX_BENCH_GRAIN = 16;
+
+void fillJobBench(JobBench &bench, JobSystem *jobs)
+{
+    bench.jobs = jobs;
+
+    // Same layout every time, so two benches can be compared
+    srand(7);
+    EnemyArchetype wanderer = {100, 2, 1, 5, 40, 40, 0, false, true, 0, 1, 0};
+    bench.enemies.setArchetype(ENEMY_RAIDER, wanderer);
+    for (int i = 0; i < bench.enemies.capacity(); i++) {
+        bench.enemies.spawn(ENEMY_RAIDER, rand() % (WORLD_WIDTH-40), rand() % (WORLD_HEIGHT/2));
+    }
+    CollisionBox player = {WORLD_WIDTH/2, WORLD_HEIGHT*3/4, 40, 40};
+    EnemyTarget target = {player, 10, 0};
+    bench.target = target;
+
+    for (int i = 0; i < bench.shots.capacity(); i++) {
+        bench.shots.spawn(rand() % WORLD_WIDTH, rand() % WORLD_HEIGHT, (i & 1) ? 3 : -3, (i & 2) ? 12 : -12, 1, i);
+    }
+    CollisionBox shotBounds = {0, 0, WORLD_WIDTH, WORLD_HEIGHT};
+    bench.shotBounds = shotBounds;
+
+    for (int i = 0; i < MAX_PROJECTILES; i++) {
+        bench.bulletX.push_back(rand() % WORLD_WIDTH);
+        bench.bulletY.push_back(rand() % WORLD_HEIGHT);
+    }
+    bench.grid.build(&bench.bulletX[0], &bench.bulletY[0], MAX_PROJECTILES);
+    bench.enemies.hitboxes(bench.boxes, 0);
+}
+
+void moveEnemiesRange(void *data, int begin, int end)
+{
+    JobBench &bench = *(JobBench*)data;
+    bench.enemies.moveRange(bench.target, begin, end);
+}
+
+void moveShotsRange(void *data, int begin, int end)
+{
+    JobBench &bench = *(JobBench*)data;
+    bench.shots.integrateRange(bench.shotBounds, begin, end);
+}
+
+void collectRange(void *data, int begin, int end)
+{
+    JobBench &bench = *(JobBench*)data;
+    bench.grid.collect(&bench.boxes[0], begin, end);
+}
+
+void benchJobEnemies(void *context)
+{
+    JobBench &bench = *(JobBench*)context;
+    bench.target.now+=16;
+    bench.enemies.rollWander(bench.random);
+    bench.jobs->parallelFor(bench.enemies.size(), ENEMY_BENCH_GRAIN, moveEnemiesRange, &bench);
+}
+
+void benchJobShots(void *context)
+{
+    JobBench &bench = *(JobBench*)context;
+    bench.jobs->parallelFor(bench.shots.size(), SHOT_BENCH_GRAIN, moveShotsRange, &bench);
+}
+
+void benchJobCollision(void *context)
+{
+    JobBench &bench = *(JobBench*)context;
+    bench.hits.clear();
+    bench.grid.startCollect(&bench.boxes[0], (int)bench.boxes.size());
+    bench.jobs->parallelFor((int)bench.boxes.size(), BOX_BENCH_GRAIN, collectRange, &bench);
+    bench.grid.claimCollected(bench.hits);
+}
+
+// Runs the same steps with workers and inline, and compares every result
+bool checkJobs(int workers)
+{
+    JobSystem inlineJobs;
+    JobSystem workerJobs;
+    if (!inlineJobs.start(0) || !workerJobs.start(workers)) { return false; }
+
+    JobBench expected;
+    JobBench actual;
+    fillJobBench(expected, &inlineJobs);
+    fillJobBench(actual, &workerJobs);
+
+    bool success = true;
+    for (int step = 0; step < 50 && success; step++) {
+        JobBench *benches[2] = {&expected, &actual};
+        for (int b = 0; b < 2; b++) {
+            benchJobEnemies(benches[b]);
+            benchJobShots(benches[b]);
+            benches[b]->enemies.hitboxes(benches[b]->boxes, 0);
+            benchJobCollision(benches[b]);
+        }
+
+        success = expected.enemies.posX == actual.enemies.posX && expected.enemies.posY == actual.enemies.posY &&
+                  expected.enemies.timeSinceMove == actual.enemies.timeSinceMove &&
+                  expected.shots.posX == actual.shots.posX && expected.shots.posY == actual.shots.posY &&
+                  expected.hits.size() == actual.hits.size();
+        for (size_t h = 0; h < expected.hits.size() && success; h++) {
+            success = expected.hits[h].entity == actual.hits[h].entity && expected.hits[h].projectile == actual.hits[h].projectile;
+        }
+    }
+    if (!success) {
+        fprintf(stderr, "Error: jobs on %d workers don't match running them inline\n", workers);
+    }
+    return success;
+}
+
+// Times each split system at several worker counts (up to one per core), returns false if any count changed a result
+bool runJobBenches()
+{
+    const int workerCounts[] = {0, 1, 2, 4, 8, 16};
+    int maxWorkers = SDL_GetCPUCount()-1;
+    if (maxWorkers < 1) { maxWorkers = 1; }
+
+    bool success = true;
+    for (int w = 0; w < 6; w++) {
+        int workers = workerCounts[w];
+        if (workers > maxWorkers || workers > MAX_JOB_WORKERS) { break; }
+        if (workers > 0) {
+            success = checkJobs(workers) && success;
+        }
+
+        JobSystem jobs;
+        if (!jobs.start(workers)) { return false; }
+        JobBench bench;
+        fillJobBench(bench, &jobs);
+
+        std::string params = intParam("workers", workers);
+        runBench("jobs_enemy_move", params+", "+intParam("count", bench.enemies.size()), bench.enemies.size(), benchJobEnemies, &bench);
+        runBench("jobs_shot_update", params+", "+intParam("count", bench.shots.size()), bench.shots.size(), benchJobShots, &bench);
+        runBench("jobs_collision", params+", "+intParam("bullets", MAX_PROJECTILES)+", "+intParam("enemies", (int)bench.boxes.size()),
+                 1, benchJobCollision, &bench);
+    }
+    return success;
+}
+
+bool writeResults(FILE *file, bool simdOk, bool jobsOk)
+{
+    fprintf(file, "{\n");
+    fprintf(file, "  \"simd_path\": \"%s\",\n", simdPathName(bestSimdPath()));
+    fprintf(file, "  \"simd_check\": \"%s\",\n", simdOk ? "pass" : "fail");
+    fprintf(file, "  \"jobs_check\": \"%s\",\n", jobsOk ? "pass" : "fail");
+    fprintf(file, "  \"results\": [\n");
+    for (size_t i = 0; i < gResults.size(); i++) {
+        const BenchResult &result = gResults[i];
+        fprintf(file, "    {\"name\": \"%s\", %s, \"ops\": %d, \"reps\": %d, \"ns_per_op\": %.3f, \"min_ns_per_op\": %.3f}%s\n",
+                result.name.c_str(), result.params.c_str(), result.ops, result.reps, result.medianNs, result.minNs,
+                i+1 < gResults.size() ? "," : "");
+    }
+    fprintf(file, "  ]\n}\n");
+    return ferror(file) == 0;
+}
+
+int main (int argc, char *args[])
+{
+    const char *outPath = NULL;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(args[i], "--out") == 0 && i+1 < argc) {
+            outPath = args[++i];
+        } else if (strcmp(args[i], "--quick") == 0) {
+            gMinSeconds = 0.02;
+        } else {
+            printf("Warning: Unknown option %s\n", args[i]);
+        }
+    }
+
+    if (SDL_Init(0) < 0) {
+        printf("SDL could not initialize. SDL Error: %s\n", SDL_GetError());
+        return 1;
+    }
+
+    // Same inputs every run so results compare
+    srand(1);
+
+    bool simdOk = checkSimdPaths();
+    runPoolBenches();
+    runKernelBenches();
+    runCollisionBenches();
+    runBackgroundBenches();
+    bool jobsOk = runJobBenches();
+    bool success = runRenderBenches() && simdOk && jobsOk;
+
+    if (outPath) {
+        FILE *file = fopen(outPath, "w");
+        if (!file) {
+            printf("Unable to write results %s.\n", outPath);
+            success = false;
+        } else {
+            success = writeResults(file, simdOk, jobsOk) && success;
+            fclose(file);
+        }
+    } else {
+        writeResults(stdout, simdOk, jobsOk);
+    }
+
+    SDL_Quit();
+    return success ? 0 : 1;
+}
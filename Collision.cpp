@@ -0,0 +1,296 @@
+#include "Collision.h"
+
+#include <stddef.h>
+
+bool boxContains(const CollisionBox &box, int x, int y)
+{
+    return x >= box.x && x < box.x+box.w && y >= box.y && y < box.y+box.h;
+}
+
+bool boxesOverlap(const CollisionBox &a, const CollisionBox &b)
+{
+    return a.x < b.x+b.w && b.x < a.x+a.w && a.y < b.y+b.h && b.y < a.y+a.h;
+}
+
+CollisionBox growBox(const CollisionBox &box, int width, int height)
+{
+    CollisionBox grown = {box.x-width+1, box.y-height+1, box.w+width-1, box.h+height-1};
+    return grown;
+}
+
+SpatialHash::SpatialHash(int worldWidth, int worldHeight, int cellSize)
+{
+    mCellSize = cellSize;
+    mColumns = (worldWidth+cellSize-1)/cellSize;
+    mRows = (worldHeight+cellSize-1)/cellSize;
+    if (mColumns < 1) { mColumns = 1; }
+    if (mRows < 1) { mRows = 1; }
+    mCellStart.resize(mColumns*mRows+1, 0);
+    mCollectCount = 0;
+}
+
+int SpatialHash::columnOf(int x)
+{
+    if (x < 0) { return 0; }
+    int column = x/mCellSize;
+    return column < mColumns ? column : mColumns-1;
+}
+
+int SpatialHash::rowOf(int y)
+{
+    if (y < 0) { return 0; }
+    int row = y/mCellSize;
+    return row < mRows ? row : mRows-1;
+}
+
+void SpatialHash::build(const int *x, const int *y, int count)
+{
+    // Only grows, so steady-state ticks don't allocate
+    if ((int)mCellOf.size() < count) {
+        mCellOf.resize(count);
+        mPointX.resize(count);
+        mPointY.resize(count);
+        mPointIndex.resize(count);
+        mClaimed.resize(count);
+    }
+
+    // Counting sort by cell: count, prefix sum, then scatter
+    int cellCount = mColumns*mRows;
+    for (int c = 0; c <= cellCount; c++) { mCellStart[c] = 0; }
+    for (int i = 0; i < count; i++) {
+        mCellOf[i] = rowOf(y[i])*mColumns + columnOf(x[i]);
+        mCellStart[mCellOf[i]+1]++;
+    }
+    for (int c = 0; c < cellCount; c++) { mCellStart[c+1]+=mCellStart[c]; }
+
+    for (int i = 0; i < count; i++) {
+        // Uses mCellStart[c] as the write cursor, then shifts it back below
+        int at = mCellStart[mCellOf[i]]++;
+        mPointX[at] = x[i];
+        mPointY[at] = y[i];
+        mPointIndex[at] = i;
+        mClaimed[at] = 0;
+    }
+    for (int c = cellCount; c > 0; c--) { mCellStart[c] = mCellStart[c-1]; }
+    mCellStart[0] = 0;
+}
+
+void SpatialHash::reserve(int pointCount, int boxCount)
+{
+    if ((int)mCellOf.size() < pointCount) {
+        mCellOf.resize(pointCount);
+        mPointX.resize(pointCount);
+        mPointY.resize(pointCount);
+        mPointIndex.resize(pointCount);
+        mClaimed.resize(pointCount);
+    }
+    if ((int)mBoxStart.size() < boxCount+1) {
+        mBoxStart.resize(boxCount+1);
+        mBoxFound.resize(boxCount);
+    }
+    if ((int)mCollected.size() < pointCount*GRID_BOXES_PER_POINT) { mCollected.resize(pointCount*GRID_BOXES_PER_POINT); }
+}
+
+int SpatialHash::pointsNear(const CollisionBox &box)
+{
+    if (box.w <= 0 || box.h <= 0) { return 0; }
+
+    // A row's cells are next to each other in mCellStart, so each row is one subtraction
+    int column0 = columnOf(box.x);
+    int column1 = columnOf(box.x+box.w-1);
+    int count = 0;
+    for (int row = rowOf(box.y); row <= rowOf(box.y+box.h-1); row++) {
+        count+=mCellStart[row*mColumns+column1+1]-mCellStart[row*mColumns+column0];
+    }
+    return count;
+}
+
+void SpatialHash::query(const CollisionBox &box, std::vector<int> &out)
+{
+    if (box.w <= 0 || box.h <= 0) { return; }
+
+    int column0 = columnOf(box.x);
+    int column1 = columnOf(box.x+box.w-1);
+    int row0 = rowOf(box.y);
+    int row1 = rowOf(box.y+box.h-1);
+    for (int row = row0; row <= row1; row++) {
+        for (int column = column0; column <= column1; column++) {
+            int cell = row*mColumns + column;
+            for (int p = mCellStart[cell]; p < mCellStart[cell+1]; p++) {
+                if (boxContains(box, mPointX[p], mPointY[p])) {
+                    out.push_back(mPointIndex[p]);
+                }
+            }
+        }
+    }
+}
+
+void SpatialHash::queryAll(const CollisionBox *boxes, int boxCount, std::vector<HitPair> &hits)
+{
+    for (int b = 0; b < boxCount; b++) {
+        const CollisionBox &box = boxes[b];
+        if (box.w <= 0 || box.h <= 0) { continue; }
+
+        int column0 = columnOf(box.x);
+        int column1 = columnOf(box.x+box.w-1);
+        int row0 = rowOf(box.y);
+        int row1 = rowOf(box.y+box.h-1);
+        for (int row = row0; row <= row1; row++) {
+            for (int column = column0; column <= column1; column++) {
+                int cell = row*mColumns + column;
+                for (int p = mCellStart[cell]; p < mCellStart[cell+1]; p++) {
+                    if (!mClaimed[p] && boxContains(box, mPointX[p], mPointY[p])) {
+                        mClaimed[p] = 1;
+                        HitPair hit = {b, mPointIndex[p]};
+                        hits.push_back(hit);
+                    }
+                }
+            }
+        }
+    }
+}
+
+void SpatialHash::startCollect(const CollisionBox *boxes, int boxCount)
+{
+    // Only grows
+    if ((int)mBoxStart.size() < boxCount+1) {
+        mBoxStart.resize(boxCount+1);
+        mBoxFound.resize(boxCount);
+    }
+    mBoxStart[0] = 0;
+    for (int b = 0; b < boxCount; b++) {
+        mBoxStart[b+1] = mBoxStart[b]+pointsNear(boxes[b]);
+    }
+    if ((int)mCollected.size() < mBoxStart[boxCount]) { mCollected.resize(mBoxStart[boxCount]); }
+    mCollectCount = boxCount;
+}
+
+void SpatialHash::collect(const CollisionBox *boxes, int begin, int end, HitTest hitTest, void *context)
+{
+    for (int b = begin; b < end; b++) {
+        const CollisionBox &box = boxes[b];
+        int found = 0;
+        mBoxFound[b] = 0;
+        if (box.w <= 0 || box.h <= 0) { continue; }
+
+        // Same walk as queryAll(), so claimCollected() sees points in the same order
+        int column0 = columnOf(box.x);
+        int column1 = columnOf(box.x+box.w-1);
+        int row0 = rowOf(box.y);
+        int row1 = rowOf(box.y+box.h-1);
+        for (int row = row0; row <= row1; row++) {
+            for (int column = column0; column <= column1; column++) {
+                int cell = row*mColumns + column;
+                for (int p = mCellStart[cell]; p < mCellStart[cell+1]; p++) {
+                    if (boxContains(box, mPointX[p], mPointY[p]) && (!hitTest || hitTest(context, b, mPointIndex[p]))) {
+                        mCollected[mBoxStart[b]+found] = p;
+                        found++;
+                    }
+                }
+            }
+        }
+        mBoxFound[b] = found;
+    }
+}
+
+void SpatialHash::claimCollected(std::vector<HitPair> &hits)
+{
+    for (int b = 0; b < mCollectCount; b++) {
+        for (int i = 0; i < mBoxFound[b]; i++) {
+            int p = mCollected[mBoxStart[b]+i];
+            if (!mClaimed[p]) {
+                mClaimed[p] = 1;
+                HitPair hit = {b, mPointIndex[p]};
+                hits.push_back(hit);
+            }
+        }
+    }
+}
+
+int SpatialHash::getColumns() { return mColumns; }
+int SpatialHash::getRows() { return mRows; }
+
+CollisionMask::CollisionMask()
+{
+    mWidth = 0;
+    mHeight = 0;
+    mWordsPerRow = 0;
+}
+
+void CollisionMask::resize(int width, int height)
+{
+    mWidth = width > 0 ? width : 0;
+    mHeight = height > 0 ? height : 0;
+    mWordsPerRow = (mWidth+63)/64;
+    mBits.assign(mWordsPerRow*mHeight, 0);
+}
+
+void CollisionMask::reserve(int width, int height)
+{
+    if (width > 0 && height > 0)
+        mBits.reserve(((width+63)/64)*height);
+}
+
+void CollisionMask::set(int x, int y)
+{
+    mBits[y*mWordsPerRow+x/64] |= (uint64_t)1 << (x%64);
+}
+
+bool CollisionMask::test(int x, int y) const
+{
+    if (x < 0 || y < 0 || x >= mWidth || y >= mHeight) { return false; }
+    return (mBits[y*mWordsPerRow+x/64] >> (x%64)) & 1;
+}
+
+bool CollisionMask::overlaps(int x, int y, const CollisionMask &other, int otherX, int otherY) const
+{
+    // Rows both masks cover, in this mask's coordinates
+    int dx = otherX-x;
+    int dy = otherY-y;
+    int row0 = dy > 0 ? dy : 0;
+    int row1 = dy+other.mHeight < mHeight ? dy+other.mHeight : mHeight;
+    if (row0 >= row1 || dx >= mWidth || dx+other.mWidth <= 0) { return false; }
+
+    // Only the words of this mask that the other one reaches into
+    int word0 = dx > 0 ? dx/64 : 0;
+    int word1 = dx+other.mWidth < mWidth ? (dx+other.mWidth+63)/64 : mWordsPerRow;
+    for (int word = word0; word < word1; word++) {
+        // The other mask's 64 pixels under this word straddle two of its words (the same ones on every row)
+        int column = word*64-dx;
+        int low = column >= 0 ? column/64 : -1;
+        int shift = column-low*64;
+        bool hasLow = low >= 0;
+        bool hasHigh = shift > 0 && low+1 < other.mWordsPerRow;
+
+        for (int row = row0; row < row1; row++) {
+            const uint64_t *otherBits = &other.mBits[(row-dy)*other.mWordsPerRow];
+            uint64_t bits = hasLow ? otherBits[low] >> shift : 0;
+            if (hasHigh)
+                bits |= otherBits[low+1] << (64-shift);
+            if (mBits[row*mWordsPerRow+word] & bits)
+                return true;
+        }
+    }
+    return false;
+}
+
+void CollisionMask::smearDown(const CollisionMask &source, int rows)
+{
+    if (rows < 0) { rows = 0; }
+    resize(source.mWidth, source.mHeight > 0 ? source.mHeight+rows : 0);
+
+    // Row y is every source row from y-rows to y ORed together
+    for (int y = 0; y < mHeight; y++) {
+        int first = y-rows > 0 ? y-rows : 0;
+        int last = y < source.mHeight ? y : source.mHeight-1;
+        for (int sourceRow = first; sourceRow <= last; sourceRow++) {
+            for (int word = 0; word < mWordsPerRow; word++) {
+                mBits[y*mWordsPerRow+word] |= source.mBits[sourceRow*mWordsPerRow+word];
+            }
+        }
+    }
+}
+
+int CollisionMask::getWidth() const { return mWidth; }
+
+int CollisionMask::getHeight() const { return mHeight; }
@@ -0,0 +1,151 @@
+#ifndef COLLISION_H
+#define COLLISION_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+// Side of one grid cell in pixels
+const int GRID_CELL_SIZE = 64;
+
+// Candidate slots SpatialHash::reserve() sets aside per point, for the boxes that touch its cell
+// (a tick that needs more grows the buffer once and keeps it)
+const int GRID_BOXES_PER_POINT = 8;
+
+// Axis-aligned box, covers x to x+w-1 and y to y+h-1
+struct CollisionBox
+{
+    int x;
+    int y;
+    int w;
+    int h;
+};
+
+// One projectile (point index) overlapping one entity (box index)
+struct HitPair
+{
+    int entity;
+    int projectile;
+};
+
+// Narrow phase for SpatialHash::collect(), true if the point (as indexed in build()) really hits the box
+typedef bool (*HitTest)(void *context, int box, int point);
+
+// True if the point is inside the box
+bool boxContains(const CollisionBox &box, int x, int y);
+
+// True if the boxes share at least one pixel
+bool boxesOverlap(const CollisionBox &a, const CollisionBox &b);
+
+// Grows box to hold the top-left corner of every width x height box that overlaps it
+// (so a point test against it finds every sprite of that size touching box)
+CollisionBox growBox(const CollisionBox &box, int width, int height);
+
+// Uniform grid over the play area that buckets projectile positions by cell
+// Points outside the area go in the nearest edge cell, so they are still found
+class SpatialHash
+{
+    public:
+        // Sizes the grid to cover worldWidth x worldHeight
+        SpatialHash(int worldWidth, int worldHeight, int cellSize = GRID_CELL_SIZE);
+
+        // Rebuckets count points (call once per tick, after projectiles move)
+        void build(const int *x, const int *y, int count);
+
+        // Allocates for up to pointCount points and boxCount collect() boxes, plus
+        // GRID_BOXES_PER_POINT candidates per point, so later ticks don't allocate
+        void reserve(int pointCount, int boxCount);
+
+        // Appends the index of every point inside box to out
+        void query(const CollisionBox &box, std::vector<int> &out);
+
+        // Appends a pair for every point inside each box, in one pass over the boxes
+        // A point inside several boxes is only reported for the first one
+        void queryAll(const CollisionBox *boxes, int boxCount, std::vector<HitPair> &hits);
+
+        // queryAll() in three steps so the middle one can be split across threads
+        // startCollect() gives each box a slice of one buffer, as long as the points in the cells it
+        // touches. collect() finds the points inside boxes begin to end-1 without claiming them (ranges
+        // can run at once), then claimCollected() reports them exactly as queryAll() would
+        // A hitTest (if given) is asked about each point inside a box, and only points it passes
+        // are reported, so a point it rejects can still hit a later box
+        void startCollect(const CollisionBox *boxes, int boxCount);
+        void collect(const CollisionBox *boxes, int begin, int end, HitTest hitTest = NULL, void *context = NULL);
+        void claimCollected(std::vector<HitPair> &hits);
+
+        // Gets grid size in cells
+        int getColumns();
+        int getRows();
+
+    private:
+        // Clamps a position to its cell column / row
+        int columnOf(int x);
+        int rowOf(int y);
+
+        // Counts the points in the cells box touches
+        int pointsNear(const CollisionBox &box);
+
+        int mCellSize;
+        int mColumns;
+        int mRows;
+
+        // Points in cell c are mPointX/Y/Index[mCellStart[c]] to [mCellStart[c+1]-1]
+        std::vector<int> mCellStart;
+        std::vector<int> mPointX;
+        std::vector<int> mPointY;
+        std::vector<int> mPointIndex;
+
+        // Cell of each point as passed to build() (scratch for the bucket sort)
+        std::vector<int> mCellOf;
+
+        // Set once a point has been reported by queryAll()
+        std::vector<char> mClaimed;
+
+        // Sorted positions of the points inside each box, written by collect()
+        // Box b has mCollected[mBoxStart[b]] to [mBoxStart[b+1]-1] to itself and fills mBoxFound[b] of them
+        std::vector<int> mCollected;
+        std::vector<int> mBoxStart;
+        std::vector<int> mBoxFound;
+        int mCollectCount;
+};
+
+// Solid pixels of a sprite, one bit each, with every row packed into 64-bit words
+// Bit n of word w in a row is pixel w*64+n, and bits past the width stay clear, so rows
+// can be ANDed a word at a time without masking the edges
+class CollisionMask
+{
+    public:
+        // Initialization (an empty mask never overlaps anything)
+        CollisionMask();
+
+        // Sizes the mask to width x height with every pixel clear
+        void resize(int width, int height);
+
+        // Makes room for a width x height mask, so resizing up to that never allocates
+        void reserve(int width, int height);
+
+        // Marks a pixel solid (must be inside the mask)
+        void set(int x, int y);
+
+        // True if the pixel is inside the mask and solid
+        bool test(int x, int y) const;
+
+        // True if this mask at (x, y) and other at (otherX, otherY) share a solid pixel
+        bool overlaps(int x, int y, const CollisionMask &other, int otherX, int otherY) const;
+
+        // Makes this source with every solid pixel smeared rows further down, which is the
+        // area the source covers while moving up by that much (the mask grows rows taller)
+        void smearDown(const CollisionMask &source, int rows);
+
+        // Gets dimensions in pixels
+        int getWidth() const;
+        int getHeight() const;
+
+    private:
+        int mWidth;
+        int mHeight;
+        int mWordsPerRow;
+        std::vector<uint64_t> mBits;
+};
+
+#endif
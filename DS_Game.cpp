@@ -2,12 +2,36 @@
 #include <SDL2/SDL_image.h>
 #include <SDL2/SDL_ttf.h>
 #include <SDL2/SDL_mixer.h>
-#include <stdio.h>
+#include <assert.h>
+#include <stdio.h>
 #include <string>
 #include <math.h>
 #include <stdlib.h>
 #include <time.h>
-#include <sstream>
+#include <string.h>
+#include <vector>
+#include <algorithm>
+#include <functional>
+
+#include "AssetPack.h"
+#include "AtlasPacker.h"
+#include "Background.h"
+#include "Collision.h"
+#include "DirtyRects.h"
+#include "Enemies.h"
+#include "FrameArena.h"
+#include "FrameProfiler.h"
+#include "GoldenFrames.h"
+#include "ImageDecoder.h"
+#include "InputLatency.h"
+#include "JobSystem.h"
+#include "LTexture.h"
+#include "Projectiles.h"
+#include "Random.h"
+#include "Replay.h"
+#include "SoundEffects.h"
+#include "TripleBuffer.h"
+#include "Waves.h"
 
 #define PI 3.14159265
 
@@ -19,55 +43,78 @@ const int SCREEN_HEIGHT = 640;
 //Analog joystick dead zone
 const int JOYSTICK_DEAD_ZONE = 8000;
 
-// Class for textures
-class LTexture
-{
-	public:
-		// Initialization
-		LTexture();
-
-		// Deallocation
-		~LTexture();
-
-		// Image loading
-		bool loadFromFile (std::string path);
-
-        // ifdef in case SDL_TTF isn't installed
-		#ifdef _SDL_TTF_H
-		// Font string -> image
-		bool loadFromRenderedText( std::string textureText, SDL_Color textColor, TTF_Font *Font );
-		#endif
-
-		// Texture deallocation
-		void free();
-
-		// Sets color modulation
-		void setColorMod(Uint8 red, Uint8 green, Uint8 blue);
-
-		// Sets blending
-		void setBlendMode(SDL_BlendMode blending);
-
-		// Sets alpha modulation
-		void setAlphaMod(Uint8 alpha);
-
-		// Renders texture at point
-		void render(int x, int y, SDL_Rect *clip = NULL, double angle = 0.0, SDL_Point *center = NULL, SDL_RendererFlip flip = SDL_FLIP_NONE);
-
-		// Gets image dimensions (mWidth, mHeight)
-		int getWidth();
-		int getHeight();
-
-	private:
-		// The actual texture
-		SDL_Texture* mTexture;
-
-		// Image dimensions
-		int mWidth;
-		int mHeight;
-};
+// Printable ASCII glyphs of one font, rendered once into a single texture
+class GlyphAtlas
+{
+	public:
+		// Initialization
+		GlyphAtlas();
+
+		// Deallocation
+		~GlyphAtlas();
+
+		// Rasterizes every glyph of the font (white, tint with setColorMod)
+		bool loadFromFont(TTF_Font *Font);
+
+		// Atlas deallocation
+		void free();
+
+		// Sets color and alpha modulation for following render() calls
+		void setColorMod(Uint8 red, Uint8 green, Uint8 blue);
+		void setAlphaMod(Uint8 alpha);
+
+		// Draws a string as atlas quads (no rasterizing or uploads)
+		void render(int x, int y, const char *text);
 
-// Initializes SDL
-bool init();
+		// Gets string width and line height in pixels
+		int measure(const char *text);
+		int getHeight();
+
+		// First glyph and number of glyphs in the atlas (' ' to '~')
+		static const int FIRST_GLYPH = 32;
+		static const int GLYPH_COUNT = 95;
+
+	private:
+		// The whole glyph sheet
+		SDL_Texture *mTexture;
+
+		// Where each glyph sits in the sheet and how far it moves the pen
+		SDL_Rect mClips[GLYPH_COUNT];
+		int mAdvance[GLYPH_COUNT];
+
+		int mHeight;
+};
+
+// Most quads one SpriteBatch holds before it flushes on its own
+const int MAX_BATCH_QUADS = 1024;
+
+// Collects quads that share a texture and draws them with one SDL_RenderGeometry call
+class SpriteBatch
+{
+	public:
+		// Initialization (allocates vertex/index storage once)
+		SpriteBatch(int maxQuads = MAX_BATCH_QUADS);
+
+		// Queues a sprite at point (flushes first if it's on a different texture)
+		void add(LTexture &sprite, int x, int y);
+
+		// Draws everything queued
+		void flush();
+
+	private:
+		// Texture of the queued quads and its size (for texture coordinates)
+		SDL_Texture *mTexture;
+		int mTextureWidth;
+		int mTextureHeight;
+
+		int mQuads;
+		int mMaxQuads;
+		std::vector<SDL_Vertex> mVertices;
+		std::vector<int> mIndices;
+};
+
+// Initializes SDL
+bool init();
 
 // Loads media
 bool loadMedia();
@@ -78,8 +125,70 @@ void close();
 // Creates window object
 SDL_Window *gWindow = NULL;
 
-// Creates window renderer
-SDL_Renderer *gRenderer = NULL;
+// Print draw calls per frame once a second (--draw-stats)
+bool gDrawStats = false;
+
+// Print per-asset load timings (--load-stats)
+bool gLoadStats = false;
+
+// Input to present latency, printed once a second with --input-stats
+InputLatency gInputLatency;
+bool gInputStats = false;
+
+// Sample input right before presenting, with ticks waiting briefly for that sample (--late-input)
+bool gLateInput = false;
+
+// Longest a late input tick waits for a sample, and how old a sample it takes without waiting
+const double LATE_INPUT_WAIT_TICKS = 0.5;
+const Uint32 LATE_INPUT_GRACE_MS = 1;
+
+// Per-phase frame timings; F3 (or --profile) toggles the overlay, F4 writes them to PROFILE_CSV_PATH
+FrameProfiler gProfiler;
+bool gShowProfiler = false;
+const char *PROFILE_CSV_PATH = "frame_profile.csv";
+
+// Wave file to play (--waves), the built-in waves are used without one
+const char *gWaveFile = NULL;
+WaveScript gWaveScript;
+
+// The original three levels
+const char *DEFAULT_WAVES =
+    "wave 2000\n"
+    "spawn 2000 raider\n"
+    "drop speed\n"
+    "wave 1500\n"
+    "spawn 1500 striker\n"
+    "drop damage\n"
+    "wave 1500\n"
+    "spawn 1500 thrasher\n";
+
+// Software rendering (--software, or when there's no accelerated renderer) draws straight into
+// the window surface and only redraws and shows the parts of the screen that changed
+bool gSoftware = false;
+
+// Headless runs have no window; the renderer draws into this surface instead
+bool gHeadless = false;
+SDL_Surface *gHeadlessSurface = NULL;
+
+// Seed for the session's random numbers (--seed, or taken from the replay)
+unsigned int gSeed = 1;
+
+// Per-tick input is written to gRecorder (--record FILE) and/or read from gReplay (--replay FILE)
+ReplayRecorder gRecorder;
+ReplayPlayer gReplay;
+
+// Headless runs can draw every tick and hash frames against a golden list (--golden FILE),
+// or write a new list (--golden-write FILE); --render-times FILE keeps each frame's render time
+const char *gGoldenPath = NULL;
+bool gGoldenWrite = false;
+const char *gRenderTimesPath = NULL;
+GoldenFrames gGoldenFrames;
+
+// Worker threads for the per-tick jobs (--workers N, 0 runs every job on the simulation thread)
+JobSystem gJobs;
+
+// Temporaries for one simulation tick, reset after every tick (only the thread running the simulation uses it)
+FrameArena gTickArena;
 
 //Game Controller 1 handler
 SDL_Joystick* gGameController = NULL;
@@ -87,8 +196,11 @@ SDL_Joystick* gGameController = NULL;
 TTF_Font *titleFont = NULL;
 TTF_Font *pressStartFont = NULL;
 
+// Background streams in tiles from its image (which, when packed, stays in the mapped pack)
+ScrollingBackground gBackground;
+AssetPack gAssetPack;
+
 // Creates scene textures
-LTexture gBackgroundTexture;
 LTexture gFighterSprite;
 LTexture gTurretSprite;
 LTexture gBulletSprite;
@@ -108,151 +220,343 @@ LTexture gThrasherSprite;
 LTexture gThrasherDam1Sprite;
 LTexture gThrasherDam2Sprite;
 LTexture gThrasherDam3Sprite;
+
+// Enemy sprites by type and damage state
+LTexture *gEnemySprites[ENEMY_TYPE_COUNT][DAMAGE_STATES] = {
+    {&gRaiderSprite, &gRaiderDam1Sprite, &gRaiderDam2Sprite, &gRaiderDam3Sprite},
+    {&gStrikerSprite, &gStrikerDam1Sprite, &gStrikerDam2Sprite, &gStrikerDam3Sprite},
+    {&gThrasherSprite, &gThrasherDam1Sprite, &gThrasherDam2Sprite, &gThrasherDam3Sprite}
+};
 LTexture gWinnerSprite;
 LTexture gSpeedSprite;
 LTexture gDamageSprite;
 LTexture gTextTextureStar;
 LTexture gTextTextureCollider;
-LTexture gTextTextureLevel1;
-LTexture gTextTextureLevel2;
-LTexture gTextTextureLevel3;
 LTexture gTextTextureGame;
 LTexture gTextTextureOver;
-LTexture gPressStartTexture;
+
+// Glyph atlases for each font
+GlyphAtlas gTitleGlyphs;
+GlyphAtlas gPressStartGlyphs;
+
+const char *PRESS_START_TEXT = "Press space to start";
+
+// Batches projectiles and items
+SpriteBatch gSpriteBatch;
+
+// Sprites packed into the texture atlas at load time
+struct SpriteFile
+{
+	LTexture *texture;
+	const char *path;
+};
+
+SpriteFile gSpriteFiles[] = {
+	{&gFighterSprite, "DS_Game/fighterspr.png"},
+	{&gTurretSprite, "DS_Game/turretspr.png"},
+	{&gBulletSprite, "DS_Game/bulletspr.png"},
+	{&gABulletSprite, "DS_Game/abulletspr.png"},
+	{&gHealthSprite, "DS_Game/healthspr.png"},
+	{&gAmmoSprite, "DS_Game/ammospr.png"},
+	{&gRaiderSprite, "DS_Game/raiderspr.png"},
+	{&gRaiderDam1Sprite, "DS_Game/raidersprdam1.png"},
+	{&gRaiderDam2Sprite, "DS_Game/raidersprdam2.png"},
+	{&gRaiderDam3Sprite, "DS_Game/raidersprdam3.png"},
+	{&gStrikerSprite, "DS_Game/strikerspr.png"},
+	{&gStrikerDam1Sprite, "DS_Game/strikersprdam1.png"},
+	{&gStrikerDam2Sprite, "DS_Game/strikersprdam2.png"},
+	{&gStrikerDam3Sprite, "DS_Game/strikersprdam3.png"},
+	{&gThrasherSprite, "DS_Game/thrasherspr.png"},
+	{&gThrasherDam1Sprite, "DS_Game/thrashersprdam1.png"},
+	{&gThrasherDam2Sprite, "DS_Game/thrashersprdam2.png"},
+	{&gThrasherDam3Sprite, "DS_Game/thrashersprdam3.png"},
+	{&gWinnerSprite, "DS_Game/winnerspr.png"},
+	{&gSpeedSprite, "DS_Game/speedspr.png"},
+	{&gDamageSprite, "DS_Game/damgspr.png"},
+};
+const int SPRITE_FILE_COUNT = sizeof(gSpriteFiles)/sizeof(gSpriteFiles[0]);
+
+// Largest atlas page (clamped further to what the renderer supports)
+const int ATLAS_PAGE_SIZE = 2048;
+
+// Smallest square tried first when packing; it doubles until everything fits on one page
+const int ATLAS_MIN_PAGE_SIZE = 256;
+
+// Packs rects on pages of the smallest square (from ATLAS_MIN_PAGE_SIZE, doubling) that holds them all on
+// one, up to the largest page the renderer supports (put in pageSize)
+// Returns the number of pages used, or -1 if a rect doesn't fit even the largest page
+int packAtlas(std::vector<PackRect> &rects, int &pageSize)
+{
+	pageSize = ATLAS_PAGE_SIZE;
+	SDL_RendererInfo info;
+	if (SDL_GetRendererInfo(gRenderer, &info) == 0) {
+		if (info.max_texture_width > 0 && info.max_texture_width < pageSize) { pageSize = info.max_texture_width; }
+		if (info.max_texture_height > 0 && info.max_texture_height < pageSize) { pageSize = info.max_texture_height; }
+	}
+
+	int packSize = ATLAS_MIN_PAGE_SIZE < pageSize ? ATLAS_MIN_PAGE_SIZE : pageSize;
+	int pageCount = packRects(rects, packSize, packSize, 1);
+	while (pageCount != 1 && packSize < pageSize) {
+		packSize = packSize*2 < pageSize ? packSize*2 : pageSize;
+		pageCount = packRects(rects, packSize, packSize, 1);
+	}
+	return pageCount;
+}
+
+// Atlas page textures (owned here, the sprites are views into them)
+std::vector<SDL_Texture*> gAtlasPages;
+
+// Most threads decoding images at startup
+const int MAX_DECODE_THREADS = 8;
+
+// Pre-decoded images (built by MakeAssetPack); PNGs not in it are decoded as usual
+const char *ASSET_PACK_PATH = "DS_Game/assets.pack";
+const char *BACKGROUND_PATH = "DS_Game/backgroundtxtr.png";
 
 //The music that will be played
 Mix_Music *gMusic = NULL;
 Mix_Music *gIdleMusic = NULL;
 
-LTexture::LTexture()
-{
-	// Initialize texture stuff
-	mTexture = NULL;
-	mWidth = 0;
-	mHeight = 0;
-}
-
-LTexture::~LTexture()
-{
-	// Deallocate texture stuff
-	free();
+// Sound effects, played from the simulation thread
+SoundEffects gSfx;
+
+// Audio buffer in sample frames (--audio-buffer N), smaller is lower latency but risks dropouts
+int gAudioBuffer = DEFAULT_AUDIO_BUFFER;
+
+// Print sound effect counts and latency once a second (--audio-stats)
+bool gAudioStats = false;
+
+GlyphAtlas::GlyphAtlas()
+{
+	// Initialize atlas stuff
+	mTexture = NULL;
+	mHeight = 0;
+	for (int i = 0; i < GLYPH_COUNT; i++) {
+		mClips[i].x = mClips[i].y = mClips[i].w = mClips[i].h = 0;
+		mAdvance[i] = 0;
+	}
 }
 
-bool LTexture::loadFromFile (std::string path)
-{
-	// Deallocate preexisting texture
-	free();
-
-	// The usable texture
-	SDL_Texture *newTexture = NULL;
-
-	// Load image from path
-	SDL_Surface *loadedSurface = IMG_Load(path.c_str());
-	if (!loadedSurface) {
-        // Spits out specific error if something goes wrong
-		printf("Unable to load image %s. SDL_image Error: %s\n", path.c_str(), IMG_GetError());
-	} else {
-		// Color keys the image
-		SDL_SetColorKey(loadedSurface, SDL_TRUE, SDL_MapRGB(loadedSurface->format, 0, 0xFF, 0xFF));
-
-		// Creates texture from surface
-        newTexture = SDL_CreateTextureFromSurface(gRenderer, loadedSurface);
-		if (!newTexture) {
-            // Spits out specific error if something goes wrong
-			printf("Unable to create texture from %s. SDL Error: %s\n", path.c_str(), SDL_GetError());
-		} else {
-			// Gets image dimensions
-			mWidth = loadedSurface->w;
-			mHeight = loadedSurface->h;
-		}
-
-		// Gets rid of the old surface
-		SDL_FreeSurface(loadedSurface);
-	}
-
-	// Return success
-	mTexture = newTexture;
-	return mTexture != NULL;
+GlyphAtlas::~GlyphAtlas()
+{
+	// Deallocate atlas stuff
+	free();
 }
 
-#ifdef _SDL_TTF_H
-bool LTexture::loadFromRenderedText (std::string textureText, SDL_Color textColor, TTF_Font *Font)
-{
-	// Gets rid of the preexisting texture
-	free();
-
-	// Renders text surface
-	SDL_Surface *textSurface = TTF_RenderText_Solid(Font, textureText.c_str(), textColor);
-	if (!textSurface) {
-        printf("Unable to render text surface. SDL_ttf Error: %s\n", TTF_GetError());
-	} else {
-		// Creates texture from surface
-        mTexture = SDL_CreateTextureFromSurface(gRenderer, textSurface);
+bool GlyphAtlas::loadFromFont (TTF_Font *Font)
+{
+	// Deallocate preexisting atlas
+	free();
+
+	SDL_Color white = {255, 255, 255, 255};
+	SDL_Surface *glyphs[GLYPH_COUNT];
+
+	// Renders each glyph
+	std::vector<PackRect> rects(GLYPH_COUNT);
+	int lineHeight = 0;
+	for (int i = 0; i < GLYPH_COUNT; i++) {
+		glyphs[i] = TTF_RenderGlyph_Solid(Font, FIRST_GLYPH+i, white);
+		int advance = 0;
+		if (TTF_GlyphMetrics(Font, FIRST_GLYPH+i, NULL, NULL, NULL, NULL, &advance) == -1 && glyphs[i]) {
+			advance = glyphs[i]->w;
+		}
+		mAdvance[i] = advance;
+		rects[i].w = glyphs[i] ? glyphs[i]->w : 0;
+		rects[i].h = glyphs[i] ? glyphs[i]->h : 0;
+		if (rects[i].h > lineHeight) { lineHeight = rects[i].h; }
+	}
+
+	// Lays them out in rows on one sheet the renderer can hold (one row of a big font can be too wide)
+	int pageSize;
+	int sheetWidth = 0;
+	int sheetHeight = 0;
+	if (packAtlas(rects, pageSize) != 1) {
+		printf("Unable to fit every glyph on one %dx%d sheet.\n", pageSize, pageSize);
+	} else {
+		for (int i = 0; i < GLYPH_COUNT; i++) {
+			SDL_Rect clip = {rects[i].x, rects[i].y, rects[i].w, rects[i].h};
+			mClips[i] = clip;
+			if (clip.x+clip.w > sheetWidth) { sheetWidth = clip.x+clip.w; }
+			if (clip.y+clip.h > sheetHeight) { sheetHeight = clip.y+clip.h; }
+		}
+	}
+
+	// Copies every glyph into a transparent sheet
+	SDL_Surface *sheet = NULL;
+	if (sheetWidth > 0 && sheetHeight > 0) {
+		sheet = SDL_CreateRGBSurfaceWithFormat(0, sheetWidth, sheetHeight, 32, SDL_PIXELFORMAT_RGBA32);
+	}
+	if (!sheet) {
+		printf("Unable to create glyph sheet. SDL Error: %s\n", SDL_GetError());
+	} else {
+		SDL_FillRect(sheet, NULL, SDL_MapRGBA(sheet->format, 0, 0, 0, 0));
+		for (int i = 0; i < GLYPH_COUNT; i++) {
+			if (glyphs[i]) {
+				SDL_Rect dest = mClips[i];
+				SDL_BlitSurface(glyphs[i], NULL, sheet, &dest);
+			}
+		}
+
+		// Creates texture from sheet
+		mTexture = SDL_CreateTextureFromSurface(gRenderer, sheet);
 		if (!mTexture) {
-            // Spits out specific error if something goes wrong
-			printf("Unable to create texture from rendered text. SDL Error: %s\n", SDL_GetError());
-		} else {
-			// Gets image dimensions
-			mWidth = textSurface->w;
-			mHeight = textSurface->h;
-		}
-
-		// Gets rid of old surface
-		SDL_FreeSurface( textSurface );
-	}
-
-	// Return success
-	return mTexture != NULL;
-}
-#endif
-
-void LTexture::free()
-{
-	// If texture exists, free it
-	if (mTexture) {
-		SDL_DestroyTexture(mTexture);
-		mTexture = NULL;
-		mWidth = 0;
-		mHeight = 0;
-	}
-}
-
-void LTexture::setColorMod (Uint8 red, Uint8 green, Uint8 blue)
-{
-	// Modulates texture RGB
-	SDL_SetTextureColorMod(mTexture, red, green, blue);
+			printf("Unable to create glyph atlas texture. SDL Error: %s\n", SDL_GetError());
+		} else {
+			SDL_SetTextureBlendMode(mTexture, SDL_BLENDMODE_BLEND);
+			mHeight = lineHeight;
+		}
+
+		SDL_FreeSurface(sheet);
+	}
+
+	// Gets rid of the glyph surfaces
+	for (int i = 0; i < GLYPH_COUNT; i++) {
+		SDL_FreeSurface(glyphs[i]);
+	}
+
+	// Return success
+	return mTexture != NULL;
 }
 
-void LTexture::setBlendMode (SDL_BlendMode blending)
-{
-	// Sets blending function
-	SDL_SetTextureBlendMode(mTexture, blending);
-}
-
-void LTexture::setAlphaMod (Uint8 alpha)
-{
-	// Modulates texture alpha (transparency)
-	SDL_SetTextureAlphaMod(mTexture, alpha);
-}
-
-void LTexture::render (int x, int y, SDL_Rect* clip, double angle, SDL_Point* center, SDL_RendererFlip flip)
-{
-	// Set rendering space in window
-	SDL_Rect renderQuad = {x, y, mWidth, mHeight};
-
-	// Sets clip rendering dimensions
-	if (clip) {
-		renderQuad.w = clip->w;
-		renderQuad.h = clip->h;
-	}
-
-	// Renders to screen
-	SDL_RenderCopyEx(gRenderer, mTexture, clip, &renderQuad, angle, center, flip);
-}
-
-int LTexture::getWidth() { return mWidth; }
-
-int LTexture::getHeight() { return mHeight; }
+void GlyphAtlas::free()
+{
+	// If atlas exists, free it
+	if (mTexture) {
+		SDL_DestroyTexture(mTexture);
+		mTexture = NULL;
+		mHeight = 0;
+	}
+}
+
+void GlyphAtlas::setColorMod (Uint8 red, Uint8 green, Uint8 blue)
+{
+	// Modulates atlas RGB
+	SDL_SetTextureColorMod(mTexture, red, green, blue);
+}
+
+void GlyphAtlas::setAlphaMod (Uint8 alpha)
+{
+	// Modulates atlas alpha (transparency)
+	SDL_SetTextureAlphaMod(mTexture, alpha);
+}
+
+void GlyphAtlas::render (int x, int y, const char *text)
+{
+	for (const char *c = text; *c; c++) {
+		int i = (unsigned char)*c - FIRST_GLYPH;
+		if (i < 0 || i >= GLYPH_COUNT) { continue; }
+
+		// Renders glyph quad (or records it for a partial redraw) and moves the pen
+		SDL_Rect renderQuad = {x, y, mClips[i].w, mClips[i].h};
+		if (gDirty.isRecording()) {
+			gDirty.record(renderQuad, drawKey(mTexture, mClips[i], getTextureModulation(mTexture)));
+		} else {
+			SDL_RenderCopy(gRenderer, mTexture, &mClips[i], &renderQuad);
+			gDrawCalls++;
+		}
+		x += mAdvance[i];
+	}
+}
+
+int GlyphAtlas::measure (const char *text)
+{
+	int width = 0;
+	for (const char *c = text; *c; c++) {
+		int i = (unsigned char)*c - FIRST_GLYPH;
+		if (i >= 0 && i < GLYPH_COUNT) { width += mAdvance[i]; }
+	}
+	return width;
+}
+
+int GlyphAtlas::getHeight() { return mHeight; }
+
+SpriteBatch::SpriteBatch(int maxQuads)
+{
+	mTexture = NULL;
+	mTextureWidth = 0;
+	mTextureHeight = 0;
+	mQuads = 0;
+	mMaxQuads = maxQuads;
+	mVertices.resize(maxQuads*4);
+
+	// Two triangles per quad, same pattern every time
+	mIndices.resize(maxQuads*6);
+	for (int q = 0; q < maxQuads; q++) {
+		mIndices[q*6+0] = q*4+0;
+		mIndices[q*6+1] = q*4+1;
+		mIndices[q*6+2] = q*4+2;
+		mIndices[q*6+3] = q*4+2;
+		mIndices[q*6+4] = q*4+1;
+		mIndices[q*6+5] = q*4+3;
+	}
+}
+
+void SpriteBatch::add (LTexture &sprite, int x, int y)
+{
+	SDL_Texture *texture = sprite.getTexture();
+	if (!texture) { return; }
+
+	// One texture per batch
+	if (texture != mTexture || mQuads == mMaxQuads) {
+		flush();
+		mTexture = texture;
+		SDL_QueryTexture(texture, NULL, NULL, &mTextureWidth, &mTextureHeight);
+	}
+
+	SDL_Rect src = sprite.getSourceRect();
+	SDL_Color color = sprite.getModulation();
+
+	// Partial redraws record the quad instead of batching it
+	if (gDirty.isRecording()) {
+		SDL_Rect dest = {x, y, src.w, src.h};
+		gDirty.record(dest, drawKey(texture, src, color));
+		return;
+	}
+	float u0 = (float)src.x/mTextureWidth;
+	float v0 = (float)src.y/mTextureHeight;
+	float u1 = (float)(src.x+src.w)/mTextureWidth;
+	float v1 = (float)(src.y+src.h)/mTextureHeight;
+
+	// Corners: top left, top right, bottom left, bottom right
+	SDL_Vertex *v = &mVertices[mQuads*4];
+	v[0].position.x = x;       v[0].position.y = y;       v[0].tex_coord.x = u0; v[0].tex_coord.y = v0;
+	v[1].position.x = x+src.w; v[1].position.y = y;       v[1].tex_coord.x = u1; v[1].tex_coord.y = v0;
+	v[2].position.x = x;       v[2].position.y = y+src.h; v[2].tex_coord.x = u0; v[2].tex_coord.y = v1;
+	v[3].position.x = x+src.w; v[3].position.y = y+src.h; v[3].tex_coord.x = u1; v[3].tex_coord.y = v1;
+	for (int i = 0; i < 4; i++) {
+		v[i].color = color;
+	}
+	mQuads++;
+}
+
+void SpriteBatch::flush()
+{
+	if (mQuads == 0 || !mTexture) {
+		mQuads = 0;
+		return;
+	}
+
+	#if SDL_VERSION_ATLEAST(2, 0, 18)
+	// Vertex colors carry the modulation, so the shared texture's own is reset
+	SDL_SetTextureColorMod(mTexture, 0xFF, 0xFF, 0xFF);
+	SDL_SetTextureAlphaMod(mTexture, 0xFF);
+	SDL_RenderGeometry(gRenderer, mTexture, &mVertices[0], mQuads*4, &mIndices[0], mQuads*6);
+	gDrawCalls++;
+	#else
+	// No geometry API, falls back to one copy per quad
+	for (int q = 0; q < mQuads; q++) {
+		SDL_Vertex *v = &mVertices[q*4];
+		SDL_Rect src = {(int)(v[0].tex_coord.x*mTextureWidth+.5f), (int)(v[0].tex_coord.y*mTextureHeight+.5f), (int)(v[3].position.x-v[0].position.x), (int)(v[3].position.y-v[0].position.y)};
+		SDL_Rect dst = {(int)v[0].position.x, (int)v[0].position.y, src.w, src.h};
+		SDL_SetTextureColorMod(mTexture, v[0].color.r, v[0].color.g, v[0].color.b);
+		SDL_SetTextureAlphaMod(mTexture, v[0].color.a);
+		SDL_RenderCopy(gRenderer, mTexture, &src, &dst);
+		gDrawCalls++;
+	}
+	#endif
+
+	mQuads = 0;
+}
 
 
 bool init()
@@ -260,7 +564,13 @@ bool init()
     // Initialization success flag
 	bool success = true;
 
-	// Initializes SDL
+	// Headless runs use SDL's dummy drivers (no display or sound card needed)
+	if (gHeadless) {
+		SDL_setenv("SDL_VIDEODRIVER", "dummy", 1);
+		SDL_setenv("SDL_AUDIODRIVER", "dummy", 1);
+	}
+
+	// Initializes SDL
 	if (SDL_Init(SDL_INIT_VIDEO | SDL_INIT_JOYSTICK | SDL_INIT_AUDIO) < 0) {
 		printf("SDL could not initialize. SDL Error: %s\n", SDL_GetError());
 		success = false;
@@ -281,17 +591,37 @@ bool init()
 			}
 		}
 
-		// Creates window
-		gWindow = SDL_CreateWindow("Star Collider", SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED, SCREEN_WIDTH, SCREEN_HEIGHT, SDL_WINDOW_SHOWN);
-		if (!gWindow) {
-			printf("Window could not be created. SDL Error: %s\n", SDL_GetError());
-			success = false;
+		// Creates window (or an offscreen surface when headless)
+		if (gHeadless) {
+			gHeadlessSurface = SDL_CreateRGBSurfaceWithFormat(0, SCREEN_WIDTH, SCREEN_HEIGHT, 32, SDL_PIXELFORMAT_RGBA32);
+		} else {
+			gWindow = SDL_CreateWindow("Star Collider", SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED, SCREEN_WIDTH, SCREEN_HEIGHT, SDL_WINDOW_SHOWN);
+		}
+		if (!gWindow && !gHeadlessSurface) {
+			printf("Window could not be created. SDL Error: %s\n", SDL_GetError());
+			success = false;
+		} else if (gHeadless) {
+			// Software renderer so textures still load (sprite sizes drive the game logic)
+			gRenderer = SDL_CreateSoftwareRenderer(gHeadlessSurface);
 		} else {
 		    SDL_Surface *icon = IMG_Load("DS_Game/icon.png");
 		    SDL_SetWindowIcon(gWindow, icon);
-		    SDL_FreeSurface(icon);
-			// Creates renderer for window (vsync so frame rate cooperates)
-			gRenderer = SDL_CreateRenderer(gWindow, -1, SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC);
+		    SDL_FreeSurface(icon);
+			// Creates renderer for window (vsync so frame rate cooperates)
+			if (!gSoftware) {
+				gRenderer = SDL_CreateRenderer(gWindow, -1, SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC);
+				if (!gRenderer) {
+					printf("Warning: No accelerated renderer, drawing in software. SDL Error: %s\n", SDL_GetError());
+					gSoftware = true;
+				}
+			}
+			if (gSoftware) {
+				SDL_Surface *windowSurface = SDL_GetWindowSurface(gWindow);
+				if (windowSurface)
+					gRenderer = SDL_CreateSoftwareRenderer(windowSurface);
+			}
+		}
+		if (gWindow || gHeadlessSurface) {
 			if (!gRenderer) {
 				printf("Renderer could not be created. SDL Error: %s\n", SDL_GetError());
 				success = false;
@@ -313,7 +643,7 @@ bool init()
                 }
 
                 // Initialize SDL_mixer
-                if (Mix_OpenAudio(44100, MIX_DEFAULT_FORMAT, 2, 2048) < 0) {
+                if (Mix_OpenAudio(44100, MIX_DEFAULT_FORMAT, 2, gAudioBuffer) < 0) {
                     printf("SDL_mixer could not initialize. SDL_mixer Error: %s\n", Mix_GetError());
                     success = false;
                 }
@@ -324,11 +654,138 @@ bool init()
 	return success;
 }
 
-bool loadMedia()
-{
-	// Loading success flag
-	bool success = true;
+// Milliseconds since a performance counter reading
+double msSince(Uint64 counter)
+{
+	return (double)(SDL_GetPerformanceCounter()-counter)*1000/SDL_GetPerformanceFrequency();
+}
+
+// Packs decoded sprites (from loadKeyedImage) onto as few textures as possible
+// The surfaces stay with the caller; NULL ones are skipped
+bool buildSpriteAtlas(SpriteFile *sprites, SDL_Surface **surfaces, int count)
+{
+	// Loading success flag
+	bool success = true;
+
+	std::vector<PackRect> rects(count);
+	for (int i = 0; i < count; i++) {
+		rects[i].w = surfaces[i] ? surfaces[i]->w : 0;
+		rects[i].h = surfaces[i] ? surfaces[i]->h : 0;
+	}
+
+	// A few small sprites shouldn't get a 16 MB page
+	int pageSize;
+	int pageCount = packAtlas(rects, pageSize);
+	if (pageCount < 0) {
+		printf("Unable to pack sprites into %dx%d atlas pages.\n", pageSize, pageSize);
+		success = false;
+	}
+
+	// Blits each page together and uploads it
+	for (int page = 0; page < pageCount; page++) {
+		// Cropped to the part of the page the packer used
+		int pageWidth = 1;
+		int pageHeight = 1;
+		for (int i = 0; i < count; i++) {
+			if (surfaces[i] && rects[i].page == page) {
+				if (rects[i].x+rects[i].w > pageWidth) { pageWidth = rects[i].x+rects[i].w; }
+				if (rects[i].y+rects[i].h > pageHeight) { pageHeight = rects[i].y+rects[i].h; }
+			}
+		}
+
+		SDL_Surface *pageSurface = SDL_CreateRGBSurfaceWithFormat(0, pageWidth, pageHeight, 32, SDL_PIXELFORMAT_RGBA32);
+		if (!pageSurface) {
+			printf("Unable to create atlas page. SDL Error: %s\n", SDL_GetError());
+			success = false;
+			continue;
+		}
+		SDL_FillRect(pageSurface, NULL, SDL_MapRGBA(pageSurface->format, 0, 0, 0, 0));
+		for (int i = 0; i < count; i++) {
+			if (surfaces[i] && rects[i].page == page) {
+				SDL_Rect dest = {rects[i].x, rects[i].y, rects[i].w, rects[i].h};
+				SDL_BlitSurface(surfaces[i], NULL, pageSurface, &dest);
+			}
+		}
+
+		SDL_Texture *pageTexture = SDL_CreateTextureFromSurface(gRenderer, pageSurface);
+		if (!pageTexture) {
+			printf("Unable to create atlas texture. SDL Error: %s\n", SDL_GetError());
+			success = false;
+		} else {
+			SDL_SetTextureBlendMode(pageTexture, SDL_BLENDMODE_BLEND);
+			gAtlasPages.push_back(pageTexture);
+
+			// Points the sprites at their part of the page
+			for (int i = 0; i < count; i++) {
+				if (surfaces[i] && rects[i].page == page) {
+					SDL_Rect view = {rects[i].x, rects[i].y, rects[i].w, rects[i].h};
+					sprites[i].texture->setView(pageTexture, view);
+					sprites[i].texture->buildMask(surfaces[i]);
+				}
+			}
+		}
+		SDL_FreeSurface(pageSurface);
+	}
+
+	return success;
+}
+
+// Loads the waves from --waves, or the built-in ones
+// (before any media, since replays and recordings are tied to the script)
+bool loadWaves()
+{
+	if (gWaveFile) {
+		if (!gWaveScript.loadFromFile(gWaveFile)) {
+			printf("Failed to load waves.\n");
+			return false;
+		}
+		return true;
+	}
+	return gWaveScript.parse(DEFAULT_WAVES, "built-in waves");
+}
+
+bool loadMedia()
+{
+	// Loading success flag
+	bool success = true;
+
+	Uint64 loadStart = SDL_GetPerformanceCounter();
+
+	// Every image: background first, then the sprites
+	const int backgroundImage = 0;
+	const int firstSpriteImage = 1;
+	std::vector<const char*> imagePaths;
+	imagePaths.push_back(BACKGROUND_PATH);
+	for (int i = 0; i < SPRITE_FILE_COUNT; i++) {
+		imagePaths.push_back(gSpriteFiles[i].path);
+	}
+	std::vector<SDL_Surface*> imageSurfaces(imagePaths.size(), (SDL_Surface*)NULL);
+
+	// Images in the asset pack are used straight from the mapped file
+	bool havePack = gAssetPack.open(ASSET_PACK_PATH);
+	std::vector<int> packedImages;
+
+	// The rest decode on worker threads while fonts and music load here
+	ImageDecoder decoder;
+	std::vector<int> decodedImages;
+	for (size_t i = 0; i < imagePaths.size(); i++) {
+		if (havePack) {
+			imageSurfaces[i] = gAssetPack.createSurface(imagePaths[i]);
+		}
+		if (imageSurfaces[i]) {
+			packedImages.push_back((int)i);
+		} else {
+			decoder.add(imagePaths[i]);
+			decodedImages.push_back((int)i);
+		}
+	}
+	if (!decodedImages.empty()) {
+		int threadCount = SDL_GetCPUCount()-1;
+		if (threadCount > MAX_DECODE_THREADS) { threadCount = MAX_DECODE_THREADS; }
+		decoder.start(threadCount);
+	}
 
+	Uint64 stepStart = SDL_GetPerformanceCounter();
 	titleFont = TTF_OpenFont("DS_Game/titlefont.ttf", 72);
 	pressStartFont = TTF_OpenFont("DS_Game/titlefont.ttf", 24);
     if (titleFont == NULL) {
@@ -345,18 +802,6 @@ bool loadMedia()
             printf("Failed to render text texture.\n");
             success = false;
         }
-        if (!gTextTextureLevel1.loadFromRenderedText("level 1", textColor, titleFont)) {
-            printf("Failed to render text texture.\n");
-            success = false;
-        }
-        if (!gTextTextureLevel2.loadFromRenderedText("level 2", textColor, titleFont)) {
-            printf("Failed to render text texture.\n");
-            success = false;
-        }
-        if (!gTextTextureLevel3.loadFromRenderedText("level 3", textColor, titleFont)) {
-            printf("Failed to render text texture.\n");
-            success = false;
-        }
         if (!gTextTextureGame.loadFromRenderedText("Game", textColor, titleFont)) {
             printf("Failed to render text texture.\n");
             success = false;
@@ -365,31 +810,84 @@ bool loadMedia()
             printf("Failed to render text texture.\n");
             success = false;
         }
+        if (!gTitleGlyphs.loadFromFont(titleFont)) {
+            printf("Failed to build title glyph atlas.\n");
+            success = false;
+        }
     }
-
-	// Load textures
-	if (!gBackgroundTexture.loadFromFile("DS_Game/backgroundtxtr.png")) {
-        printf("Failed to load backgroundtxtr.png.\n");
+    if (pressStartFont == NULL) {
+        printf("Failed to load press start font. SDL_ttf Error: %s\n", TTF_GetError());
+        success = false;
+    } else if (!gPressStartGlyphs.loadFromFont(pressStartFont)) {
+        printf("Failed to build press start glyph atlas.\n");
         success = false;
-	}
-    if (!gFighterSprite.loadFromFile("DS_Game/fighterspr.png")) {
-        printf("Failed to load fighterspr.png texture.\n");
-        success = false;
     }
-    if (!gTurretSprite.loadFromFile("DS_Game/turretspr.png")) {
-        printf("Failed to load turretspr.png texture.\n");
+    if (gLoadStats) {
+        printf("Loaded %-36s %8.2f ms\n", "fonts and text", msSince(stepStart));
+    }
+
+    stepStart = SDL_GetPerformanceCounter();
+    gMusic = Mix_LoadMUS("DS_Game/Chase_The_Ace.mp3");
+    if (!gMusic) {
+        printf("Failed to load DS_Game/Chase_The_Ace.mp3. SDL_mixer Error: %s\n", Mix_GetError());
         success = false;
     }
-    if (!gBulletSprite.loadFromFile("DS_Game/bulletspr.png")) {
-        printf("Failed to load bulletspr.png.\n");
+    gIdleMusic = Mix_LoadMUS("DS_Game/DT.mp3");
+    if (!gIdleMusic) {
+        printf("Failed to load DS_Game/DT.mp3. SDL_Mixer Error: %s\n", Mix_GetError());
         success = false;
     }
-    if (!gABulletSprite.loadFromFile("DS_Game/abulletspr.png")) {
-        printf("Failed to loadabulletspr.png.\n");
+    if (!gSfx.load(gAudioBuffer)) {
+        printf("Failed to load sound effects.\n");
         success = false;
     }
-    if (!gHealthSprite.loadFromFile("DS_Game/healthspr.png")) {
-        printf("Failed to load healthspr.png.\n");
+    if (gLoadStats) {
+        printf("Loaded %-36s %8.2f ms\n", "music", msSince(stepStart));
+    }
+
+	// Creates textures as images become ready (packed ones first, then as workers finish)
+	size_t nextPacked = 0;
+	while (true) {
+		int image;
+		double decodeMs = 0;
+		bool fromPack = nextPacked < packedImages.size();
+		if (fromPack) {
+			image = packedImages[nextPacked++];
+		} else {
+			int job = decoder.next();
+			if (job < 0) { break; }
+			image = decodedImages[job];
+			imageSurfaces[image] = decoder.takeSurface(job);
+			decodeMs = decoder.getDecodeMs(job);
+		}
+
+		double uploadMs = 0;
+		if (!imageSurfaces[image]) {
+			printf("Failed to load %s.\n", imagePaths[image]);
+			success = false;
+		} else if (image == backgroundImage) {
+			stepStart = SDL_GetPerformanceCounter();
+			// The background keeps its image to stream tiles from
+			if (!gBackground.load(imageSurfaces[image])) {
+				printf("Failed to load backgroundtxtr.png.\n");
+				success = false;
+			}
+			imageSurfaces[image] = NULL;
+			uploadMs = msSince(stepStart);
+		}
+		if (gLoadStats) {
+			if (fromPack) {
+				printf("Loaded %-36s     from pack %8.2f ms upload\n", imagePaths[image], uploadMs);
+			} else {
+				printf("Loaded %-36s %8.2f ms decode %8.2f ms upload\n", imagePaths[image], decodeMs, uploadMs);
+			}
+		}
+	}
+
+	// All sprites are in, packs and uploads the atlas
+	stepStart = SDL_GetPerformanceCounter();
+    if (!buildSpriteAtlas(gSpriteFiles, &imageSurfaces[firstSpriteImage], SPRITE_FILE_COUNT)) {
+        printf("Failed to build sprite atlas.\n");
         success = false;
     } else {
         gHealthClip.x = 0;
@@ -397,96 +895,29 @@ bool loadMedia()
         gHealthClip.w = gHealthSprite.getWidth();
         gHealthClip.h = gHealthSprite.getHeight();
     }
-    if (!gAmmoSprite.loadFromFile("DS_Game/ammospr.png")) {
-        printf("Failed to load ammospr.png.\n");
-        success = false;
-    }
-    if (!gRaiderSprite.loadFromFile("DS_Game/raiderspr.png")) {
-        printf("Failed to load raiderspr.png.\n");
-        success = false;
-    }
-    if (!gRaiderDam1Sprite.loadFromFile("DS_Game/raidersprdam1.png")) {
-        printf("Failed to load raiderspr.png.\n");
-        success = false;
-    }
-    if (!gRaiderDam2Sprite.loadFromFile("DS_Game/raidersprdam2.png")) {
-        printf("Failed to load raiderspr.png.\n");
-        success = false;
-    }
-    if (!gRaiderDam3Sprite.loadFromFile("DS_Game/raidersprdam3.png")) {
-        printf("Failed to load raiderspr.png.\n");
-        success = false;
-    }
-    if (!gStrikerSprite.loadFromFile("DS_Game/strikerspr.png")) {
-        printf("Failed to load strikerspr.png.\n");
-        success = false;
-    }
-    if (!gStrikerDam1Sprite.loadFromFile("DS_Game/strikersprdam1.png")) {
-        printf("Failed to load strikerspr.png.\n");
-        success = false;
-    }
-    if (!gStrikerDam2Sprite.loadFromFile("DS_Game/strikersprdam2.png")) {
-        printf("Failed to load strikerspr.png.\n");
-        success = false;
-    }
-    if (!gStrikerDam3Sprite.loadFromFile("DS_Game/strikersprdam3.png")) {
-        printf("Failed to load strikerspr.png.\n");
-        success = false;
-    }
-    if (!gThrasherSprite.loadFromFile("DS_Game/thrasherspr.png")) {
-        printf("Failed to load thrasherspr.png.\n");
-        success = false;
-    }
-    if (!gThrasherDam1Sprite.loadFromFile("DS_Game/thrashersprdam1.png")) {
-        printf("Failed to load thrasherspr.png.\n");
-        success = false;
-    }
-    if (!gThrasherDam2Sprite.loadFromFile("DS_Game/thrashersprdam2.png")) {
-        printf("Failed to load thrasherspr.png.\n");
-        success = false;
-    }
-    if (!gThrasherDam3Sprite.loadFromFile("DS_Game/thrashersprdam3.png")) {
-        printf("Failed to load thrasherspr.png.\n");
-        success = false;
-    }
-    if (!gWinnerSprite.loadFromFile("DS_Game/winnerspr.png")) {
-        printf("Failed to load winnerspr.png.\n");
-        success = false;
-    }
-    if (!gSpeedSprite.loadFromFile("DS_Game/speedspr.png")) {
-        printf("Failed to load speedspr.png.\n");
-        success = false;
-    }
-    if (!gDamageSprite.loadFromFile("DS_Game/damgspr.png")) {
-        printf("Failed to load damgspr.png.\n");
-        success = false;
-    }
+	// Sprites are all in the atlas now (the pack stays mapped for the background)
+	for (size_t i = 0; i < imageSurfaces.size(); i++) {
+		SDL_FreeSurface(imageSurfaces[i]);
+	}
+	if (gLoadStats) {
+		printf("Loaded %-36s %8.2f ms upload\n", "sprite atlas", msSince(stepStart));
+		printf("Loaded all media in %.2f ms (%d from pack, %d decoded on %d threads)\n", msSince(loadStart), (int)packedImages.size(), (int)decodedImages.size(), decoder.getThreadCount());
+	}
 
-    gMusic = Mix_LoadMUS("DS_Game/Chase_The_Ace.mp3");
-    if (!gMusic) {
-        printf("Failed to load DS_Game/Chase_The_Ace.mp3. SDL_mixer Error: %s\n", Mix_GetError());
-        success = false;
-    }
-    gIdleMusic = Mix_LoadMUS("DS_Game/DT.mp3");
-    if (!gIdleMusic) {
-        printf("Failed to load DS_Game/DT.mp3. SDL_Mixer Error: %s\n", Mix_GetError());
-        success = false;
-    }
-
-	return success;
+	return success;
 }
 
-void close()
-{
+void close()
+{
+    gJobs.stop();
+
 	// Free loaded images
 	gTextTextureStar.free();
 	gTextTextureCollider.free();
 	gTextTextureGame.free();
 	gTextTextureOver.free();
-	gTextTextureLevel1.free();
-	gTextTextureLevel2.free();
-	gTextTextureLevel3.free();
-	gBackgroundTexture.free();
+	gBackground.free();
+	gAssetPack.close();
 	gFighterSprite.free();
 	gTurretSprite.free();
 	gBulletSprite.free();
@@ -508,23 +939,31 @@ void close()
 	gWinnerSprite.free();
 	gSpeedSprite.free();
 	gDamageSprite.free();
-	gPressStartTexture.free();
+	for (size_t i = 0; i < gAtlasPages.size(); i++) {
+		SDL_DestroyTexture(gAtlasPages[i]);
+	}
+	gAtlasPages.clear();
+	gTitleGlyphs.free();
+	gPressStartGlyphs.free();
 
 	//Close game controller
     SDL_JoystickClose(gGameController);
     gGameController = NULL;
 
-    //Free the music
+    //Free the music and sound effects
+    gSfx.free();
     Mix_FreeMusic(gMusic);
     gMusic = NULL;
     Mix_FreeMusic(gIdleMusic);
     gIdleMusic = NULL;
 
-	// Destroy renderer and window
-	SDL_DestroyRenderer( gRenderer );
-	SDL_DestroyWindow( gWindow );
-	gWindow = NULL;
-	gRenderer = NULL;
+	// Destroy renderer and window
+	SDL_DestroyRenderer( gRenderer );
+	SDL_DestroyWindow( gWindow );
+	SDL_FreeSurface( gHeadlessSurface );
+	gWindow = NULL;
+	gRenderer = NULL;
+	gHeadlessSurface = NULL;
 
 	// Quit SDL stuff
 	IMG_Quit();
@@ -534,64 +973,6 @@ void close()
 }
 
 
-struct Bullets {
-    int posX;
-    int posY;
-    Bullets *next;
-};
-
-int addNode (Bullets **bull, int posX, int posY)
-{
-    Bullets *newBull = (Bullets*)malloc(sizeof(Bullets));
-    if (!newBull) { return 0; }
-    newBull->posX = posX;
-    newBull->posY = posY;
-    newBull->next = NULL;
-
-    Bullets *curr = *bull;
-    if (!curr) {
-        *bull = newBull;
-        return 0;
-    }
-
-    while (curr->next) { curr = curr->next; }
-    curr->next = newBull;
-
-    return 0;
-}
-
-int delNode (Bullets **bull, int posX, int posY)
-{
-    Bullets *curr = *bull;
-    Bullets *prev = curr;
-    if (!curr) { return 0; }
-    if (curr->posX == posX) {
-        *bull = curr->next;
-        free(curr);
-        return 0;
-    }
-    while (curr->next) {
-        prev = curr;
-        curr = curr->next;
-        if (curr->posX == posX) {
-            prev->next = curr->next;
-            free(curr);
-            return 0;
-        }
-    }
-    return 0;
-}
-
-void clrList (Bullets *bull)
-{
-    Bullets *tmp;
-    while (bull) {
-        tmp = bull;
-        bull = bull->next;
-        free(tmp);
-    }
-}
-
 class Player
 {
     public:
@@ -635,741 +1016,1698 @@ Player::Player(int h, int s, int r, int d)
 
 int Player::getMaxHealth() { return maxHealth; }
 
-class Enemy
+// Fixed simulation rate (every speed in the game is in pixels per tick and was tuned at 60)
+const int TICKS_PER_SECOND = 60;
+
+// Longest stall the simulation will catch up on (avoids a spiral after a stall)
+const double MAX_FRAME_SECONDS = 0.25;
+
+// Positions that jump further than this in one tick are teleports, not movement
+const int SNAP_DISTANCE = SCREEN_HEIGHT/2;
+
+// Controller state collected from events between ticks
+struct Controls
+{
+    int xDir;
+    int yDir;
+    bool AButton;
+    bool startPressed;
+    bool quit;
+};
+
+// Positions from the previous tick (blended with the current ones when rendering)
+struct TickPositions
+{
+    int backgroundY[2];
+    int playerX;
+    int playerY;
+    int turretY;
+    int spdX;
+    int spdY;
+    int damgX;
+    int damgY;
+};
+
+// One sprite as of the previous and the current tick
+struct SpriteState
+{
+    LTexture *sprite;
+    int lastX;
+    int lastY;
+    int x;
+    int y;
+};
+
+// Everything drawn for one tick, copied out of GameState so drawing never reads live simulation state
+struct RenderSnapshot
+{
+    // Performance counter time the tick was due (drawing blends toward it over the next tick)
+    Uint64 time;
+
+    // Newest input event stamp the ticks so far have read (see InputLatency)
+    Uint64 eventTime;
+
+    bool quit;
+    bool start;
+    bool launching;
+    bool gameOver;
+    bool win;
+
+    // Turret heat color
+    Uint8 r;
+    Uint8 g;
+    Uint8 b;
+
+    Uint8 p2StartA;
+    int launchA;
+
+    TickPositions last;
+    TickPositions current;
+
+    // HUD
+    int health;
+    int score;
+    int countdown;
+    // Wave whose banner is showing, -1 for none
+    int banner;
+
+    // Projectiles, power-ups and enemies, in draw order
+    std::vector<SpriteState> sprites;
+};
+
+// Whole game simulation, advanced one fixed tick at a time
+class GameState
 {
     public:
-        Enemy(int h, int s, int r, int d, int t);
+        // Everything random in the simulation comes from seed
+        GameState(unsigned int seed);
 
-        int health;
-        int posX;
-        int posY;
-        bool shooting;
-        int timeSinceMove;
+        // Advances the simulation by one tick
+        void tick(const TickInput &input);
 
-        int getSpeed();
-        int getRate();
-        int getDamage();
-        int getType();
-        int getMaxHealth();
+        // Remembers current positions so drawing can interpolate
+        void storePositions();
+
+        // Gets the positions that get interpolated
+        TickPositions positions();
+
+        // Copies everything drawing needs into snapshot (reuses its storage)
+        void capture(RenderSnapshot &snapshot);
+
+        bool quit;
+        bool start;
+        bool launching;
+        bool gameOver;
+        bool win;
+        bool flag;
+        // 1 to 20
+        int difficulty;
+
+        // Modulation components
+        Uint8 r;
+        Uint8 g;
+        Uint8 b;
+
+        Uint8 p2StartA;
+        Uint8 titleA;
+
+        // Launch (title -> gameplay) animation
+        int launchA;
+        double launchAccel;
+
+        int backgroundY[2];
+        int backgroundSpeed;
+
+        Player player1;
+        ProjectilePool bullets;
+        int shootTime;
+        int score;
+        double accel;
+
+        int coolTime;
+
+        EnemyStore enemies;
+        std::vector<CollisionBox> enemyBoxes;
+        EnemyShotPool enemyShots;
+        std::vector<unsigned int> shotOwners;
+
+        WaveScheduler waves;
+        std::vector<WaveSpawn> dueSpawns;
+
+        // Simulated milliseconds (replaces SDL_GetTicks() in game logic)
+        Uint32 now;
+        Uint32 tickCount;
+        Uint32 gameTime;
+        Uint32 startTime;
+        int volume;
+
+        bool spdOnScrn;
+        int spdX;
+        int spdY;
+        bool damgOnScrn;
+        int damgX;
+        int damgY;
+
+        // Player bullets bucketed by position (rebuilt every tick after they move)
+        SpatialHash bulletGrid;
+        std::vector<HitPair> hits;
+
+        // Player bullet mask smeared over one tick of travel, for pixel-perfect hits (rebuilt when bullet speed changes)
+        CollisionMask sweptBullet;
+        int sweptReach;
+
+        TickPositions last;
+
+        // Session random numbers (the simulation never calls rand())
+        Random rng;
 
     private:
-        int speed;
-        int fireRate;
-        int damage;
-        int type;
-        int maxHealth;
+        // Starts the launch animation (title screen -> gameplay)
+        void beginLaunch();
+
+        // One tick of the launch animation
+        void launchTick();
+
+        // Adds an enemy just above the screen, xPercent across it
+        void spawnEnemy(int type, int xPercent);
+
+        // Sends a power-up down the screen
+        void dropPowerUp(int drop);
+
+        // Runs the enemy systems for one tick, returns how many enemies were destroyed
+        int runEnemies();
+
+        // Player hitbox for collision checks
+        CollisionBox playerBox();
+
+        // Applies every player bullet hit on the enemies and removes those bullets
+        void shootEnemies();
 };
 
-Enemy::Enemy(int h, int s, int r, int d, int t)
+// Smallest ranges worth handing to another thread
+const int ENEMY_JOB_GRAIN = 64;
+const int PROJECTILE_JOB_GRAIN = 1024;
+const int COLLISION_JOB_GRAIN = 32;
+
+// Per-tick jobs, each runs one range of a packed array (see JobSystem::parallelFor)
+struct EnemyMoveJob
 {
-    health = h;
-    speed = s;
-    fireRate = r;
-    damage = d;
-    type = t;
-    if (type == 1) {
-        posX = SCREEN_WIDTH/2-gRaiderSprite.getWidth()/2;
-        posY = -gRaiderSprite.getHeight();
-    } else if (type == 2) {
-        posX = SCREEN_WIDTH/2-gStrikerSprite.getWidth()/2;
-        posY = -gStrikerSprite.getHeight();
-    } else if (type == 3) {
-        posX = SCREEN_WIDTH/2-gThrasherSprite.getWidth()/2;
-        posY = -gThrasherSprite.getHeight();
-    }
-    shooting = false;
-    timeSinceMove = 0;
-    maxHealth = health;
+    EnemyStore *enemies;
+    EnemyTarget target;
+};
+
+void runEnemyMoveJob(void *data, int begin, int end)
+{
+    EnemyMoveJob &job = *(EnemyMoveJob*)data;
+    job.enemies->moveRange(job.target, begin, end);
+}
+
+struct BulletJob
+{
+    ProjectilePool *bullets;
+    int velX;
+    int velY;
+    CollisionBox bounds;
+};
+
+void runBulletJob(void *data, int begin, int end)
+{
+    BulletJob &job = *(BulletJob*)data;
+    job.bullets->integrateRange(job.velX, job.velY, job.bounds, begin, end);
+}
+
+struct ShotJob
+{
+    EnemyShotPool *shots;
+    CollisionBox bounds;
+};
+
+void runShotJob(void *data, int begin, int end)
+{
+    ShotJob &job = *(ShotJob*)data;
+    job.shots->integrateRange(job.bounds, begin, end);
+}
+
+struct CollisionJob
+{
+    SpatialHash *grid;
+    const CollisionBox *boxes;
+    EnemyStore *enemies;
+    ProjectilePool *bullets;
+    const CollisionMask *bulletMask;
+};
+
+// Narrow phase: a bullet inside an enemy's box only hits if their solid pixels touch
+bool bulletHitsEnemy(void *data, int enemy, int bullet)
+{
+    CollisionJob &job = *(CollisionJob*)data;
+    EnemyStore &enemies = *job.enemies;
+    const CollisionMask &mask = gEnemySprites[enemies.type[enemy]][enemies.damageState[enemy]]->getMask();
+    return mask.overlaps(enemies.posX[enemy], enemies.posY[enemy], *job.bulletMask, job.bullets->posX[bullet], job.bullets->posY[bullet]);
+}
+
+void runCollisionJob(void *data, int begin, int end)
+{
+    CollisionJob &job = *(CollisionJob*)data;
+    job.grid->collect(job.boxes, begin, end, bulletHitsEnemy, &job);
+}
+
+struct ShotHitTest
+{
+    EnemyShotPool *shots;
+    int playerX;
+    int playerY;
+};
+
+// Narrow phase: an enemy shot inside the player's box only hits if their solid pixels touch
+bool shotHitsPlayer(void *data, int, int shot)
+{
+    ShotHitTest &test = *(ShotHitTest*)data;
+    return gFighterSprite.getMask().overlaps(test.playerX, test.playerY, gABulletSprite.getMask(), test.shots->posX[shot], test.shots->posY[shot]);
 }
 
-int Enemy::getSpeed() { return speed; }
-int Enemy::getRate() { return fireRate; }
-int Enemy::getDamage() {return damage; }
-int Enemy::getType() { return type; }
-int Enemy::getMaxHealth() { return maxHealth; }
+GameState::GameState(unsigned int seed) : difficulty(10), player1(100, 5, 10, 10), enemies(SCREEN_HEIGHT), bulletGrid(SCREEN_WIDTH, SCREEN_HEIGHT), rng(seed)
+{
+    quit = false;
+    start = false;
+    launching = false;
+    gameOver = false;
+    win = false;
+    flag = false;
+
+    r = 75;
+    g = 75;
+    b = 255;
+
+    p2StartA = 255;
+    titleA = 255;
+    launchA = 255;
+    launchAccel = 8.0;
+
+    backgroundY[0] = -6400+640;
+    backgroundY[1] = -6400*2+640;
+    backgroundSpeed = 10;
+
+    shootTime = 0;
+    score = 0;
+    accel = 1.0;
+    coolTime = 0;
+    sweptReach = -1;
+
+    // Per-tick lists get their worst case now, so a busy tick never allocates (bullets never move a screen a tick)
+    enemyBoxes.reserve(enemies.capacity());
+    shotOwners.reserve(enemyShots.capacity());
+    hits.reserve(bullets.capacity());
+    bulletGrid.reserve(bullets.capacity(), enemies.capacity());
+    sweptBullet.reserve(gBulletSprite.getWidth(), gBulletSprite.getHeight()+SCREEN_HEIGHT);
+
+    // Enemy stats are hp, speed, fire rate, damage, size, shot range, reload on hit, wanders, kill heal, volley, spread
+    EnemyArchetype raider = {1000/(20/difficulty), 5, 1, 20, gRaiderSprite.getWidth(), gRaiderSprite.getHeight(),
+                             SCREEN_HEIGHT/2+gBulletSprite.getHeight(), false, false, 0, 1, 0};
+    EnemyArchetype striker = {750/(20/difficulty), 7, 1, 15, gStrikerSprite.getWidth(), gStrikerSprite.getHeight(),
+                              gBulletSprite.getHeight(), true, true, 0, 1, 0};
+    EnemyArchetype thrasher = {2000/(20/difficulty), 2, 2, 40, gThrasherSprite.getWidth(), gThrasherSprite.getHeight(),
+                               SCREEN_HEIGHT*2+gBulletSprite.getHeight(), false, false, 10, 1, 0};
+    enemies.setArchetype(ENEMY_RAIDER, raider);
+    enemies.setArchetype(ENEMY_STRIKER, striker);
+    enemies.setArchetype(ENEMY_THRASHER, thrasher);
+
+
+    now = 0;
+    tickCount = 0;
+    gameTime = 0;
+    startTime = 0;
+    volume = MIX_MAX_VOLUME/2;
+
+    spdOnScrn = false;
+    spdX = SCREEN_WIDTH/2-gSpeedSprite.getWidth()/2;
+    spdY = -gSpeedSprite.getHeight();
+    damgOnScrn = false;
+    damgX = SCREEN_WIDTH/2-gDamageSprite.getWidth()/2;
+    damgY = -gDamageSprite.getHeight();
+
+    storePositions();
+}
 
+void GameState::storePositions()
+{
+    last = positions();
+    bullets.storePositions();
+    enemies.storePositions();
+    enemyShots.storePositions();
+}
+
+TickPositions GameState::positions()
+{
+    TickPositions current;
+    current.backgroundY[0] = backgroundY[0];
+    current.backgroundY[1] = backgroundY[1];
+    current.playerX = player1.posX;
+    current.playerY = player1.posY;
+    current.turretY = player1.turretY;
+    current.spdX = spdX;
+    current.spdY = spdY;
+    current.damgX = damgX;
+    current.damgY = damgY;
+    return current;
+}
 
-int moveBackground(int by1, int by2, int bs)
+void GameState::capture(RenderSnapshot &snapshot)
 {
-    if (by1+bs < SCREEN_HEIGHT) {
-        by1+=bs;
+    snapshot.quit = quit;
+    snapshot.start = start;
+    snapshot.launching = launching;
+    snapshot.gameOver = gameOver;
+    snapshot.win = win;
+    snapshot.r = r;
+    snapshot.g = g;
+    snapshot.b = b;
+    snapshot.p2StartA = p2StartA;
+    snapshot.launchA = launchA;
+    snapshot.last = last;
+    snapshot.current = positions();
+    snapshot.health = player1.health;
+    snapshot.score = score;
+    snapshot.countdown = 179 - (int)(now-startTime)/1000;
+    snapshot.banner = start && !gameOver && waves.showBanner(now) ? waves.getWave() : -1;
+
+    // Room for every projectile, power-up and enemy at once, so only the first capture allocates
+    int maxSprites = bullets.capacity()+enemyShots.capacity()+2+enemies.capacity();
+    if ((int)snapshot.sprites.capacity() < maxSprites)
+        snapshot.sprites.reserve(maxSprites);
+    snapshot.sprites.clear();
+    for (int i = 0; i < bullets.size(); i++) {
+        SpriteState sprite = {&gBulletSprite, bullets.lastX[i], bullets.lastY[i], bullets.posX[i], bullets.posY[i]};
+        snapshot.sprites.push_back(sprite);
+    }
+    for (int i = 0; i < enemyShots.size(); i++) {
+        SpriteState sprite = {&gABulletSprite, enemyShots.lastX[i], enemyShots.lastY[i], enemyShots.posX[i], enemyShots.posY[i]};
+        snapshot.sprites.push_back(sprite);
+    }
+    if (spdOnScrn) {
+        SpriteState sprite = {&gSpeedSprite, last.spdX, last.spdY, spdX, spdY};
+        snapshot.sprites.push_back(sprite);
+    }
+    if (damgOnScrn) {
+        SpriteState sprite = {&gDamageSprite, last.damgX, last.damgY, damgX, damgY};
+        snapshot.sprites.push_back(sprite);
+    }
+    // Sprite picked by damage state
+    for (int i = 0; i < enemies.size(); i++) {
+        SpriteState sprite = {gEnemySprites[enemies.type[i]][enemies.damageState[i]], enemies.lastX[i], enemies.lastY[i], enemies.posX[i], enemies.posY[i]};
+        snapshot.sprites.push_back(sprite);
+    }
+}
+
+void GameState::beginLaunch()
+{
+    launching = true;
+    launchA = 255;
+    launchAccel = 8.0;
+    Mix_FadeOutMusic(600);
+}
+
+void GameState::launchTick()
+{
+    backgroundY[0] = moveBackground(backgroundY[0], backgroundY[1], backgroundSpeed, gBackground.getHeight(), SCREEN_HEIGHT);
+    backgroundY[1] = moveBackground(backgroundY[1], backgroundY[0], backgroundSpeed, gBackground.getHeight(), SCREEN_HEIGHT);
+
+    player1.posY-=launchAccel;
+    player1.turretY-=launchAccel;
+    if (launchAccel > 5)
+        launchAccel-=.2;
+
+    if (launchA > 8) {
+        launchA-=1.4*launchAccel;
     } else {
-        by1 = by2-gBackgroundTexture.getHeight()+bs;
+        launchA = 8;
     }
 
-    return by1;
+    // Fighter in place and title faded out
+    if (player1.posY <= SCREEN_HEIGHT*3/5 && launchA <= 8) {
+        launching = false;
+        backgroundY[1] = backgroundY[0]-6300;
+        player1.posY = SCREEN_HEIGHT*3/5;
+        player1.turretY = player1.posY+gFighterSprite.getHeight()/2;
+        start = true;
+        gameTime = now;
+        startTime = gameTime;
+        waves.start(&gWaveScript, now);
+        dueSpawns.reserve(gWaveScript.getSpawnCount());
+        if (!gameOver)
+            Mix_PlayMusic(gMusic, 1);
+    }
 }
 
-int initiate(int by1, int by2, int bs, int posX, int posY, int turretY)
+void GameState::spawnEnemy(int type, int xPercent)
 {
-    int p2StartA = 255;
-    std::stringstream pressStart;
-    SDL_Color textColor = { 255, 255, 255, 255 };
-    double accel = 8.0;
-    while (posY > SCREEN_HEIGHT*3/5 || p2StartA > 8) {
-        by1 = moveBackground(by1, by2, bs);
-        by2 = moveBackground(by2, by1, bs);
+    const EnemyArchetype &archetype = enemies.getArchetype(type);
+    int x = SCREEN_WIDTH*xPercent/100-archetype.width/2;
+    if (x < 0) { x = 0; } else if (x > SCREEN_WIDTH-archetype.width) { x = SCREEN_WIDTH-archetype.width; }
+    enemies.spawn(type, x, -archetype.height);
+}
 
-        posY-=accel;
-        turretY-=accel;
-        if (accel > 5)
-            accel-=.2;
+void GameState::dropPowerUp(int drop)
+{
+    if (drop == POWERUP_SPEED) {
+        spdOnScrn = true;
+        spdX = SCREEN_WIDTH/2-gSpeedSprite.getWidth()/2;
+        spdY = -gSpeedSprite.getHeight();
+    } else if (drop == POWERUP_DAMAGE) {
+        damgOnScrn = true;
+        damgX = SCREEN_WIDTH/2-gDamageSprite.getWidth()/2;
+        damgY = -gDamageSprite.getHeight();
+    }
+}
 
-        Mix_FadeOutMusic(600);
+int GameState::runEnemies()
+{
+    EnemyTarget target = {playerBox(), player1.bullSpeed, now};
+    // Rolls are drawn in order first, so however the moves are split the result is the same
+    enemies.rollWander(rng);
+    EnemyMoveJob moveJob = {&enemies, target};
+    gJobs.parallelFor(enemies.size(), ENEMY_JOB_GRAIN, runEnemyMoveJob, &moveJob);
+    enemies.fire(target, enemyShots);
+
+    // Enemy shots expire a sprite's size past the screen edges
+    CollisionBox shotBounds = {-gABulletSprite.getWidth(), -gABulletSprite.getHeight(),
+                               SCREEN_WIDTH+2*gABulletSprite.getWidth(), SCREEN_HEIGHT+2*gABulletSprite.getHeight()};
+    ShotJob shotJob = {&enemyShots, shotBounds};
+    gJobs.parallelFor(enemyShots.size(), PROJECTILE_JOB_GRAIN, runShotJob, &shotJob);
+    enemyShots.removeKilled();
+    shotOwners.clear();
+    // The box finds every shot whose sprite could touch the player's, then the masks decide
+    ShotHitTest shotTest = {&enemyShots, target.box.x, target.box.y};
+    CollisionBox shotCatch = growBox(target.box, gABulletSprite.getWidth(), gABulletSprite.getHeight());
+    int shotDamage = enemyShots.hit(shotCatch, shotOwners, shotHitsPlayer, &shotTest);
+    player1.health-=shotDamage;
+    enemies.shotsHit(shotOwners);
+    if (shotDamage > 0)
+        gSfx.play(SFX_PLAYER_HIT, now);
+
+    shootEnemies();
+    enemies.updateDamageStates();
+
+    int bounty;
+    int destroyed = enemies.removeDead(bounty);
+    player1.health+=bounty;
+    if (destroyed > 0)
+        gSfx.play(SFX_EXPLOSION, now);
+    return destroyed;
+}
 
-        SDL_SetRenderDrawColor(gRenderer, 0xFF, 0xFF, 0xFF, 0xFF);
-        SDL_RenderClear(gRenderer);
+CollisionBox GameState::playerBox()
+{
+    CollisionBox box = {player1.posX, player1.posY, gFighterSprite.getWidth(), gFighterSprite.getHeight()};
+    return box;
+}
 
-        // Render background(s)
-        gBackgroundTexture.render(0, by1);
-        gBackgroundTexture.render(0, by2);
+void GameState::shootEnemies()
+{
+    // Bullets fly straight up, so one tick of travel is the bullet's mask smeared down by its speed
+    if (sweptReach != player1.bullSpeed) {
+        sweptBullet.smearDown(gBulletSprite.getMask(), player1.bullSpeed);
+        sweptReach = player1.bullSpeed;
+    }
 
-        gTextTextureStar.setAlphaMod(p2StartA);
-        gTextTextureCollider.setAlphaMod(p2StartA);
-        gTextTextureStar.render((SCREEN_WIDTH-gTextTextureStar.getWidth())/2, SCREEN_HEIGHT/2-gTextTextureStar.getHeight());
-        gTextTextureCollider.render((SCREEN_WIDTH-gTextTextureCollider.getWidth())/2, SCREEN_HEIGHT/2);
-        pressStart.str("Press space to start");
-        gPressStartTexture.loadFromRenderedText( pressStart.str().c_str(), textColor, pressStartFont );
-        gPressStartTexture.setAlphaMod(p2StartA);
-        gPressStartTexture.render(SCREEN_WIDTH/2-gPressStartTexture.getWidth()/2, SCREEN_HEIGHT*2/3);
-        if (p2StartA > 8) {
-            p2StartA-=1.4*accel;
+    // Stretched up by one tick of bullet travel so fast bullets can't skip over an enemy, and grown
+    // by the bullet's size so the boxes find every bullet that could touch, then the masks decide
+    enemies.hitboxes(enemyBoxes, player1.bullSpeed, gBulletSprite.getWidth(), gBulletSprite.getHeight());
+    hits.clear();
+    if (!enemyBoxes.empty()) {
+        // Boxes are searched in parallel, then hits are claimed in box order just like queryAll()
+        CollisionJob collisionJob = {&bulletGrid, &enemyBoxes[0], &enemies, &bullets, &sweptBullet};
+        bulletGrid.startCollect(&enemyBoxes[0], (int)enemyBoxes.size());
+        gJobs.parallelFor((int)enemyBoxes.size(), COLLISION_JOB_GRAIN, runCollisionJob, &collisionJob);
+        bulletGrid.claimCollected(hits);
+    }
+
+    int hitCount = (int)hits.size();
+    int *hitBullets = gTickArena.allocateArray<int>(hitCount);
+    for (int i = 0; i < hitCount; i++) {
+        enemies.health[hits[i].entity]-=player1.damage;
+        int rad = rng.below(10);
+        if (rad == 0)
+            player1.health++;
+        hitBullets[i] = hits[i].projectile;
+    }
+    if (!hits.empty())
+        gSfx.play(SFX_HIT, now);
+
+    // Highest index first, so swap-removal never moves a bullet that is still to go
+    std::sort(hitBullets, hitBullets+hitCount, std::greater<int>());
+    for (int i = 0; i < hitCount; i++) {
+        bullets.removeAt(hitBullets[i]);
+    }
+}
+
+void GameState::tick(const TickInput &input)
+{
+    now = tickCount*1000/TICKS_PER_SECOND;
+    tickCount++;
+
+    if (input.quit)
+        quit = true;
+    if (launching) {
+        launchTick();
+        return;
+    }
+
+    // INPUT monster code
+    if (start && !gameOver) {
+        if (input.up) {
+            if (player1.posY > SCREEN_HEIGHT*3/5) {
+                player1.posY-=player1.speed;
+                player1.turretY-=player1.speed;
+            }
+        }
+        if (input.down) {
+            if (player1.posY < SCREEN_HEIGHT-gFighterSprite.getHeight()) {
+                player1.posY+=player1.speed;
+                player1.turretY+=player1.speed;
+            }
+        }
+        if (input.left) {
+            if (player1.posX > 0) {
+                player1.posX-=player1.speed;
+            }
+        }
+        if (input.right) {
+            if (player1.posX < SCREEN_WIDTH-gFighterSprite.getWidth()) {
+                player1.posX+=player1.speed;
+            }
+        }
+        // Activates turrets (animation for turrets)
+        if (input.fire && player1.turretsCooled) {
+            if (!player1.shooting && player1.turretY > player1.posY+gFighterSprite.getHeight()/3) {
+                player1.turretY-=player1.turretSpeed;
+            } else {
+                player1.turretY = player1.posY+gFighterSprite.getHeight()/3;
+                player1.shooting = true;
+            }
         } else {
-            p2StartA = 8;
+            player1.shooting = false;
+            if (player1.turretY < player1.posY+gFighterSprite.getHeight()/2) {
+                player1.turretY+=player1.turretSpeed;
+            } else {
+                player1.turretY = player1.posY+gFighterSprite.getHeight()/2;
+            }
         }
+        if  (input.volumeUp && volume < 128)
+            volume++;
+        if (input.volumeDown && volume > 0)
+            volume--;
+        /*// DEVTOOL
+        if (currentKeyStates[SDL_SCANCODE_H] && !currentKeyStates[SDL_SCANCODE_LSHIFT] && player1.health > 0) {
+            player1.health--;
+        } else if (currentKeyStates[SDL_SCANCODE_H] && currentKeyStates[SDL_SCANCODE_LSHIFT] && player1.health < 100) {
+            player1.health++;
+        }*/
+    } else {
+        if (input.start && !start) {
+            beginLaunch();
+            launchTick();
+            return;
+        }
+    }
 
-        gTurretSprite.render(posX+gFighterSprite.getWidth()/6,turretY);
-        gTurretSprite.render(posX+gFighterSprite.getWidth()*4/6,turretY,0,0,0,SDL_FLIP_HORIZONTAL);
-        gFighterSprite.render(posX, posY);
+    int xDir = input.xDir;
+    int yDir = input.yDir;
+    if (start && !gameOver) {
+        if (xDir == 1 && yDir == 0 && player1.posX+gFighterSprite.getWidth()+player1.speed < SCREEN_WIDTH) {
+            player1.posX+=player1.speed;
+        } else if (xDir == 1 && yDir == 1) {
+            if (player1.posX+gFighterSprite.getWidth()+player1.speed < SCREEN_WIDTH) { player1.posX+=player1.speed; }
+            if (player1.posY+gFighterSprite.getHeight()+player1.speed < SCREEN_HEIGHT) { player1.posY+=player1.speed; player1.turretY+=player1.speed; }
+        } else if (xDir == 0 && yDir == 1 && player1.posY+gFighterSprite.getHeight()+player1.speed < SCREEN_HEIGHT) {
+            player1.posY+=player1.speed;
+            player1.turretY+=player1.speed;
+        } else if (xDir == -1 && yDir == 1) {
+            if (player1.posY+gFighterSprite.getHeight()+player1.speed < SCREEN_HEIGHT) { player1.posY+=player1.speed; player1.turretY+=player1.speed; }
+            if (player1.posX-player1.speed > 0) { player1.posX-=player1.speed; }
+        } else if (xDir == -1 && yDir == 0 && player1.posX-player1.speed > 0) {
+            player1.posX-=player1.speed;
+        } else if (xDir == -1 && yDir == -1) {
+            if (player1.posX-player1.speed > 0) { player1.posX-=player1.speed; }
+            if (player1.posY-player1.speed > SCREEN_HEIGHT*3/5) { player1.posY-=player1.speed; player1.turretY-=player1.speed; }
+        } else if (xDir == 0 && yDir == -1 && player1.posY-player1.speed > SCREEN_HEIGHT*3/5) {
+            player1.posY-=player1.speed;
+            player1.turretY-=player1.speed;
+        } else if (xDir == 1 && yDir == -1) {
+            if (player1.posY-player1.speed > SCREEN_HEIGHT*3/5) { player1.posY-=player1.speed; player1.turretY-=player1.speed; }
+            if (player1.posX+gFighterSprite.getWidth()+player1.speed < SCREEN_WIDTH) { player1.posX+=player1.speed; }
+        }
+    }
+
+    // LOGIC monster code
+    // Move background (alternates between two images to creates seamless scrolling effect)
+    backgroundY[0] = moveBackground(backgroundY[0], backgroundY[1], backgroundSpeed, gBackground.getHeight(), SCREEN_HEIGHT);
+    backgroundY[1] = moveBackground(backgroundY[1], backgroundY[0], backgroundSpeed, gBackground.getHeight(), SCREEN_HEIGHT);
+
+    if (player1.shooting && player1.turretsCooled) {
+        if (shootTime % 10 == 0 && shootTime % 20 != 0) {
+            bullets.spawn(player1.posX+gFighterSprite.getWidth()/6+gBulletSprite.getWidth()*3/2, player1.turretY);
+            gSfx.play(SFX_SHOT, now);
+        } else if (shootTime % 20 == 0) {
+            bullets.spawn(player1.posX+gFighterSprite.getWidth()*4/6+gBulletSprite.getWidth(), player1.turretY);
+            gSfx.play(SFX_SHOT, now);
+        }
+        shootTime++;
+    } else {
+        shootTime = 0;
+    }
 
-        SDL_RenderPresent(gRenderer);
+    if (shootTime > 100 && shootTime % 2 == 0) {
+        if (r < 255-player1.heatSpeed) { r+=player1.heatSpeed; }
+        if (b > 1+player1.heatSpeed) { b-=player1.heatSpeed; }
+    } else if (shootTime == 0) {
+        if (r > 75+player1.coolSpeed && coolTime % 3 == 0) { r-=player1.coolSpeed; }
+        if (b < 255-player1.coolSpeed && coolTime % 3 == 0) { b+=player1.coolSpeed; }
+        coolTime+=player1.coolSpeed;
+    }
+    if (r > 240 && b < 10) {
+        player1.turretsCooled = false;
+    }
+    if (r < 1) { r = 1; } else if (r > 255) { r = 255; }
+    if (b < 1) { b = 1; } else if (b > 255) { b = 255; }
+    if (r < 85 && b > 240) {
+        player1.turretsCooled = true;
+        coolTime = 0;
+    }
+    //printf("%d-%d-%d\n",r,g,b); // DEVTOOL
+
+    // Moves bullets and drops the ones that left the screen
+    CollisionBox bulletBounds = {-gBulletSprite.getWidth(), -gBulletSprite.getHeight(),
+                                 SCREEN_WIDTH+2*gBulletSprite.getWidth(), SCREEN_HEIGHT+2*gBulletSprite.getHeight()};
+    BulletJob bulletJob = {&bullets, 0, -player1.bullSpeed, bulletBounds};
+    gJobs.parallelFor(bullets.size(), PROJECTILE_JOB_GRAIN, runBulletJob, &bulletJob);
+    bullets.removeKilled();
+    bulletGrid.build(&bullets.posX[0], &bullets.posY[0], bullets.size());
+
+    // Waves --------------------------------------------------------------------------------------------------------------------------------
+    if (start && !gameOver && !waves.finished()) {
+        // Only spawns that are due get looked at
+        dueSpawns.clear();
+        waves.due(now, dueSpawns);
+        for (size_t i = 0; i < dueSpawns.size(); i++) {
+            spawnEnemy(dueSpawns[i].type, dueSpawns[i].xPercent);
+        }
+
+        runEnemies();
+
+        // Wave cleared, drops its power-up (another wave waits for the turrets to cool first)
+        if (waves.waveSpawned() && enemies.size() == 0 && (player1.turretsCooled || waves.isLastWave())) {
+            dropPowerUp(waves.getDrop());
+            waves.nextWave(now);
+        }
+    } else if (start && waves.finished()) {
+        enemyShots.clear();
+        gameOver = true;
+        win = true;
+        player1.shooting = false;
+        if (!flag) {
+            flag = true;
+            gameTime = now;
+        }
+    }
+
+    // Power-ups drift down until the player catches them
+    if (spdOnScrn) {
+        if (spdY < SCREEN_HEIGHT*4/5)
+            spdY+=5;
+        int ramd = rng.below(20);
+        if (ramd > 16)
+            spdX-=5;
+        if (ramd < 4)
+            spdX+=5;
+        CollisionBox spdBox = {spdX, spdY, gSpeedSprite.getWidth(), gSpeedSprite.getHeight()};
+        if (boxesOverlap(spdBox, playerBox())) {
+            player1.speed+=4;
+            player1.bullSpeed+=5;
+            player1.coolSpeed+=1;
+            player1.health+=30;
+            spdY = -gSpeedSprite.getHeight();
+            spdOnScrn = false;
+            gSfx.play(SFX_PICKUP, now);
+        }
+    }
+    if (damgOnScrn) {
+        if (damgY < SCREEN_HEIGHT*4/5)
+            damgY+=5;
+        int ramd = rng.below(20);
+        if (ramd > 16)
+            damgX-=5;
+        if (ramd < 4)
+            damgX+=5;
+        CollisionBox damgBox = {damgX, damgY, gDamageSprite.getWidth(), gDamageSprite.getHeight()};
+        if (boxesOverlap(damgBox, playerBox())) {
+            player1.health+=40;
+            player1.damage+=30;
+            damgY = -gDamageSprite.getHeight();
+            damgOnScrn = false;
+            gSfx.play(SFX_PICKUP, now);
+        }
     }
 
-    return by1;
+    if (player1.health <= 1) {
+        player1.health = 1;
+        player1.shooting = false;
+        gameOver = true;
+    } else if (player1.health > 100) {
+        player1.health = 100;
+    }
+
+    if (now-startTime >= 179000 && start) { player1.shooting = false; gameOver = true; }
+
+    // Title text pulse
+    if (!start)
+        p2StartA++;
+
+    // Game over / victory fly-off
+    if (gameOver && !win) {
+        volume--;
+    } else if (gameOver && win) {
+        if (player1.turretY < player1.posY+gFighterSprite.getHeight()/2) {
+            player1.turretY+=player1.turretSpeed;
+        } else if (player1.posX+gFighterSprite.getWidth()/2-SCREEN_WIDTH/2 > 10) {
+            player1.posX-=5;
+        } else if (player1.posX+gFighterSprite.getWidth()/2-SCREEN_WIDTH/2 < -10) {
+            player1.posX+=5;
+        } else {
+            player1.posX = SCREEN_WIDTH/2-gFighterSprite.getWidth()/2;
+        }
+        if (now > gameTime+2000 && player1.posY > -gFighterSprite.getHeight() && player1.posX+gFighterSprite.getWidth()/2 == SCREEN_WIDTH/2) {
+            player1.posY-=2*accel;
+            player1.turretY-=2*accel;
+            backgroundSpeed = 6;
+            accel+=.5;
+        } else {
+            backgroundSpeed = 10;
+            if (score == 0)
+                score = 179 - (now-startTime)/1000;
+        }
+    }
+    //printf("%d\n", now-startTime);
+    Mix_VolumeMusic(volume);
+    //printf("Average volume is %d\n",volume);
+    //printf("%d-%d\n",backgroundY[0], backgroundY[1]);
+    //printf("%d\n",score);
 }
 
-int main (int argc, char *args[])
-{
-	// Initialize SDL and create window
-	if(!init()) {
-		printf( "Failed to initialize\n" );
-	} else {
-		// Load media
-		if(!loadMedia()) {
-			printf( "Failed to load media\n" );
-		} else {
-			// Flag to quit game
-			bool quit = false;
-
-			// Event handler (user input)
-			SDL_Event evnt;
+// Blends a previous and current tick position (snaps on teleports such as background wraparound)
+int lerpPosition(int previous, int current, double alpha)
+{
+    if (abs(current-previous) > SNAP_DISTANCE) { return current; }
+    return previous + (int)floor((current-previous)*alpha + .5);
+}
 
-			//Normalized direction
-            int xDir = 0;
-            int yDir = 0;
+// Draws the remaining time centered at the top of the screen
+void renderCountdown(int seconds)
+{
+    if (seconds < 0) { seconds = 0; }
+
+    char text[16];
+    snprintf(text, sizeof(text), "%d:%02d", seconds/60, seconds%60);
+    gPressStartGlyphs.render(SCREEN_WIDTH/2-gPressStartGlyphs.measure(text)/2, SCREEN_HEIGHT/40, text);
+}
+
+// Draws the final score centered at height y
+void renderScore(int score, int y)
+{
+    char text[32];
+    snprintf(text, sizeof(text), "Score %d", score);
+    gPressStartGlyphs.render(SCREEN_WIDTH/2-gPressStartGlyphs.measure(text)/2, y, text);
+}
 
-			//Modulation components
-			Uint8 r = 75;
-			Uint8 g = 75;
-			Uint8 b = 255;
+// Draws "level N" for a wave (0 based) in the middle of the screen
+void renderBanner(int wave)
+{
+    char text[32];
+    snprintf(text, sizeof(text), "level %d", wave+1);
+    gTitleGlyphs.render(SCREEN_WIDTH/2-gTitleGlyphs.measure(text)/2, SCREEN_HEIGHT/2-gTitleGlyphs.getHeight()/2, text);
+}
+
+// Draws a snapshot between its previous and current tick (alpha 0 to 1)
+void renderSnapshot(const RenderSnapshot &snapshot, double alpha)
+{
+    // Interpolated positions
+    const TickPositions &last = snapshot.last;
+    const TickPositions &current = snapshot.current;
+    int bgY0 = lerpPosition(last.backgroundY[0], current.backgroundY[0], alpha);
+    int bgY1 = lerpPosition(last.backgroundY[1], current.backgroundY[1], alpha);
+    int playerX = lerpPosition(last.playerX, current.playerX, alpha);
+    int playerY = lerpPosition(last.playerY, current.playerY, alpha);
+    int turretY = lerpPosition(last.turretY, current.turretY, alpha);
+
+    // RENDER monster code
+    // Clear the window (partial redraws fill just the clipped part, since clearing ignores clipping)
+    if (!gDirty.isRecording()) {
+        SDL_SetRenderDrawColor(gRenderer, 0xFF, 0xFF, 0xFF, 0xFF);
+        if (gSoftware)
+            SDL_RenderFillRect(gRenderer, NULL);
+        else
+            SDL_RenderClear(gRenderer);
+    }
 
-			bool start = false;
-			bool gameOver = false;
-			bool win = false;
-			bool flag = false;
-			// 1 to 20
-			int difficulty = 10;
+    // Render background(s)
+    gBackground.render(bgY0, SCREEN_HEIGHT);
+    gBackground.render(bgY1, SCREEN_HEIGHT);
+    gBackground.prefetch(bgY0);
+    gBackground.prefetch(bgY1);
 
-			Uint8 p2StartA = 255;
-			std::stringstream pressStart;
-			SDL_Color textColor = { 255, 255, 255, 255 };
-			Uint8 titleA = 255;
+    if (snapshot.launching) {
+        // Title fades out while the fighter flies into place
+        gTextTextureStar.setAlphaMod(snapshot.launchA);
+        gTextTextureCollider.setAlphaMod(snapshot.launchA);
+        gTextTextureStar.render((SCREEN_WIDTH-gTextTextureStar.getWidth())/2, SCREEN_HEIGHT/2-gTextTextureStar.getHeight());
+        gTextTextureCollider.render((SCREEN_WIDTH-gTextTextureCollider.getWidth())/2, SCREEN_HEIGHT/2);
+        gPressStartGlyphs.setAlphaMod(snapshot.launchA);
+        gPressStartGlyphs.render(SCREEN_WIDTH/2-gPressStartGlyphs.measure(PRESS_START_TEXT)/2, SCREEN_HEIGHT*2/3, PRESS_START_TEXT);
+        gPressStartGlyphs.setAlphaMod(255);
+
+        gTurretSprite.render(playerX+gFighterSprite.getWidth()/6,turretY);
+        gTurretSprite.render(playerX+gFighterSprite.getWidth()*4/6,turretY,0,0,0,SDL_FLIP_HORIZONTAL);
+        gFighterSprite.render(playerX, playerY);
+        return;
+    }
 
-            int backgroundY[2] = {-6400+640, -6400*2+640};
-			int backgroundSpeed = 10;
+    // Render projectiles, items and enemies
+    for (size_t i = 0; i < snapshot.sprites.size(); i++) {
+        const SpriteState &sprite = snapshot.sprites[i];
+        gSpriteBatch.add(*sprite.sprite, lerpPosition(sprite.lastX, sprite.x, alpha), lerpPosition(sprite.lastY, sprite.y, alpha));
+    }
+    gSpriteBatch.flush();
+
+    if (snapshot.start) {
+        if (!snapshot.win) {
+            // Render HUD
+            gHealthClip.y = 100-snapshot.health;
+            gHealthClip.h = snapshot.health;
+            gHealthSprite.render(SCREEN_WIDTH/30, SCREEN_HEIGHT/40+100-snapshot.health, &gHealthClip);
+            gAmmoSprite.setColorMod(snapshot.r, snapshot.g, snapshot.b);
+            gAmmoSprite.render(SCREEN_WIDTH-SCREEN_WIDTH*1/30-gAmmoSprite.getWidth(), SCREEN_HEIGHT/40);
+
+            // Countdown until the song ends
+            if (!snapshot.gameOver) {
+                renderCountdown(snapshot.countdown);
+            }
+        }
 
-            Player player1 (100, 5, 10, 10);
-            Bullets *bull = NULL;
-			int shootTime = 0;
-			int score = 0;
-			double accel = 1.0;
+        // Render turrets
+        gTurretSprite.render(playerX+gFighterSprite.getWidth()/6,turretY);
+        gTurretSprite.render(playerX+gFighterSprite.getWidth()*4/6,turretY,0,0,0,SDL_FLIP_HORIZONTAL);
 
-            int coolTime = 0;
-			bool AButton = false;
+        // Render fighter
+        gFighterSprite.render(playerX, playerY);
+    } else {
+        gTextTextureStar.render((SCREEN_WIDTH-gTextTextureStar.getWidth())/2, SCREEN_HEIGHT/2-gTextTextureStar.getHeight());
+        gTextTextureCollider.render((SCREEN_WIDTH-gTextTextureCollider.getWidth())/2, SCREEN_HEIGHT/2);
+        gPressStartGlyphs.setAlphaMod(((sin(((double)snapshot.p2StartA/255)*360 * PI/180)+1)/2*(255*10/9)) <= 255 ? (sin(((double)snapshot.p2StartA/255)*360 * PI/180)+1)/2*(255*10/9) : 255);
+        gPressStartGlyphs.render(SCREEN_WIDTH/2-gPressStartGlyphs.measure(PRESS_START_TEXT)/2, SCREEN_HEIGHT*2/3, PRESS_START_TEXT);
+        gPressStartGlyphs.setAlphaMod(255);
+    }
 
-			int aBulletX;
-			int aBulletY = -gBulletSprite.getHeight();
+    // Render level text
+    if (snapshot.banner >= 0)
+        renderBanner(snapshot.banner);
+
+    // Render game over text
+    if (snapshot.gameOver && !snapshot.win) {
+        gTextTextureGame.render((SCREEN_WIDTH-gTextTextureGame.getWidth())/2, SCREEN_HEIGHT/2-gTextTextureGame.getHeight());
+        gTextTextureOver.render((SCREEN_WIDTH-gTextTextureOver.getWidth())/2, SCREEN_HEIGHT/2);
+    } else if (snapshot.gameOver && snapshot.win && current.playerY <= -gFighterSprite.getHeight()) {
+        gWinnerSprite.render(0, SCREEN_HEIGHT/2-gWinnerSprite.getHeight()/2);
+        renderScore(snapshot.score, SCREEN_HEIGHT/2+gWinnerSprite.getHeight()/2);
+    }
+}
 
-			int enemies[4] = {0,1,1,1};
-			//            hp  spd bs  dmg type
-			Enemy Raider (1000/(20/difficulty), 5, 1.6, 20, 1);
-            Enemy Striker (750/(20/difficulty), 7, 1.8, 15, 2);
-            Enemy Thrasher (2000/(20/difficulty), 2, 2, 40, 3);
+// Draws the frame time graph over the bottom of the screen, with each phase's average
+void renderProfilerOverlay()
+{
+    // Full height is 50 ms (20 fps)
+    SDL_Rect area = {0, SCREEN_HEIGHT*2/3, SCREEN_WIDTH, SCREEN_HEIGHT/3};
 
-			int stages[3] = {1,0,0};
-			int loading[3] = {0,0,0};
+    // The graph changes every frame, so a partial redraw always includes it
+    if (gDirty.isRecording()) {
+        gDirty.addDirty(area);
+        return;
+    }
+    gProfiler.drawOverlay(gRenderer, area, 50.0);
+
+    char text[32];
+    for (int p = 0; p < PHASE_COUNT; p++) {
+        snprintf(text, sizeof(text), "%s %.2f ms", profilePhaseName(p), gProfiler.getAverageMs(p));
+        SDL_Color color = gProfiler.getPhaseColor(p);
+        gPressStartGlyphs.setColorMod(color.r, color.g, color.b);
+        gPressStartGlyphs.render(SCREEN_WIDTH/60, area.y+p*gPressStartGlyphs.getHeight(), text);
+    }
+    gPressStartGlyphs.setColorMod(255, 255, 255);
+}
 
-            Uint32 gameTime = 0;
-            Uint32 startTime;
-            int volume = MIX_MAX_VOLUME/2;
+// Draws the whole frame (snapshot plus the profiler overlay when it's on)
+void renderFrame(const RenderSnapshot &snapshot, double alpha)
+{
+    renderSnapshot(snapshot, alpha);
+    if (gShowProfiler)
+        renderProfilerOverlay();
+}
 
-            srand(time(NULL));
+// Software rendering: records the frame to find what changed, then redraws only those parts
+void renderDirty(const RenderSnapshot &snapshot, double alpha)
+{
+    gDirty.beginFrame(SCREEN_WIDTH, SCREEN_HEIGHT);
+    renderFrame(snapshot, alpha);
+    gDirty.endFrame();
+
+    const std::vector<SDL_Rect> &rects = gDirty.getRects();
+    for (size_t i = 0; i < rects.size(); i++) {
+        SDL_RenderSetClipRect(gRenderer, &rects[i]);
+        renderFrame(snapshot, alpha);
+    }
+    SDL_RenderSetClipRect(gRenderer, NULL);
+}
 
-            bool spdOnScrn = false;
-            int spdX = SCREEN_WIDTH/2-gSpeedSprite.getWidth()/2;
-            int spdY = -gSpeedSprite.getHeight();
-            bool damgOnScrn = false;
-            int damgX = SCREEN_WIDTH/2-gDamageSprite.getWidth()/2;
-            int damgY = -gDamageSprite.getHeight();
+// Software rendering: finishes drawing into the window surface and shows just the changed parts
+void presentDirty()
+{
+    SDL_RenderPresent(gRenderer);
 
+    const std::vector<SDL_Rect> &rects = gDirty.getRects();
+    if (!rects.empty())
+        SDL_UpdateWindowSurfaceRects(gWindow, &rects[0], (int)rects.size());
+}
 
-            Mix_PlayMusic(gIdleMusic, -1);
-
-			// While game is running
-			while(!quit) {
-				// Handle events in PollEvent queue
-				while(SDL_PollEvent(&evnt) != 0) {
-					// User wants to quit
-					if(evnt.type == SDL_QUIT) {
-						quit = true;
-					} else if (evnt.type == SDL_JOYAXISMOTION) {
-                        // Motion on controller 0
-                        if (evnt.jaxis.which == 0) {
-                            // X/Y axis motion
-                            if (evnt.jaxis.axis == 0) {
-                                // Left/right of dead zone
-                                if (evnt.jaxis.value < -JOYSTICK_DEAD_ZONE) {
-                                    xDir = -1;
-                                } else if (evnt.jaxis.value > JOYSTICK_DEAD_ZONE) {
-                                    xDir =  1;
-                                } else {
-                                    xDir = 0;
-                                }
-                            } else if (evnt.jaxis.axis == 1) {
-								// Below/above of dead zone
-								if (evnt.jaxis.value < -JOYSTICK_DEAD_ZONE) {
-									yDir = -1;
-								} else if (evnt.jaxis.value > JOYSTICK_DEAD_ZONE) {
-									yDir =  1;
-								} else {
-									yDir = 0;
-								}
-							}
-						}
-					} else if (evnt.type == SDL_JOYBUTTONDOWN) {
-					    if (evnt.jbutton.button == 1)
-                            quit = true;
-					    if (start && !gameOver) {
-                            if (evnt.jbutton.button == 0)
-                                AButton = true;
-					    } else if (!gameOver) {
-                            backgroundY[0] = initiate(backgroundY[0], backgroundY[1], backgroundSpeed, player1.posX, player1.posY, player1.turretY);
-                            backgroundY[1] = backgroundY[0]-6300;
-                            player1.posY = SCREEN_HEIGHT*3/5;
-                            player1.turretY = player1.posY+gFighterSprite.getHeight()/2;
-                            start = true;
-                            gameTime = SDL_GetTicks();
-                            startTime = gameTime;
-                            if (!gameOver)
-                                Mix_PlayMusic(gMusic, 1);
-					    }
-                        //printf("%d\n",evnt.jbutton.button);
-					} else if (evnt.type == SDL_JOYBUTTONUP) {
-                        if (evnt.jbutton.button == 0)
-                            AButton = false;
-					}
-				}
-
-				// INPUT monster code
-				const Uint8 *currentKeyStates = SDL_GetKeyboardState(NULL);
-
-                if (currentKeyStates[SDL_SCANCODE_ESCAPE])
-                    quit = true;
-                if (start && !gameOver) {
-                    if (currentKeyStates[SDL_SCANCODE_UP] || currentKeyStates[SDL_SCANCODE_W]) {
-                        if (player1.posY > SCREEN_HEIGHT*3/5) {
-                            player1.posY-=player1.speed;
-                            player1.turretY-=player1.speed;
-                        }
-                    }
-                    if (currentKeyStates[SDL_SCANCODE_DOWN] || currentKeyStates[SDL_SCANCODE_S]) {
-                        if (player1.posY < SCREEN_HEIGHT-gFighterSprite.getHeight()) {
-                            player1.posY+=player1.speed;
-                            player1.turretY+=player1.speed;
-                        }
-                    }
-                    if (currentKeyStates[SDL_SCANCODE_LEFT] || currentKeyStates[SDL_SCANCODE_A]) {
-                        if (player1.posX > 0) {
-                            player1.posX-=player1.speed;
-                        }
-                    }
-                    if (currentKeyStates[SDL_SCANCODE_RIGHT] || currentKeyStates[SDL_SCANCODE_D]) {
-                        if (player1.posX < SCREEN_WIDTH-gFighterSprite.getWidth()) {
-                            player1.posX+=player1.speed;
-                        }
-                    }
-                    // Activates turrets (animation for turrets)
-                    if ((currentKeyStates[SDL_SCANCODE_SPACE] || AButton) && player1.turretsCooled) {
-                        if (!player1.shooting && player1.turretY > player1.posY+gFighterSprite.getHeight()/3) {
-                            player1.turretY-=player1.turretSpeed;
-                        } else {
-                            player1.turretY = player1.posY+gFighterSprite.getHeight()/3;
-                            player1.shooting = true;
-                        }
+// Handles the SDL event queue (once per rendered frame)
+void handleEvents(const RenderSnapshot &game, Controls &controls)
+{
+    // Event handler (user input)
+    SDL_Event evnt;
+
+    // Handle events in PollEvent queue
+    while(SDL_PollEvent(&evnt) != 0) {
+        // Stamps anything that can change the input, for the latency stats
+        if (evnt.type == SDL_JOYAXISMOTION || evnt.type == SDL_JOYBUTTONDOWN || evnt.type == SDL_JOYBUTTONUP ||
+            evnt.type == SDL_KEYUP || (evnt.type == SDL_KEYDOWN && evnt.key.repeat == 0))
+            gInputLatency.addEvent(eventTime(evnt));
+
+        // User wants to quit
+        if(evnt.type == SDL_QUIT) {
+            controls.quit = true;
+        } else if (evnt.type == SDL_JOYAXISMOTION) {
+            // Motion on controller 0
+            if (evnt.jaxis.which == 0) {
+                // X/Y axis motion
+                if (evnt.jaxis.axis == 0) {
+                    // Left/right of dead zone
+                    if (evnt.jaxis.value < -JOYSTICK_DEAD_ZONE) {
+                        controls.xDir = -1;
+                    } else if (evnt.jaxis.value > JOYSTICK_DEAD_ZONE) {
+                        controls.xDir =  1;
                     } else {
-                        player1.shooting = false;
-                        if (player1.turretY < player1.posY+gFighterSprite.getHeight()/2) {
-                            player1.turretY+=player1.turretSpeed;
-                        } else {
-                            player1.turretY = player1.posY+gFighterSprite.getHeight()/2;
-                        }
+                        controls.xDir = 0;
                     }
-                    if  (currentKeyStates[SDL_SCANCODE_EQUALS] && volume < 128)
-                        volume++;
-                    if (currentKeyStates[SDL_SCANCODE_MINUS] && volume > 0)
-                        volume--;
-                    /*// DEVTOOL
-                    if (currentKeyStates[SDL_SCANCODE_H] && !currentKeyStates[SDL_SCANCODE_LSHIFT] && player1.health > 0) {
-                        player1.health--;
-                    } else if (currentKeyStates[SDL_SCANCODE_H] && currentKeyStates[SDL_SCANCODE_LSHIFT] && player1.health < 100) {
-                        player1.health++;
-                    }*/
-				} else {
-                    if (currentKeyStates[SDL_SCANCODE_SPACE] && !start) {
-                        backgroundY[0] = initiate(backgroundY[0], backgroundY[1], backgroundSpeed, player1.posX, player1.posY, player1.turretY);
-                        backgroundY[1] = backgroundY[0]-6300;
-                        player1.posY = SCREEN_HEIGHT*3/5;
-                        player1.turretY = player1.posY+gFighterSprite.getHeight()/2;
-                        start = true;
-                        gameTime = SDL_GetTicks();
-                        startTime = gameTime;
-                        if (!gameOver)
-                            Mix_PlayMusic(gMusic, 1);
-                    }
-				}
-
-				//Calculate angle
-                double joystickAngle = atan2( (double)yDir, (double)xDir ) * ( 180.0 / M_PI );
-                //Correct angle
-                if (xDir == 0 && yDir == 0) {
-                    joystickAngle = 0;
-                }
-                if (start && !gameOver) {
-                    if (xDir == 1 && yDir == 0 && player1.posX+gFighterSprite.getWidth()+player1.speed < SCREEN_WIDTH) {
-                        player1.posX+=player1.speed;
-                    } else if (xDir == 1 && yDir == 1) {
-                        if (player1.posX+gFighterSprite.getWidth()+player1.speed < SCREEN_WIDTH) { player1.posX+=player1.speed; }
-                        if (player1.posY+gFighterSprite.getHeight()+player1.speed < SCREEN_HEIGHT) { player1.posY+=player1.speed; player1.turretY+=player1.speed; }
-                    } else if (xDir == 0 && yDir == 1 && player1.posY+gFighterSprite.getHeight()+player1.speed < SCREEN_HEIGHT) {
-                        player1.posY+=player1.speed;
-                        player1.turretY+=player1.speed;
-                    } else if (xDir == -1 && yDir == 1) {
-                        if (player1.posY+gFighterSprite.getHeight()+player1.speed < SCREEN_HEIGHT) { player1.posY+=player1.speed; player1.turretY+=player1.speed; }
-                        if (player1.posX-player1.speed > 0) { player1.posX-=player1.speed; }
-                    } else if (xDir == -1 && yDir == 0 && player1.posX-player1.speed > 0) {
-                        player1.posX-=player1.speed;
-                    } else if (xDir == -1 && yDir == -1) {
-                        if (player1.posX-player1.speed > 0) { player1.posX-=player1.speed; }
-                        if (player1.posY-player1.speed > SCREEN_HEIGHT*3/5) { player1.posY-=player1.speed; player1.turretY-=player1.speed; }
-                    } else if (xDir == 0 && yDir == -1 && player1.posY-player1.speed > SCREEN_HEIGHT*3/5) {
-                        player1.posY-=player1.speed;
-                        player1.turretY-=player1.speed;
-                    } else if (xDir == 1 && yDir == -1) {
-                        if (player1.posY-player1.speed > SCREEN_HEIGHT*3/5) { player1.posY-=player1.speed; player1.turretY-=player1.speed; }
-                        if (player1.posX+gFighterSprite.getWidth()+player1.speed < SCREEN_WIDTH) { player1.posX+=player1.speed; }
+                } else if (evnt.jaxis.axis == 1) {
+                    // Below/above of dead zone
+                    if (evnt.jaxis.value < -JOYSTICK_DEAD_ZONE) {
+                        controls.yDir = -1;
+                    } else if (evnt.jaxis.value > JOYSTICK_DEAD_ZONE) {
+                        controls.yDir =  1;
+                    } else {
+                        controls.yDir = 0;
                     }
                 }
+            }
+        } else if (evnt.type == SDL_JOYBUTTONDOWN) {
+            if (evnt.jbutton.button == 1)
+                controls.quit = true;
+            if (game.start && !game.gameOver) {
+                if (evnt.jbutton.button == 0)
+                    controls.AButton = true;
+            } else if (!game.gameOver) {
+                // Picked up by the next tick
+                controls.startPressed = true;
+            }
+            //printf("%d\n",evnt.jbutton.button);
+        } else if (evnt.type == SDL_JOYBUTTONUP) {
+            if (evnt.jbutton.button == 0)
+                controls.AButton = false;
+        } else if (evnt.type == SDL_WINDOWEVENT && evnt.window.event == SDL_WINDOWEVENT_EXPOSED) {
+            // Whatever covered the window took the last frame with it
+            gDirty.invalidate();
+        } else if (evnt.type == SDL_KEYDOWN && evnt.key.repeat == 0) {
+            // Profiler overlay and CSV dump
+            if (evnt.key.keysym.sym == SDLK_F3) {
+                gShowProfiler = !gShowProfiler;
+                gDirty.invalidate();
+            } else if (evnt.key.keysym.sym == SDLK_F4 && gProfiler.dumpCSV(PROFILE_CSV_PATH)) {
+                printf("Wrote %d frames to %s\n", gProfiler.getFrameCount(), PROFILE_CSV_PATH);
+            }
+        }
+    }
+}
 
-                // LOGIC monster code
-                // Move background (alternates between two images to creates seamless scrolling effect)
-                backgroundY[0] = moveBackground(backgroundY[0], backgroundY[1], backgroundSpeed);
-                backgroundY[1] = moveBackground(backgroundY[1], backgroundY[0], backgroundSpeed);
+// Reads keyboard state and the controller into one tick's input
+TickInput sampleInput(Controls &controls)
+{
+    const Uint8 *currentKeyStates = SDL_GetKeyboardState(NULL);
+
+    TickInput input;
+    input.up = currentKeyStates[SDL_SCANCODE_UP] || currentKeyStates[SDL_SCANCODE_W];
+    input.down = currentKeyStates[SDL_SCANCODE_DOWN] || currentKeyStates[SDL_SCANCODE_S];
+    input.left = currentKeyStates[SDL_SCANCODE_LEFT] || currentKeyStates[SDL_SCANCODE_A];
+    input.right = currentKeyStates[SDL_SCANCODE_RIGHT] || currentKeyStates[SDL_SCANCODE_D];
+    input.fire = currentKeyStates[SDL_SCANCODE_SPACE] || controls.AButton;
+    input.start = currentKeyStates[SDL_SCANCODE_SPACE] || controls.startPressed;
+    input.volumeUp = currentKeyStates[SDL_SCANCODE_EQUALS];
+    input.volumeDown = currentKeyStates[SDL_SCANCODE_MINUS];
+    input.quit = currentKeyStates[SDL_SCANCODE_ESCAPE] || controls.quit;
+    input.xDir = controls.xDir;
+    input.yDir = controls.yDir;
+
+    // Start presses only count once
+    controls.startPressed = false;
+
+    return input;
+}
 
-                if (player1.shooting && player1.turretsCooled) {
-                    if (shootTime % 10 == 0 && shootTime % 20 != 0) {
-                        addNode(&bull, player1.posX+gFighterSprite.getWidth()/6+gBulletSprite.getWidth()*3/2, player1.turretY);
-                    } else if (shootTime % 20 == 0) {
-                        addNode(&bull, player1.posX+gFighterSprite.getWidth()*4/6+gBulletSprite.getWidth(), player1.turretY);
-                    }
-                    shootTime++;
-                } else {
-                    for (Bullets *bulle = bull; bulle != NULL; bulle = bulle->next) {
-                        if (bulle->posY < 0) {
-                            delNode(&bull, bulle->posX, bulle->posY);
-                        }
-                    }
-                    shootTime = 0;
-                }
+// Scripted player for headless runs: keeps pressing start, strafes and fires in bursts
+TickInput scriptedInput(Uint32 tick)
+{
+    TickInput input = {};
+    input.start = tick % 30 == 0;
+    input.fire = (tick/120) % 3 != 2;
+    input.left = (tick/90) % 2 == 0;
+    input.right = !input.left;
+    return input;
+}
 
-                if (shootTime > 100 && shootTime % 2 == 0) {
-                    if (r < 255-player1.heatSpeed) { r+=player1.heatSpeed; }
-                    if (b > 1+player1.heatSpeed) { b-=player1.heatSpeed; }
-                } else if (shootTime == 0) {
-                    if (r > 75+player1.coolSpeed && coolTime % 3 == 0) { r-=player1.coolSpeed; }
-                    if (b < 255-player1.coolSpeed && coolTime % 3 == 0) { b+=player1.coolSpeed; }
-                    coolTime+=player1.coolSpeed;
-                }
-                if (r > 240 && b < 10) {
-                    player1.turretsCooled = false;
-                }
-                if (r < 1) { r = 1; } else if (r > 255) { r = 255; }
-                if (b < 1) { b = 1; } else if (b > 255) { b = 255; }
-                if (r < 85 && b > 240) {
-                    player1.turretsCooled = true;
-                    coolTime = 0;
-                }
-                //printf("%d-%d-%d\n",r,g,b); // DEVTOOL
+// Swaps in the replay's input (if one is playing), then records it (if recording)
+// Returns false once the replay has run out
+bool replayInput(TickInput &input)
+{
+    if (gReplay.isLoaded()) {
+        // Closing the window still works during playback
+        bool quit = input.quit;
+        if (!gReplay.next(input))
+            return false;
+        input.quit = input.quit || quit;
+    }
+    gRecorder.record(input);
+    return true;
+}
 
-                for (Bullets *bulle = bull; bulle != NULL; bulle = bulle->next) {
-                    bulle->posY-=player1.bullSpeed;
-                }
+// Reports heap allocations made while the check was armed (gameplay frames and ticks must make none)
+void checkNoAllocations(const char *during)
+{
+    int allocations = takeHeapAllocations();
+    if (allocations > 0) {
+        printf("%s made %d heap allocations\n", during, allocations);
+        assert(allocations == 0);
+    }
+}
 
-                gHealthClip.y = 100-player1.health;
-                gHealthClip.h = player1.health;
-
-                // Stages --------------------------------------------------------------------------------------------------------------------------------
-                if (stages[0] && start && SDL_GetTicks() < gameTime+2000 && !gameOver) { loading[0] = true; } else { loading[0] = false; }
-                if (stages[1] && start && SDL_GetTicks() < gameTime+1500 && !gameOver) { loading[0] = false; loading[1] = true; } else { loading[1] = false; }
-                if (stages[2] && start && SDL_GetTicks() < gameTime+1500 && !gameOver) { loading[1] = false; loading[2] = true; } else { loading[2] = false; }
-
-                if (stages[0] == -1) {
-                } else if (stages[0] && start && SDL_GetTicks() > gameTime+2000 && !gameOver) {
-                    // Bring alien into frame
-                    if (Raider.posY < 0)
-                        Raider.posY+=Raider.getSpeed();
-                    // Alien moves to player
-                    if (Raider.posX <= player1.posX && !Raider.shooting)
-                        Raider.posX+=Raider.getSpeed();
-                    if (Raider.posX >= player1.posX && !Raider.shooting)
-                        Raider.posX-=Raider.getSpeed();
-                    if (!Raider.shooting && Raider.posX+gRaiderSprite.getWidth()/2 >= player1.posX && Raider.posX+gRaiderSprite.getWidth()/2 <= player1.posX+gFighterSprite.getWidth()/2) {
-                        Raider.shooting = true;
-                        aBulletX = Raider.posX+gRaiderSprite.getWidth()/2;
-                        aBulletY = Raider.posY+gRaiderSprite.getHeight()*2/3;
-                    }
-                    if (Raider.shooting) {
-                        aBulletY+=player1.bullSpeed*Raider.getRate();
-                    }
-                    // Alien bullet collision
-                    if (aBulletY > SCREEN_HEIGHT*3/2+gBulletSprite.getHeight()) {
-                        Raider.shooting = false;
-                        aBulletY = -gBulletSprite.getHeight();
-                    } else if (aBulletY > player1.posY && aBulletY < player1.posY+gFighterSprite.getHeight() && aBulletX > player1.posX && aBulletX < player1.posX+gFighterSprite.getWidth()) {
-                        aBulletY = SCREEN_HEIGHT;
-                        player1.health-=Raider.getDamage();
-                    }
-                    // Player bullet collision
-                    for (Bullets *bulle = bull; bulle != NULL; bulle = bulle->next) {
-                        if (bulle->posY < Raider.posY+gRaiderSprite.getHeight() && bulle->posX > Raider.posX && bulle->posX < Raider.posX+gRaiderSprite.getWidth()) {
-                            delNode(&bull, bulle->posX, bulle->posY);
-                            Raider.health-=player1.damage;
-                            int rad = rand()%10;
-                            if (rad == 0)
-                                player1.health++;
-                        }
-                        gBulletSprite.render(bulle->posX, bulle->posY);
-                    }
+// Golden runs: draws a snapshot into the headless surface, returns the render time in ms
+// Software rendering (--software) draws through the dirty rects, so both paths can be checked
+double renderHeadless(const RenderSnapshot &snapshot)
+{
+    Uint64 before = SDL_GetPerformanceCounter();
+    if (gSoftware)
+        renderDirty(snapshot, 1);
+    else
+        renderFrame(snapshot, 1);
+
+    // Finishes any batched drawing
+    SDL_RenderPresent(gRenderer);
+    return (double)(SDL_GetPerformanceCounter()-before)*1000/SDL_GetPerformanceFrequency();
+}
 
-                    if (Raider.health <= 0) {
-                        Raider.posY = -gRaiderSprite.getHeight();
-                        if (player1.turretsCooled) {
-                            stages[0] = 0;
-                            stages[1] = 1;
-                            gameTime = SDL_GetTicks();
-                            spdOnScrn = true;
-                        }
-                        aBulletY = -gBulletSprite.getHeight();
-                    }
-                } else if (stages[1] && spdOnScrn) {
-                    if (spdY < SCREEN_HEIGHT*4/5)
-                        spdY+=5;
-                    int ramd = rand()%20;
-                    if (ramd > 16)
-                        spdX-=5;
-                    if (ramd < 4)
-                        spdX+=5;
-                    if (spdY+gSpeedSprite.getHeight() > player1.posY && spdX+gSpeedSprite.getWidth() > player1.posX && spdX+gSpeedSprite.getWidth()/2 < player1.posX+gFighterSprite.getWidth()) {
-                        player1.speed+=4;
-                        player1.bullSpeed+=5;
-                        player1.coolSpeed+=1;
-                        player1.health+=30;
-                        spdY = -gSpeedSprite.getHeight();
-                        spdOnScrn = false;
-                    } else if (spdY+gSpeedSprite.getHeight() > player1.posY && spdX > player1.posX && spdX < player1.posX+gFighterSprite.getWidth()) {
-                        player1.speed+=4;
-                        player1.bullSpeed+=5;
-                        player1.coolSpeed+=1;
-                        player1.health+=30;
-                        spdY = -gSpeedSprite.getHeight();
-                        spdOnScrn = false;
-                    }
-                } else if (stages[1] && start && SDL_GetTicks() > gameTime+1500 && !gameOver) {
-                    if (Striker.posY < 0)
-                        Striker.posY+=Striker.getSpeed();
-                    if (Striker.posX <= player1.posX && !Striker.shooting)
-                        Striker.posX+=Striker.getSpeed();
-                    if (Striker.posX >= player1.posX && !Striker.shooting)
-                        Striker.posX-=Striker.getSpeed();
-                    if (Striker.timeSinceMove == 0)
-                        Striker.timeSinceMove = SDL_GetTicks();
-                    int randNum = rand() % 10;
-                    if (randNum > 6 && Striker.timeSinceMove+300 < SDL_GetTicks() && Striker.posY+gStrikerSprite.getHeight()+Striker.getSpeed() < SCREEN_HEIGHT/2) {
-                        Striker.posY+=Striker.getSpeed()/3;
-                        Striker.timeSinceMove = SDL_GetTicks();
-                    } else if (randNum < 1 && Striker.timeSinceMove+300 < SDL_GetTicks() && Striker.posY+Striker.getSpeed() > 0) {
-                        Striker.posY-=Striker.getSpeed()/3;
-                        Striker.timeSinceMove = SDL_GetTicks();
-                    }
-                    if (!Striker.shooting && Striker.posX+gStrikerSprite.getWidth()/2 >= player1.posX && Striker.posX+gStrikerSprite.getWidth()/2 <= player1.posX+gFighterSprite.getWidth()/2) {
-                        Striker.shooting = true;
-                        aBulletX = Striker.posX+gStrikerSprite.getWidth()/2;
-                        aBulletY = Striker.posY+gStrikerSprite.getHeight()*2/3;
-                    }
-                    if (Striker.shooting) {
-                        aBulletY+=player1.bullSpeed*Striker.getRate();
-                    }
-                    // Alien bullet collision
-                    if (aBulletY > SCREEN_HEIGHT+gBulletSprite.getHeight()) {
-                        Striker.shooting = false;
-                        aBulletY = -gBulletSprite.getHeight();
-                    } else if (aBulletY > player1.posY && aBulletX > player1.posX && aBulletX < player1.posX+gFighterSprite.getWidth()) {
-                        Striker.shooting = false;
-                        aBulletY = -gBulletSprite.getHeight();
-                        player1.health-=Striker.getDamage();
-                    }
-                    // Player bullet collision
-                    for (Bullets *bulle = bull; bulle != NULL; bulle = bulle->next) {
-                        if (bulle->posY < Striker.posY+gStrikerSprite.getHeight() && bulle->posX > Striker.posX && bulle->posX < Striker.posX+gStrikerSprite.getWidth()) {
-                            delNode(&bull, bulle->posX, bulle->posY);
-                            Striker.health-=player1.damage;
-                            int rad = rand()%10;
-                            if (rad == 0)
-                                player1.health++;
-                        }
-                        gBulletSprite.render(bulle->posX, bulle->posY);
-                    }
-                    if (Striker.health <= 0) {
-                        Striker.posY = -gStrikerSprite.getHeight();
-                        if (player1.turretsCooled) {
-                            stages[1] = 0;
-                            stages[2] = 1;
-                            gameTime = SDL_GetTicks();
-                            damgOnScrn = true;
-                        }
-                        aBulletY = -gBulletSprite.getHeight();
-                    }
-                } else if (stages[2] && damgOnScrn) {
-                    if (damgY < SCREEN_HEIGHT*4/5)
-                        damgY+=5;
-                    int ramd = rand()%20;
-                    if (ramd > 16)
-                        damgX-=5;
-                    if (ramd < 4)
-                        damgX+=5;
-                    if (damgY+gDamageSprite.getHeight() > player1.posY && damgX+gDamageSprite.getWidth() > player1.posX && damgX+gDamageSprite.getWidth()/2 < player1.posX+gFighterSprite.getWidth()) {
-                        player1.health+=40;
-                        player1.damage+=30;
-                        damgY = -gDamageSprite.getHeight();
-                        damgOnScrn = false;
-                    } else if (damgY+gDamageSprite.getHeight() > player1.posY && damgX > player1.posX && damgX < player1.posX+gFighterSprite.getWidth()) {
-                        player1.health+=40;
-                        player1.damage+=30;
-                        damgY = -gDamageSprite.getHeight();
-                        damgOnScrn = false;
-                    }
-                } else if (stages[2] && start && SDL_GetTicks() > gameTime+1500 && !gameOver) {
-                    if (Thrasher.posY < 0)
-                        Thrasher.posY+=Thrasher.getSpeed();
-                    if (Thrasher.posX <= player1.posX && !Thrasher.shooting)
-                        Thrasher.posX+=Thrasher.getSpeed();
-                    if (Thrasher.posX >= player1.posX && !Thrasher.shooting)
-                        Thrasher.posX-=Thrasher.getSpeed();
-                    if (!Thrasher.shooting && Thrasher.posX+gThrasherSprite.getWidth()/2 >= player1.posX && Thrasher.posX+gThrasherSprite.getWidth()/2 <= player1.posX+gFighterSprite.getWidth()/2) {
-                        Thrasher.shooting = true;
-                        aBulletX = Thrasher.posX+gThrasherSprite.getWidth()/2;
-                        aBulletY = Thrasher.posY+gThrasherSprite.getHeight()*2/3;
-                    }
-                    if (Thrasher.shooting) {
-                        aBulletY+=player1.bullSpeed*Thrasher.getRate();
-                    }
-                    // Alien bullet collision
-                    if (aBulletY > SCREEN_HEIGHT*3+gBulletSprite.getHeight()) {
-                        Thrasher.shooting = false;
-                        aBulletY = -gBulletSprite.getHeight();
-                    } else if (aBulletY > player1.posY && aBulletY < player1.posY+gFighterSprite.getHeight() && aBulletX > player1.posX && aBulletX < player1.posX+gFighterSprite.getWidth()) {
-                        aBulletY = SCREEN_HEIGHT;
-                        player1.health-=Thrasher.getDamage();
-                    }
-                    // Player bullet collision
-                    for (Bullets *bulle = bull; bulle != NULL; bulle = bulle->next) {
-                        if (bulle->posY < Thrasher.posY+gThrasherSprite.getHeight() && bulle->posX > Thrasher.posX && bulle->posX < Thrasher.posX+gThrasherSprite.getWidth()) {
-                            delNode(&bull, bulle->posX, bulle->posY);
-                            Thrasher.health-=player1.damage;
-                            int rad = rand()%10;
-                            if (rad == 0)
-                                player1.health++;
-                        }
-                        gBulletSprite.render(bulle->posX, bulle->posY);
-                    }
-                    if (Thrasher.health <= 0) {
-                        Thrasher.posY = -gThrasherSprite.getHeight();
-                        player1.health+=10;
-                        stages[2] = 0;
-                        aBulletY = -gBulletSprite.getHeight();
-                        gameTime = SDL_GetTicks();
-                    }
-                } else if (!stages[0] && !stages[1] && !stages[2]) {
-                    gameOver = true;
-                    win = true;
-                    player1.shooting = false;
-                    if (!flag) {
-                        flag = true;
-                        gameTime = SDL_GetTicks();
-                    }
+// Golden runs: hashes the frame drawn after tick if it's one to write or check (counted in checked)
+// Returns false if it doesn't match the golden list (the frame is saved as golden_<tick>.bmp to compare)
+bool checkGoldenFrame(Uint32 tick, int &checked)
+{
+    if (gGoldenWrite) {
+        if (tick % GOLDEN_INTERVAL == 0)
+            gGoldenFrames.add(tick, hashSurface(gHeadlessSurface));
+        return true;
+    }
 
-                }
+    Uint64 golden;
+    if (!gGoldenFrames.find(tick, golden))
+        return true;
+    checked++;
+    Uint64 hash = hashSurface(gHeadlessSurface);
+    if (hash == golden)
+        return true;
+
+    char path[32];
+    snprintf(path, sizeof(path), "golden_%u.bmp", tick);
+    SDL_SaveBMP(gHeadlessSurface, path);
+    printf("Golden frame mismatch on tick %u: %016llx, expected %016llx (saved %s)\n", tick, (unsigned long long)hash, (unsigned long long)golden, path);
+    return false;
+}
 
-                if (player1.health <= 1) {
-                    player1.health = 1;
-                    player1.shooting = false;
-                    gameOver = true;
-                } else if (player1.health > 100) {
-                    player1.health = 100;
-                }
+// Runs the simulation uncapped (no rendering) and reports simulated ticks per second
+// With a replay it plays exactly the recorded session instead of the scripted player
+// Golden runs also draw every tick, then check or write the frame hashes and report render times
+// Returns false if a golden check failed
+bool runHeadless(Uint32 ticks)
+{
+    GameState game(gSeed);
+    int games = 1;
+
+    // Golden runs only
+    RenderSnapshot snapshot;
+    std::vector<double> renderMs;
+    int checked = 0;
+    int mismatches = 0;
+    if (gGoldenPath) {
+        renderMs.reserve(gReplay.isLoaded() ? gReplay.getTickCount() : ticks);
+        if (gGoldenWrite)
+            gGoldenFrames.reset(gSeed);
+    }
 
-                if (SDL_GetTicks()-startTime >= 179000 && start) { player1.shooting = false; gameOver = true; }
-
-
-                // RENDER monster code
-				// Clear the window
-				SDL_SetRenderDrawColor(gRenderer, 0xFF, 0xFF, 0xFF, 0xFF);
-				SDL_RenderClear(gRenderer);
-
-				// Render background(s)
-				gBackgroundTexture.render(0,backgroundY[0]);
-				gBackgroundTexture.render(0, backgroundY[1]);
-
-				// Render projectiles
-				for (Bullets *bulle = bull; bulle != NULL; bulle = bulle->next)
-                    gBulletSprite.render(bulle->posX, bulle->posY);
-				if (Raider.shooting || Striker.shooting || Thrasher.shooting)
-                    gABulletSprite.render(aBulletX, aBulletY);
-
-                // Render items
-                if (spdOnScrn)
-                    gSpeedSprite.render(spdX, spdY);
-                if (damgOnScrn)
-                    gDamageSprite.render(damgX, damgY);
-
-                // Render enemies
-                if (enemies[1] && Raider.health > .75*Raider.getMaxHealth()) {
-                    gRaiderSprite.render(Raider.posX, Raider.posY);
-                } else if (enemies[1] && Raider.health > .5*Raider.getMaxHealth()) {
-                    gRaiderDam1Sprite.render(Raider.posX, Raider.posY);
-                } else if (enemies[1] && Raider.health > .25*Raider.getMaxHealth()) {
-                    gRaiderDam2Sprite.render(Raider.posX, Raider.posY);
-                } else {
-                    gRaiderDam3Sprite.render(Raider.posX, Raider.posY);
-                }
-                if (enemies[2] && Striker.health > .75*Striker.getMaxHealth()) {
-                    gStrikerSprite.render(Striker.posX, Striker.posY);
-                } else if (enemies[2] && Striker.health > .5*Striker.getMaxHealth()) {
-                    gStrikerDam1Sprite.render(Striker.posX, Striker.posY);
-                } else if (enemies[2] && Striker.health > .25*Striker.getMaxHealth()) {
-                    gStrikerDam2Sprite.render(Striker.posX, Striker.posY);
-                } else {
-                    gStrikerDam3Sprite.render(Striker.posX, Striker.posY);
-                }
-                if (enemies[3] && Thrasher.health > .75*Thrasher.getMaxHealth()) {
-                    gThrasherSprite.render(Thrasher.posX, Thrasher.posY);
-                } else if (enemies[3] && Thrasher.health > .5*Thrasher.getMaxHealth()) {
-                    gThrasherDam1Sprite.render(Thrasher.posX, Thrasher.posY);
-                } else if (enemies[3] && Thrasher.health > .25*Thrasher.getMaxHealth()) {
-                    gThrasherDam2Sprite.render(Thrasher.posX, Thrasher.posY);
-                } else {
-                    gThrasherDam3Sprite.render(Thrasher.posX, Thrasher.posY);
-                }
+    Uint64 startCounter = SDL_GetPerformanceCounter();
+    Uint32 t = 0;
+    for (; gReplay.isLoaded() || t < ticks; t++) {
+        TickInput input = scriptedInput(t);
+        if (!replayInput(input) || game.quit)
+            break;
+        armHeapCheck(game.start && !game.launching && !game.gameOver);
+        game.tick(input);
+        gTickArena.reset();
+        armHeapCheck(false);
+        checkNoAllocations("Gameplay tick");
+
+        if (gGoldenPath) {
+            game.capture(snapshot);
+            renderMs.push_back(renderHeadless(snapshot));
+            if (!checkGoldenFrame(t+1, checked))
+                mismatches++;
+        }
 
-                if (start) {
-                    if (!win) {
-                        // Render HUD
-                        gHealthSprite.render(SCREEN_WIDTH/30, SCREEN_HEIGHT/40+100-player1.health, &gHealthClip);
-                        gAmmoSprite.setColorMod( r, g, b );
-                        gAmmoSprite.render(SCREEN_WIDTH-SCREEN_WIDTH*1/30-gAmmoSprite.getWidth(), SCREEN_HEIGHT/40);
-                    }
-
-                    // Render turrets
-                    gTurretSprite.render(player1.posX+gFighterSprite.getWidth()/6,player1.turretY);
-                    gTurretSprite.render(player1.posX+gFighterSprite.getWidth()*4/6,player1.turretY,0,0,0,SDL_FLIP_HORIZONTAL);
-
-                    // Render fighter
-                    gFighterSprite.render(player1.posX, player1.posY);
-                } else {
-                    gTextTextureStar.render((SCREEN_WIDTH-gTextTextureStar.getWidth())/2, SCREEN_HEIGHT/2-gTextTextureStar.getHeight());
-                    gTextTextureCollider.render((SCREEN_WIDTH-gTextTextureCollider.getWidth())/2, SCREEN_HEIGHT/2);
-                    pressStart.str("Press space to start");
-                    gPressStartTexture.loadFromRenderedText( pressStart.str().c_str(), textColor, pressStartFont );
-                    gPressStartTexture.setAlphaMod(((sin(((double)p2StartA/255)*360 * PI/180)+1)/2*(255*10/9)) <= 255 ? (sin(((double)p2StartA/255)*360 * PI/180)+1)/2*(255*10/9) : 255);
-                    gPressStartTexture.render(SCREEN_WIDTH/2-gPressStartTexture.getWidth()/2, SCREEN_HEIGHT*2/3);
-                    p2StartA++;
+        // Keep measuring gameplay, not the game over screen (a replay plays out as recorded)
+        if (game.gameOver && !gReplay.isLoaded()) {
+            game = GameState(gSeed);
+            games++;
+        }
+    }
+    double seconds = (double)(SDL_GetPerformanceCounter()-startCounter)/SDL_GetPerformanceFrequency();
+
+    printf("Headless: %u ticks (%d games, %d job workers) in %.3f s, %.0f ticks/s (%.2f us/tick)\n", t, games, gJobs.getWorkerCount(), seconds, t/seconds, seconds*1000000/t);
+    if (gReplay.isLoaded())
+        printf("Replay ended on tick %u with score %d and health %d\n", t, game.score, game.player1.health);
+    if (!gGoldenPath)
+        return true;
+
+    RenderTimeStats render = summarizeRenderTimes(renderMs);
+    printf("Rendered %d frames: %.3f ms average, %.3f ms median, %.3f ms p99, %.3f ms max\n",
+           render.frames, render.averageMs, render.medianMs, render.p99Ms, render.maxMs);
+    if (gRenderTimesPath && dumpRenderTimes(gRenderTimesPath, renderMs))
+        printf("Wrote render times to %s\n", gRenderTimesPath);
+
+    if (gGoldenWrite) {
+        // The last frame is always listed, so a check runs exactly as long
+        if (t > 0 && gGoldenFrames.getLastTick() != t)
+            gGoldenFrames.add(t, hashSurface(gHeadlessSurface));
+        if (!gGoldenFrames.save(gGoldenPath))
+            return false;
+        printf("Wrote %d golden frames to %s\n", gGoldenFrames.getFrameCount(), gGoldenPath);
+        return true;
+    }
+    printf("Golden frames: %d of %d checked, %d mismatched\n", checked, gGoldenFrames.getFrameCount(), mismatches);
+    return mismatches == 0 && checked == gGoldenFrames.getFrameCount();
+}
+
+// Runs the game on its own thread at TICKS_PER_SECOND, publishing a snapshot after each tick
+// The main thread only handles events and draws the newest snapshot, so a slow present never delays a tick
+class SimulationThread
+{
+    public:
+        // With lateInput each tick waits (up to LATE_INPUT_WAIT_TICKS) for a sample newer than its due time
+        SimulationThread(unsigned int seed, bool lateInput);
+        ~SimulationThread();
+
+        // Publishes the first snapshot and starts ticking, returns false if the thread can't be created
+        bool start();
+
+        // Waits for the thread to finish (it stops once the game quits)
+        void stop();
+
+        // Main thread: hands over the newest input (start and quit presses are kept until a tick sees them)
+        // along with the newest input event stamp it includes
+        void post(const TickInput &input, Uint64 eventTime);
+
+        // Main thread: gets the newest snapshot (stays untouched until the next call)
+        const RenderSnapshot &latest();
+
+        // Main thread: gets the time spent ticking since the last call, in performance counter ticks
+        Uint64 takeLogicTime();
+
+    private:
+        static int run(void *data);
+        void loop();
+
+        // Waits until input is posted at or after since, giving up at until (both performance counter times)
+        void waitForInput(Uint64 since, Uint64 until);
+
+        // Gets the input posted for the next tick, and its newest event stamp
+        TickInput takeInput(Uint64 &eventTime);
+
+        // Only touched by the simulation thread once started
+        GameState mGame;
+
+        TripleBuffer<RenderSnapshot> mSnapshots;
+        SDL_Thread *mThread;
+
+        bool mLateInput;
+
+        // Guards mInput, mEventTime, mPostTime and mLogicTime, mPosted is signalled on every post
+        SDL_mutex *mLock;
+        SDL_cond *mPosted;
+        TickInput mInput;
+        Uint64 mEventTime;
+        Uint64 mPostTime;
+        Uint64 mLogicTime;
+};
+
+SimulationThread::SimulationThread(unsigned int seed, bool lateInput) : mGame(seed)
+{
+    mThread = NULL;
+    mLateInput = lateInput;
+    mLock = SDL_CreateMutex();
+    mPosted = SDL_CreateCond();
+    memset(&mInput, 0, sizeof(mInput));
+    mEventTime = 0;
+    mPostTime = 0;
+    mLogicTime = 0;
+}
+
+SimulationThread::~SimulationThread()
+{
+    stop();
+    if (mPosted)
+        SDL_DestroyCond(mPosted);
+    if (mLock)
+        SDL_DestroyMutex(mLock);
+}
+
+bool SimulationThread::start()
+{
+    if (!mLock || !mPosted) {
+        printf("Unable to create simulation lock. SDL Error: %s\n", SDL_GetError());
+        return false;
+    }
+
+    RenderSnapshot &snapshot = mSnapshots.back();
+    mGame.capture(snapshot);
+    snapshot.time = SDL_GetPerformanceCounter();
+    snapshot.eventTime = 0;
+    mSnapshots.publish();
+
+    mThread = SDL_CreateThread(run, "Simulation", this);
+    if (!mThread) {
+        printf("Unable to create simulation thread. SDL Error: %s\n", SDL_GetError());
+        return false;
+    }
+    return true;
+}
+
+void SimulationThread::stop()
+{
+    if (mThread) {
+        SDL_WaitThread(mThread, NULL);
+        mThread = NULL;
+    }
+}
+
+void SimulationThread::post(const TickInput &input, Uint64 eventTime)
+{
+    SDL_LockMutex(mLock);
+    bool start = mInput.start;
+    bool quit = mInput.quit;
+    mInput = input;
+    mInput.start = input.start || start;
+    mInput.quit = input.quit || quit;
+    mEventTime = eventTime;
+    mPostTime = SDL_GetPerformanceCounter();
+    SDL_CondSignal(mPosted);
+    SDL_UnlockMutex(mLock);
+}
+
+const RenderSnapshot &SimulationThread::latest() { return mSnapshots.front(); }
+
+Uint64 SimulationThread::takeLogicTime()
+{
+    SDL_LockMutex(mLock);
+    Uint64 logicTime = mLogicTime;
+    mLogicTime = 0;
+    SDL_UnlockMutex(mLock);
+    return logicTime;
+}
+
+void SimulationThread::waitForInput(Uint64 since, Uint64 until)
+{
+    Uint64 frequency = SDL_GetPerformanceFrequency();
+
+    SDL_LockMutex(mLock);
+    while (mPostTime < since) {
+        Uint64 counter = SDL_GetPerformanceCounter();
+        if (counter >= until) { break; }
+        Uint32 ms = (Uint32)((until-counter)*1000/frequency);
+        SDL_CondWaitTimeout(mPosted, mLock, ms > 0 ? ms : 1);
+    }
+    SDL_UnlockMutex(mLock);
+}
+
+TickInput SimulationThread::takeInput(Uint64 &eventTime)
+{
+    SDL_LockMutex(mLock);
+    TickInput input = mInput;
+    eventTime = mEventTime;
+    mInput.start = false;
+    SDL_UnlockMutex(mLock);
+    return input;
+}
+
+int SimulationThread::run(void *data)
+{
+    ((SimulationThread*)data)->loop();
+    return 0;
+}
+
+void SimulationThread::loop()
+{
+    Uint64 frequency = SDL_GetPerformanceFrequency();
+    Uint64 tickLength = frequency/TICKS_PER_SECOND;
+    Uint64 maxLag = (Uint64)(MAX_FRAME_SECONDS*frequency);
+    Uint64 due = SDL_GetPerformanceCounter();
+    Uint64 lateWait = (Uint64)(LATE_INPUT_WAIT_TICKS*tickLength);
+    Uint64 lateGrace = frequency*LATE_INPUT_GRACE_MS/1000;
+    Uint64 newestEvent = 0;
+
+    while (!mGame.quit) {
+        Uint64 counter = SDL_GetPerformanceCounter();
+        if (counter < due) {
+            // Sleeps until the next tick is due, yielding the last millisecond or so instead
+            Uint32 ms = (Uint32)((due-counter)*1000/frequency);
+            SDL_Delay(ms > 1 ? ms-1 : 0);
+            continue;
+        }
+        if (counter-due > maxLag)
+            due = counter-maxLag;
+
+        // The main thread samples once a frame, so the tick waits for the next sample instead of
+        // reading one from up to a frame ago (never while catching up, and never past lateWait,
+        // so the tick rate stays the same)
+        if (mLateInput && counter-due < lateWait) {
+            waitForInput(due-lateGrace, due+lateWait);
+            counter = SDL_GetPerformanceCounter();
+        }
+
+        Uint64 eventTime;
+        TickInput input = takeInput(eventTime);
+        if (eventTime > newestEvent)
+            newestEvent = eventTime;
+        if (!replayInput(input)) {
+            printf("Replay finished\n");
+            mGame.quit = true;
+            break;
+        }
+        mGame.storePositions();
+        mGame.tick(input);
+        gTickArena.reset();
+        Uint64 tickDue = due;
+        due+=tickLength;
+
+        // Only the newest tick of a catch-up burst is worth drawing
+        if (SDL_GetPerformanceCounter() < due || mGame.quit) {
+            RenderSnapshot &snapshot = mSnapshots.back();
+            mGame.capture(snapshot);
+            snapshot.time = tickDue;
+            snapshot.eventTime = newestEvent;
+            mSnapshots.publish();
+        }
+
+        SDL_LockMutex(mLock);
+        mLogicTime+=SDL_GetPerformanceCounter()-counter;
+        SDL_UnlockMutex(mLock);
+    }
+
+    // Last snapshot carries the quit to the main thread
+    RenderSnapshot &snapshot = mSnapshots.back();
+    mGame.capture(snapshot);
+    snapshot.time = due;
+    snapshot.eventTime = newestEvent;
+    mSnapshots.publish();
+}
+
+// Handles events and hands the sampled input to the simulation
+void pollInput(SimulationThread &simulation, const RenderSnapshot &game, Controls &controls)
+{
+    handleEvents(game, controls);
+    simulation.post(sampleInput(controls), gInputLatency.getNewestEvent());
+}
+
+int main (int argc, char *args[])
+{
+    // Simulated ticks for a headless run (default is ten minutes of game time)
+    Uint32 headlessTicks = TICKS_PER_SECOND*600;
+    bool ticksGiven = false;
+
+    // Sessions get a new seed each run unless one is given; headless runs default to 1 so they compare
+    bool seedGiven = false;
+
+    // Job worker threads, -1 picks one per spare core
+    int workers = -1;
+
+    // Command line: --headless [--ticks N], --software, --audio-buffer N, --audio-stats, --draw-stats, --load-stats, --waves FILE, --profile,
+    // --seed N, --record FILE, --replay FILE, --workers N, --late-input, --input-stats, --golden FILE, --golden-write FILE, --render-times FILE
+    const char *recordPath = NULL;
+    const char *replayPath = NULL;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(args[i], "--headless") == 0) {
+            gHeadless = true;
+        } else if (strcmp(args[i], "--audio-buffer") == 0 && i+1 < argc) {
+            gAudioBuffer = atoi(args[++i]);
+            if (gAudioBuffer < 64) { gAudioBuffer = 64; }
+        } else if (strcmp(args[i], "--audio-stats") == 0) {
+            gAudioStats = true;
+        } else if (strcmp(args[i], "--software") == 0) {
+            gSoftware = true;
+        } else if (strcmp(args[i], "--draw-stats") == 0) {
+            gDrawStats = true;
+        } else if (strcmp(args[i], "--load-stats") == 0) {
+            gLoadStats = true;
+        } else if (strcmp(args[i], "--late-input") == 0) {
+            gLateInput = true;
+        } else if (strcmp(args[i], "--input-stats") == 0) {
+            gInputStats = true;
+        } else if (strcmp(args[i], "--profile") == 0) {
+            gShowProfiler = true;
+        } else if (strcmp(args[i], "--waves") == 0 && i+1 < argc) {
+            gWaveFile = args[++i];
+        } else if (strcmp(args[i], "--ticks") == 0 && i+1 < argc) {
+            headlessTicks = strtoul(args[++i], NULL, 10);
+            ticksGiven = true;
+        } else if (strcmp(args[i], "--seed") == 0 && i+1 < argc) {
+            gSeed = strtoul(args[++i], NULL, 10);
+            seedGiven = true;
+        } else if (strcmp(args[i], "--record") == 0 && i+1 < argc) {
+            recordPath = args[++i];
+        } else if (strcmp(args[i], "--replay") == 0 && i+1 < argc) {
+            replayPath = args[++i];
+        } else if (strcmp(args[i], "--workers") == 0 && i+1 < argc) {
+            workers = atoi(args[++i]);
+        } else if ((strcmp(args[i], "--golden") == 0 || strcmp(args[i], "--golden-write") == 0) && i+1 < argc) {
+            gGoldenWrite = strcmp(args[i], "--golden-write") == 0;
+            gGoldenPath = args[++i];
+            gHeadless = true;
+        } else if (strcmp(args[i], "--render-times") == 0 && i+1 < argc) {
+            gRenderTimesPath = args[++i];
+        } else {
+            printf("Warning: Unknown option %s\n", args[i]);
+        }
+    }
+
+    if (!loadWaves())
+        return 1;
+
+    // A replay brings its own seed (and must play the waves it was recorded with), and the recording
+    // gets whichever seed is used
+    if (replayPath) {
+        if (!gReplay.load(replayPath))
+            return 1;
+        if (gReplay.getWavesHash() != gWaveScript.getHash()) {
+            printf("Replay %s was recorded with different waves than %s.\n", replayPath, gWaveFile ? gWaveFile : "the built-in ones");
+            return 1;
+        }
+        gSeed = gReplay.getSeed();
+        printf("Replaying %u ticks from %s (seed %u)\n", gReplay.getTickCount(), replayPath, gSeed);
+    } else if (!seedGiven && !gHeadless) {
+        gSeed = (unsigned int)time(NULL);
+    }
+
+    // A golden list brings its seed and length too (it has to match a replay's seed)
+    if (gGoldenPath && !gGoldenWrite) {
+        if (!gGoldenFrames.load(gGoldenPath))
+            return 1;
+        if (replayPath && gGoldenFrames.getSeed() != gSeed) {
+            printf("Golden frames %s were made with seed %u, the replay uses %u.\n", gGoldenPath, gGoldenFrames.getSeed(), gSeed);
+            return 1;
+        }
+        gSeed = gGoldenFrames.getSeed();
+        headlessTicks = gGoldenFrames.getLastTick();
+    } else if (gGoldenPath && !ticksGiven) {
+        headlessTicks = GOLDEN_TICKS;
+    }
+
+    if (recordPath && !gRecorder.open(recordPath, gSeed, gWaveScript.getHash())) {
+        return 1;
+    }
+
+    // The profiler overlay shows timings, which would never hash the same
+    if (gGoldenPath)
+        gShowProfiler = false;
+
+    // Exit status, 1 if a golden check fails
+    int status = 0;
+
+	// Initialize SDL and create window
+	if(!init()) {
+		printf( "Failed to initialize\n" );
+	} else {
+        // Leaves a core each for the main and simulation threads (jobs run inline if workers can't start)
+        if (workers < 0)
+            workers = SDL_GetCPUCount()-2;
+        gJobs.start(workers);
+
+		// Load media
+		if(!loadMedia()) {
+			printf( "Failed to load media\n" );
+		} else if (gHeadless) {
+            if (!runHeadless(headlessTicks))
+                status = 1;
+		} else {
+            Controls controls = {0, 0, false, false, false};
+
+            Mix_PlayMusic(gIdleMusic, -1);
+
+            // Simulation runs in fixed ticks on its own thread, rendering runs as fast as vsync allows
+            SimulationThread simulation(gSeed, gLateInput);
+            const double tickLength = (double)SDL_GetPerformanceFrequency()/TICKS_PER_SECOND;
+            bool quit = !simulation.start();
+
+            // Software frames have no vsync to pace them, so they keep to the display's refresh rate
+            SDL_DisplayMode displayMode;
+            int refreshRate = 60;
+            if (SDL_GetWindowDisplayMode(gWindow, &displayMode) == 0 && displayMode.refresh_rate > 0)
+                refreshRate = displayMode.refresh_rate;
+            const Uint64 frameLength = SDL_GetPerformanceFrequency()/refreshRate;
+
+            // Draw call stats (--draw-stats)
+            int statFrames = 0;
+            int statDrawCalls = 0;
+            double statCoverage = 0;
+            Uint64 statCounter = SDL_GetPerformanceCounter();
+            Uint64 audioStatCounter = statCounter;
+            Uint64 inputStatCounter = statCounter;
+
+			// While game is running
+			while(!quit) {
+                Uint64 counter = SDL_GetPerformanceCounter();
+
+                gProfiler.beginFrame();
+                const RenderSnapshot *snapshot = &simulation.latest();
+                if (!gLateInput) {
+                    ProfileScope profile(gProfiler, PHASE_INPUT);
+                    pollInput(simulation, *snapshot, controls);
+                }
+                quit = snapshot->quit;
+
+                // Once play starts nothing should touch the heap, on any thread (checked without NDEBUG)
+                bool playing = snapshot->start && !snapshot->launching && !snapshot->gameOver;
+                armHeapCheck(playing);
+
+                // Ticks ran on the simulation thread meanwhile (so this overlaps the other phases)
+                gProfiler.add(PHASE_LOGIC, simulation.takeLogicTime());
+
+                gDrawCalls = 0;
+                {
+                    ProfileScope profile(gProfiler, PHASE_RENDER);
+                    double alpha = (SDL_GetPerformanceCounter()-snapshot->time)/tickLength;
+                    if (gSoftware)
+                        renderDirty(*snapshot, alpha < 1 ? alpha : 1);
+                    else
+                        renderFrame(*snapshot, alpha < 1 ? alpha : 1);
                 }
 
-                // Render level text
-                for (size_t i = 0; i < sizeof(loading); i++) {
-                    if (loading[i] && i == 0)
-                        gTextTextureLevel1.render(SCREEN_WIDTH/2-gTextTextureLevel1.getWidth()/2, SCREEN_HEIGHT/2-gTextTextureLevel1.getHeight()/2);
-                    if (loading[i] && i == 1)
-                        gTextTextureLevel2.render(SCREEN_WIDTH/2-gTextTextureLevel2.getWidth()/2, SCREEN_HEIGHT/2-gTextTextureLevel2.getHeight()/2);
-                    if (loading[i] && i == 2)
-                        gTextTextureLevel3.render(SCREEN_WIDTH/2-gTextTextureLevel3.getWidth()/2, SCREEN_HEIGHT/2-gTextTextureLevel3.getHeight()/2);
+                // Late input samples after drawing, right before blocking on vsync
+                if (gLateInput) {
+                    ProfileScope profile(gProfiler, PHASE_INPUT);
+                    pollInput(simulation, *snapshot, controls);
                 }
 
-                // Render game over text
-                if (gameOver && !win) {
-                    gTextTextureGame.render((SCREEN_WIDTH-gTextTextureGame.getWidth())/2, SCREEN_HEIGHT/2-gTextTextureGame.getHeight());
-                    gTextTextureOver.render((SCREEN_WIDTH-gTextTextureOver.getWidth())/2, SCREEN_HEIGHT/2);
-                    volume--;
-                } else if (gameOver && win) {
-                    if (player1.turretY < player1.posY+gFighterSprite.getHeight()/2) {
-                        player1.turretY+=player1.turretSpeed;
-                    } else if (player1.posX+gFighterSprite.getWidth()/2-SCREEN_WIDTH/2 > 10) {
-                        player1.posX-=5;
-                        puts("a");
-                    } else if (player1.posX+gFighterSprite.getWidth()/2-SCREEN_WIDTH/2 < -10) {
-                        player1.posX+=5;
-                        printf("%db\n",player1.posX+gFighterSprite.getWidth()/2-SCREEN_WIDTH/2);
-                    } else {
-                        player1.posX = SCREEN_WIDTH/2-gFighterSprite.getWidth()/2;
-                    }
-                    if (SDL_GetTicks() > gameTime+2000 && player1.posY > -gFighterSprite.getHeight() && player1.posX+gFighterSprite.getWidth()/2 == SCREEN_WIDTH/2) {
-                        player1.posY-=2*accel;
-                        player1.turretY-=2*accel;
-                        backgroundSpeed = 6;
-                        accel+=.5;
+				// Update window (blocks here on vsync, or waits out the frame in software)
+                {
+                    ProfileScope profile(gProfiler, PHASE_PRESENT);
+                    if (gSoftware) {
+                        presentDirty();
+                        gInputLatency.presented(snapshot->eventTime, SDL_GetPerformanceCounter());
+                        Uint64 elapsed = SDL_GetPerformanceCounter()-counter;
+                        if (elapsed < frameLength)
+                            SDL_Delay((Uint32)((frameLength-elapsed)*1000/SDL_GetPerformanceFrequency()));
                     } else {
-                        backgroundSpeed = 10;
-                        if (player1.posY <= -gFighterSprite.getHeight())
-                            gWinnerSprite.render(0, SCREEN_HEIGHT/2-gWinnerSprite.getHeight()/2);
-                        //volume--;
-                        if (score == 0)
-                            score = 179 - (SDL_GetTicks()-startTime)/1000;
+                        SDL_RenderPresent(gRenderer);
+                        gInputLatency.presented(snapshot->eventTime, SDL_GetPerformanceCounter());
                     }
                 }
-                //printf("%d\n", SDL_GetTicks()-startTime);
-                Mix_VolumeMusic(volume);
-                //printf("Average volume is %d\n",volume);
-                //printf("%f\n",(sin(((double)p2StartA/255)*360 * PI/180)+1)/2*(255*10/9));
-                //printf("%d-%d\n",backgroundY[0], backgroundY[1]);
-                //printf("%d\n",score);
-
-				// Update window
-				SDL_RenderPresent(gRenderer);
-			}
-		}
-	}
-
-	// Free resources and close SDL
-	close();
-
-	return 0;
+                gProfiler.endFrame();
+
+                statFrames++;
+                statDrawCalls+=gDrawCalls;
+                statCoverage+=gSoftware ? gDirty.getCoverage() : 1;
+                if (gDrawStats && counter-statCounter >= SDL_GetPerformanceFrequency()) {
+                    printf("Draw calls: %.1f per frame (%d frames, %.0f%% of the screen redrawn)\n", (double)statDrawCalls/statFrames, statFrames, statCoverage*100/statFrames);
+                    statFrames = 0;
+                    statDrawCalls = 0;
+                    statCoverage = 0;
+                    statCounter = counter;
+                }
+                if (gAudioStats && counter-audioStatCounter >= SDL_GetPerformanceFrequency()) {
+                    SoundStats sound = gSfx.takeStats();
+                    printf("Sound effects: %d played (%d stolen), %d limited, %d dropped, latency %.1f ms average, %.1f ms max\n",
+                           sound.played, sound.stolen, sound.limited, sound.dropped, sound.averageLatencyMs, sound.maxLatencyMs);
+                    audioStatCounter = counter;
+                }
+                checkNoAllocations("Gameplay frame");
+                if (gInputStats && counter-inputStatCounter >= SDL_GetPerformanceFrequency()) {
+                    LatencyStats latency = gInputLatency.takeStats();
+                    if (latency.samples > 0)
+                        printf("Input latency: %d events, %.1f ms median, %.1f ms p90, %.1f ms p99, %.1f ms max\n",
+                               latency.samples, latency.p50Ms, latency.p90Ms, latency.p99Ms, latency.maxMs);
+                    inputStatCounter = counter;
+                }
+			}
+            simulation.stop();
+
+            if (gInputStats) {
+                LatencyStats latency = gInputLatency.getSessionStats();
+                printf("Input latency over the session (%s input): %d events, %.1f ms median, %.1f ms p90, %.1f ms p99, %.1f ms max\n",
+                       gLateInput ? "late" : "early", latency.samples, latency.p50Ms, latency.p90Ms, latency.p99Ms, latency.maxMs);
+            }
+		}
+	}
+
+    if (gRecorder.isOpen()) {
+        Uint32 recorded = gRecorder.getTickCount();
+        if (gRecorder.close())
+            printf("Recorded %u ticks to %s\n", recorded, recordPath);
+        else
+            printf("Unable to finish replay %s.\n", recordPath);
+    }
+
+	// Free resources and close SDL
+	close();
+
+	return status;
 }
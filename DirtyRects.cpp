@@ -0,0 +1,210 @@
+#include "DirtyRects.h"
+
+#include <math.h>
+#include <algorithm>
+
+DirtyRects gDirty;
+
+DirtyRects::DirtyRects()
+{
+    SDL_Rect screen = {0, 0, 0, 0};
+    mScreen = screen;
+    mRecording = false;
+    mFull = true;
+}
+
+void DirtyRects::beginFrame(int screenWidth, int screenHeight)
+{
+    if (screenWidth != mScreen.w || screenHeight != mScreen.h) {
+        SDL_Rect screen = {0, 0, screenWidth, screenHeight};
+        mScreen = screen;
+        mFull = true;
+    }
+
+    // Made on the first frame, so busy frames later never allocate (a diff can hold both frames' draws)
+    if ((int)mCurrent.capacity() < RESERVED_DRAWS) {
+        mCurrent.reserve(RESERVED_DRAWS);
+        mLast.reserve(RESERVED_DRAWS);
+        mRects.reserve(RESERVED_DRAWS*2);
+    }
+    mCurrent.clear();
+    mRects.clear();
+    mRecording = true;
+}
+
+bool DirtyRects::isRecording() { return mRecording; }
+
+void DirtyRects::record(const SDL_Rect &rect, Uint32 key)
+{
+    Draw draw = {rect, key};
+    mCurrent.push_back(draw);
+}
+
+void DirtyRects::addDirty(const SDL_Rect &rect) { mRects.push_back(rect); }
+
+void DirtyRects::invalidate() { mFull = true; }
+
+void DirtyRects::endFrame()
+{
+    mRecording = false;
+    std::sort(mCurrent.begin(), mCurrent.end(), drawLess);
+
+    if (mFull) {
+        mRects.clear();
+        mRects.push_back(mScreen);
+        mFull = false;
+    } else {
+        // Both lists are sorted, so one pass finds the draws only one frame has
+        size_t last = 0;
+        size_t current = 0;
+        while (last < mLast.size() || current < mCurrent.size()) {
+            if (current == mCurrent.size() || (last < mLast.size() && drawLess(mLast[last], mCurrent[current]))) {
+                mRects.push_back(mLast[last++].rect);
+            } else if (last == mLast.size() || drawLess(mCurrent[current], mLast[last])) {
+                mRects.push_back(mCurrent[current++].rect);
+            } else {
+                last++;
+                current++;
+            }
+        }
+        mergeRects();
+    }
+
+    mLast.swap(mCurrent);
+}
+
+const std::vector<SDL_Rect> &DirtyRects::getRects() { return mRects; }
+
+double DirtyRects::getCoverage()
+{
+    if (mScreen.w <= 0 || mScreen.h <= 0) { return 0; }
+
+    double area = 0;
+    for (size_t i = 0; i < mRects.size(); i++) {
+        area += (double)mRects[i].w*mRects[i].h;
+    }
+    return area/((double)mScreen.w*mScreen.h);
+}
+
+bool DirtyRects::drawLess(const Draw &a, const Draw &b)
+{
+    if (a.key != b.key) { return a.key < b.key; }
+    if (a.rect.x != b.rect.x) { return a.rect.x < b.rect.x; }
+    if (a.rect.y != b.rect.y) { return a.rect.y < b.rect.y; }
+    if (a.rect.w != b.rect.w) { return a.rect.w < b.rect.w; }
+    return a.rect.h < b.rect.h;
+}
+
+void DirtyRects::mergeRects()
+{
+    // Off-screen parts never need redrawing
+    size_t kept = 0;
+    for (size_t i = 0; i < mRects.size(); i++) {
+        if (SDL_IntersectRect(&mRects[i], &mScreen, &mRects[kept]))
+            kept++;
+    }
+    mRects.resize(kept);
+
+    // Skips merging when the answer is already clear (e.g. the background scrolled)
+    if (getCoverage() >= FULL_REDRAW_COVERAGE) {
+        mRects.clear();
+        mRects.push_back(mScreen);
+        return;
+    }
+    if ((int)mRects.size() > MAX_DIRTY_RECTS*8) {
+        for (size_t i = 1; i < mRects.size(); i++) {
+            SDL_UnionRect(&mRects[0], &mRects[i], &mRects[0]);
+        }
+        mRects.resize(1);
+    }
+
+    bool merged = true;
+    while (merged) {
+        merged = false;
+
+        // Overlapping rects would be redrawn twice
+        for (size_t i = 0; i < mRects.size(); i++) {
+            for (size_t j = i+1; j < mRects.size(); j++) {
+                if (SDL_HasIntersection(&mRects[i], &mRects[j])) {
+                    SDL_UnionRect(&mRects[i], &mRects[j], &mRects[i]);
+                    mRects.erase(mRects.begin()+j);
+                    j = i;
+                    merged = true;
+                }
+            }
+        }
+
+        // Too many: merges the pair that grows the least
+        if ((int)mRects.size() > MAX_DIRTY_RECTS) {
+            size_t bestI = 0;
+            size_t bestJ = 1;
+            double bestGrowth = -1;
+            for (size_t i = 0; i < mRects.size(); i++) {
+                for (size_t j = i+1; j < mRects.size(); j++) {
+                    SDL_Rect both;
+                    SDL_UnionRect(&mRects[i], &mRects[j], &both);
+                    double growth = (double)both.w*both.h-(double)mRects[i].w*mRects[i].h-(double)mRects[j].w*mRects[j].h;
+                    if (bestGrowth < 0 || growth < bestGrowth) {
+                        bestGrowth = growth;
+                        bestI = i;
+                        bestJ = j;
+                    }
+                }
+            }
+            SDL_UnionRect(&mRects[bestI], &mRects[bestJ], &mRects[bestI]);
+            mRects.erase(mRects.begin()+bestJ);
+            merged = true;
+        }
+    }
+
+    if (getCoverage() >= FULL_REDRAW_COVERAGE) {
+        mRects.clear();
+        mRects.push_back(mScreen);
+    }
+}
+
+Uint32 mixKey(Uint32 key, int value)
+{
+    key ^= (Uint32)value;
+    key *= 16777619u;
+    return key ^ (key >> 15);
+}
+
+Uint32 drawKey(SDL_Texture *texture, const SDL_Rect &source, SDL_Color modulation)
+{
+    Uint64 address = (Uint64)(size_t)texture;
+    Uint32 key = mixKey(2166136261u, (int)(address & 0xFFFFFFFF));
+    key = mixKey(key, (int)(address >> 32));
+    key = mixKey(key, source.x);
+    key = mixKey(key, source.y);
+    key = mixKey(key, source.w);
+    key = mixKey(key, source.h);
+    return mixKey(key, modulation.r | modulation.g << 8 | modulation.b << 16 | modulation.a << 24);
+}
+
+SDL_Color getTextureModulation(SDL_Texture *texture)
+{
+    SDL_Color modulation = {0xFF, 0xFF, 0xFF, 0xFF};
+    SDL_GetTextureColorMod(texture, &modulation.r, &modulation.g, &modulation.b);
+    SDL_GetTextureAlphaMod(texture, &modulation.a);
+    return modulation;
+}
+
+SDL_Rect rotatedBounds(const SDL_Rect &dest, double angle, const SDL_Point *center)
+{
+    if (angle == 0) { return dest; }
+
+    // Whatever the angle, the copy stays within its farthest corner's distance from the pivot
+    double pivotX = center ? dest.x+center->x : dest.x+dest.w/2.0;
+    double pivotY = center ? dest.y+center->y : dest.y+dest.h/2.0;
+    double dx = std::max(pivotX-dest.x, dest.x+dest.w-pivotX);
+    double dy = std::max(pivotY-dest.y, dest.y+dest.h-pivotY);
+    double radius = sqrt(dx*dx+dy*dy);
+
+    SDL_Rect bounds;
+    bounds.x = (int)floor(pivotX-radius);
+    bounds.y = (int)floor(pivotY-radius);
+    bounds.w = (int)ceil(pivotX+radius)-bounds.x;
+    bounds.h = (int)ceil(pivotY+radius)-bounds.y;
+    return bounds;
+}
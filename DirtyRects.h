@@ -0,0 +1,88 @@
+#ifndef DIRTY_RECTS_H
+#define DIRTY_RECTS_H
+
+#include <SDL.h>
+#include <vector>
+
+// Most separate regions redrawn in a frame (past that the closest ones get merged)
+const int MAX_DIRTY_RECTS = 8;
+
+// Once dirty rects cover this much of the screen, one full redraw is cheaper
+const double FULL_REDRAW_COVERAGE = 0.6;
+
+// Draws a frame can record before recording allocates (room is made on the first frame)
+const int RESERVED_DRAWS = 16384;
+
+// Works out what changed on screen since the last frame, for partial redraws
+// A frame is drawn twice. With recording on, every draw call adds the screen rect it
+// covers and a key (a hash of what it draws there) instead of drawing. Draws that don't
+// exactly match one from the last frame mark their rect dirty, and so do the last frame's
+// draws that are gone. The frame is then drawn for real, clipped to each dirty rect in turn
+class DirtyRects
+{
+    public:
+        // Initialization (the first frame is a full redraw)
+        DirtyRects();
+
+        // Starts recording a frame's draws
+        void beginFrame(int screenWidth, int screenHeight);
+
+        // True between beginFrame() and endFrame(), when draw calls should record instead of draw
+        bool isRecording();
+
+        // Adds a draw that covers rect
+        void record(const SDL_Rect &rect, Uint32 key);
+
+        // Marks rect changed whatever was drawn there (for things drawn without recording)
+        void addDirty(const SDL_Rect &rect);
+
+        // Makes the next frame a full redraw (e.g. the window was uncovered)
+        void invalidate();
+
+        // Stops recording and works out the dirty rects
+        void endFrame();
+
+        // Gets the dirty rects from the last endFrame() (on screen, not overlapping)
+        const std::vector<SDL_Rect> &getRects();
+
+        // Gets how much of the screen the dirty rects cover (0 to 1)
+        double getCoverage();
+
+    private:
+        struct Draw
+        {
+            SDL_Rect rect;
+            Uint32 key;
+        };
+
+        static bool drawLess(const Draw &a, const Draw &b);
+
+        // Clips to the screen, then merges until nothing overlaps and there are at most MAX_DIRTY_RECTS
+        void mergeRects();
+
+        // Last frame's draws and this one's (sorted by endFrame())
+        std::vector<Draw> mLast;
+        std::vector<Draw> mCurrent;
+        std::vector<SDL_Rect> mRects;
+
+        SDL_Rect mScreen;
+        bool mRecording;
+        bool mFull;
+};
+
+// Hashes what a draw looks like: the texture, the part of it drawn and the modulation
+Uint32 drawKey(SDL_Texture *texture, const SDL_Rect &source, SDL_Color modulation);
+
+// Mixes another value (angle, flip, tile...) into a key
+Uint32 mixKey(Uint32 key, int value);
+
+// Gets a texture's current color and alpha modulation
+SDL_Color getTextureModulation(SDL_Texture *texture);
+
+// Screen rect a copy to dest can touch once rotated by angle around center (dest's middle if NULL)
+SDL_Rect rotatedBounds(const SDL_Rect &dest, double angle, const SDL_Point *center);
+
+// Tracker every draw call records into (only recording while the game redraws in software)
+extern DirtyRects gDirty;
+
+#endif
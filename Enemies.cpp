@@ -0,0 +1,225 @@
+#include "Enemies.h"
+
+#include <stddef.h>
+
+// Shortest time between two wander steps (ms)
+const unsigned int WANDER_DELAY = 300;
+
+EnemyStore::EnemyStore(int worldHeight, int capacity)
+{
+    // Storage never grows after this
+    type.resize(capacity);
+    posX.resize(capacity);
+    posY.resize(capacity);
+    health.resize(capacity);
+    maxHealth.resize(capacity);
+    speed.resize(capacity);
+    fireRate.resize(capacity);
+    damage.resize(capacity);
+    damageState.resize(capacity);
+    timeSinceMove.resize(capacity);
+    reload.resize(capacity);
+    id.resize(capacity);
+    lastX.resize(capacity);
+    lastY.resize(capacity);
+    mWanderRoll.resize(capacity);
+
+    mCount = 0;
+    mNextId = 1;
+    mWorldHeight = worldHeight;
+    for (int t = 0; t < ENEMY_TYPE_COUNT; t++) {
+        EnemyArchetype none = {1, 0, 0, 0, 0, 0, 0, false, false, 0, 1, 0};
+        mArchetypes[t] = none;
+    }
+}
+
+void EnemyStore::setArchetype(int type, const EnemyArchetype &archetype)
+{
+    if (type < 0 || type >= ENEMY_TYPE_COUNT) { return; }
+    mArchetypes[type] = archetype;
+}
+
+const EnemyArchetype &EnemyStore::getArchetype(int type) { return mArchetypes[type]; }
+
+int EnemyStore::spawn(int t, int x, int y)
+{
+    if (mCount == capacity() || t < 0 || t >= ENEMY_TYPE_COUNT) { return -1; }
+
+    const EnemyArchetype &archetype = mArchetypes[t];
+    int i = mCount++;
+    type[i] = t;
+    posX[i] = x;
+    posY[i] = y;
+    health[i] = archetype.maxHealth;
+    maxHealth[i] = archetype.maxHealth;
+    speed[i] = archetype.speed;
+    fireRate[i] = archetype.fireRate;
+    damage[i] = archetype.damage;
+    damageState[i] = 0;
+    timeSinceMove[i] = 0;
+    reload[i] = 0;
+    id[i] = mNextId++;
+    lastX[i] = x;
+    lastY[i] = y;
+    return i;
+}
+
+void EnemyStore::removeAt(int i)
+{
+    if (i < 0 || i >= mCount) { return; }
+
+    // Fills the hole with the last enemy
+    int last = mCount-1;
+    type[i] = type[last];
+    posX[i] = posX[last];
+    posY[i] = posY[last];
+    health[i] = health[last];
+    maxHealth[i] = maxHealth[last];
+    speed[i] = speed[last];
+    fireRate[i] = fireRate[last];
+    damage[i] = damage[last];
+    damageState[i] = damageState[last];
+    timeSinceMove[i] = timeSinceMove[last];
+    reload[i] = reload[last];
+    id[i] = id[last];
+    lastX[i] = lastX[last];
+    lastY[i] = lastY[last];
+    mCount--;
+}
+
+void EnemyStore::clear() { mCount = 0; }
+
+void EnemyStore::storePositions()
+{
+    for (int i = 0; i < mCount; i++) {
+        lastX[i] = posX[i];
+        lastY[i] = posY[i];
+    }
+}
+
+void EnemyStore::move(const EnemyTarget &target, Random &random)
+{
+    rollWander(random);
+    moveRange(target, 0, mCount);
+}
+
+void EnemyStore::rollWander(Random &random)
+{
+    for (int i = 0; i < mCount; i++) {
+        mWanderRoll[i] = mArchetypes[type[i]].wanders ? random.below(10) : 0;
+    }
+}
+
+void EnemyStore::moveRange(const EnemyTarget &target, int begin, int end)
+{
+    for (int i = begin; i < end; i++) {
+        const EnemyArchetype &archetype = mArchetypes[type[i]];
+
+        // Bring alien into frame
+        if (posY[i] < 0)
+            posY[i]+=speed[i];
+        // Alien moves to player
+        if (posX[i] <= target.box.x && !reload[i])
+            posX[i]+=speed[i];
+        if (posX[i] >= target.box.x && !reload[i])
+            posX[i]-=speed[i];
+
+        if (archetype.wanders) {
+            if (timeSinceMove[i] == 0)
+                timeSinceMove[i] = target.now;
+            int randNum = mWanderRoll[i];
+            bool rested = timeSinceMove[i]+WANDER_DELAY < target.now;
+            if (randNum > 6 && rested && posY[i]+archetype.height+speed[i] < mWorldHeight/2) {
+                posY[i]+=speed[i]/3;
+                timeSinceMove[i] = target.now;
+            } else if (randNum < 1 && rested && posY[i]+speed[i] > 0) {
+                posY[i]-=speed[i]/3;
+                timeSinceMove[i] = target.now;
+            }
+        }
+    }
+}
+
+void EnemyStore::fire(const EnemyTarget &target, EnemyShotPool &shots)
+{
+    for (int i = 0; i < mCount; i++) {
+        if (reload[i] > 0) {
+            reload[i]--;
+            continue;
+        }
+
+        // Fires once lined up with the left half of the target
+        const EnemyArchetype &archetype = mArchetypes[type[i]];
+        int centerX = posX[i]+archetype.width/2;
+        if (centerX < target.box.x || centerX > target.box.x+target.box.w/2) { continue; }
+
+        int shotY = posY[i]+archetype.height*2/3;
+        int shotSpeed = target.shotSpeed*fireRate[i];
+        if (shotSpeed < 1) { shotSpeed = 1; }
+        for (int v = 0; v < archetype.volley; v++) {
+            int velX = (2*v-(archetype.volley-1))*archetype.spread/2;
+            shots.spawn(centerX, shotY, velX, shotSpeed, damage[i], id[i]);
+        }
+
+        // Waits as long as the shot takes to fly its range
+        reload[i] = (mWorldHeight+archetype.shotRange-shotY)/shotSpeed+1;
+        if (reload[i] < 1) { reload[i] = 1; }
+    }
+}
+
+void EnemyStore::shotsHit(const std::vector<unsigned int> &owners)
+{
+    for (size_t h = 0; h < owners.size(); h++) {
+        for (int i = 0; i < mCount; i++) {
+            if (id[i] == owners[h] && mArchetypes[type[i]].reloadOnHit) {
+                reload[i] = 0;
+            }
+        }
+    }
+}
+
+void EnemyStore::hitboxes(std::vector<CollisionBox> &boxes, int reach, int projectileWidth, int projectileHeight)
+{
+    boxes.resize(mCount);
+    for (int i = 0; i < mCount; i++) {
+        const EnemyArchetype &archetype = mArchetypes[type[i]];
+        CollisionBox box = {posX[i], posY[i]-reach, archetype.width, archetype.height+reach};
+        boxes[i] = growBox(box, projectileWidth, projectileHeight);
+    }
+}
+
+void EnemyStore::updateDamageStates()
+{
+    // Above 3/4, 1/2 and 1/4 of max health
+    for (int i = 0; i < mCount; i++) {
+        if (health[i]*4 > maxHealth[i]*3) {
+            damageState[i] = 0;
+        } else if (health[i]*2 > maxHealth[i]) {
+            damageState[i] = 1;
+        } else if (health[i]*4 > maxHealth[i]) {
+            damageState[i] = 2;
+        } else {
+            damageState[i] = 3;
+        }
+    }
+}
+
+int EnemyStore::removeDead(int &bounty)
+{
+    int removed = 0;
+    bounty = 0;
+    for (int i = 0; i < mCount; ) {
+        if (health[i] <= 0) {
+            bounty+=mArchetypes[type[i]].killHeal;
+            removeAt(i);
+            removed++;
+        } else {
+            i++;
+        }
+    }
+    return removed;
+}
+
+int EnemyStore::size() { return mCount; }
+
+int EnemyStore::capacity() { return (int)type.size(); }
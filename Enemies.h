@@ -0,0 +1,140 @@
+#ifndef ENEMIES_H
+#define ENEMIES_H
+
+#include <vector>
+
+#include "Collision.h"
+#include "Projectiles.h"
+#include "Random.h"
+
+// Max number of live enemies
+const int MAX_ENEMIES = 512;
+
+// Enemy kinds, used to index archetypes and sprites
+enum EnemyType
+{
+    ENEMY_RAIDER,
+    ENEMY_STRIKER,
+    ENEMY_THRASHER,
+    ENEMY_TYPE_COUNT
+};
+
+// Sprites per enemy kind, from undamaged (0) to nearly destroyed (3)
+const int DAMAGE_STATES = 4;
+
+// Stats and behaviour shared by every enemy of one kind
+struct EnemyArchetype
+{
+    int maxHealth;
+    int speed;
+    // Shot speed as a multiple of the player's bullet speed
+    int fireRate;
+    int damage;
+    int width;
+    int height;
+    // Reloads for as long as a shot takes to fly this far below the screen
+    int shotRange;
+    // Fires again as soon as a shot hits (otherwise it waits out the whole reload)
+    bool reloadOnHit;
+    // Drifts up and down at random while chasing
+    bool wanders;
+    // Health given back to the player for destroying one
+    int killHeal;
+    // Shots per volley, fanned out spread pixels per tick apart sideways
+    int volley;
+    int spread;
+};
+
+// The player, as seen by the enemy systems
+struct EnemyTarget
+{
+    CollisionBox box;
+    int shotSpeed;
+    unsigned int now;
+};
+
+// Every live enemy, stored as packed arrays (index 0 to size()-1)
+// Removal swaps the last enemy into the hole, so systems walk the arrays without gaps
+class EnemyStore
+{
+    public:
+        // Allocates all storage up front for a play area worldHeight pixels tall
+        EnemyStore(int worldHeight, int capacity = MAX_ENEMIES);
+
+        // Sets the stats used by enemies of one kind spawned from now on
+        void setArchetype(int type, const EnemyArchetype &archetype);
+        const EnemyArchetype &getArchetype(int type);
+
+        // Adds an enemy at (x, y), returns its index or -1 if the store is full
+        int spawn(int type, int x, int y);
+
+        // Removes enemy at index i (moves the last one into i)
+        void removeAt(int i);
+
+        // Removes every enemy
+        void clear();
+
+        // Copies positions into the last* arrays (call before each simulation tick)
+        void storePositions();
+
+        // Movement system: enters from the top, chases the target and wanders (rolls come from random)
+        void move(const EnemyTarget &target, Random &random);
+
+        // move() in two steps so the second can be split across threads
+        // rollWander() draws every wander roll in order, then moveRange() moves enemies
+        // begin to end-1 (ranges can run at once); together they match move() exactly
+        void rollWander(Random &random);
+        void moveRange(const EnemyTarget &target, int begin, int end);
+
+        // Firing system: reloads, and fires a volley into shots once lined up with the target
+        void fire(const EnemyTarget &target, EnemyShotPool &shots);
+
+        // Lets enemies whose shots hit reload at once (if their kind does)
+        void shotsHit(const std::vector<unsigned int> &owners);
+
+        // Writes each enemy's hitbox to boxes (reach stretches it upwards)
+        // Boxes are grown to catch the top-left corner of any projectileWidth x projectileHeight sprite touching them
+        void hitboxes(std::vector<CollisionBox> &boxes, int reach, int projectileWidth = 1, int projectileHeight = 1);
+
+        // Damage-state system: picks each enemy's sprite from its remaining health
+        void updateDamageStates();
+
+        // Removes destroyed enemies, returns how many there were
+        // bounty is set to the health their kills give back to the player
+        int removeDead(int &bounty);
+
+        // Gets live count and capacity
+        int size();
+        int capacity();
+
+        // Packed per-enemy state, valid from 0 to size()-1
+        std::vector<int> type;
+        std::vector<int> posX;
+        std::vector<int> posY;
+        std::vector<int> health;
+        std::vector<int> maxHealth;
+        std::vector<int> speed;
+        std::vector<int> fireRate;
+        std::vector<int> damage;
+        std::vector<int> damageState;
+        std::vector<unsigned int> timeSinceMove;
+        // Ticks until it can fire again (chases the target while 0)
+        std::vector<int> reload;
+        // Never reused, so shots can name their owner after it moves or dies
+        std::vector<unsigned int> id;
+
+        // Positions as of the previous tick (for render interpolation)
+        std::vector<int> lastX;
+        std::vector<int> lastY;
+
+    private:
+        int mCount;
+        unsigned int mNextId;
+        int mWorldHeight;
+        EnemyArchetype mArchetypes[ENEMY_TYPE_COUNT];
+
+        // Each enemy's wander roll for this tick, drawn by rollWander()
+        std::vector<int> mWanderRoll;
+};
+
+#endif
@@ -0,0 +1,120 @@
+#include "FrameArena.h"
+
+#include <SDL.h>
+#include <stdlib.h>
+#include <new>
+
+FrameArena::FrameArena(size_t capacity)
+{
+    mBlock = (char*)malloc(capacity);
+    mCapacity = mBlock ? capacity : 0;
+    mUsed = 0;
+    mHighWater = 0;
+    mSpills = 0;
+}
+
+FrameArena::~FrameArena()
+{
+    reset();
+    free(mBlock);
+}
+
+void *FrameArena::allocate(size_t bytes, size_t align)
+{
+    size_t start = (mUsed+align-1) & ~(align-1);
+    if (start+bytes > mCapacity) {
+        // Rare enough that growing the list doesn't matter (the heap check reports it anyway)
+        void *spilled = malloc(bytes > 0 ? bytes : 1);
+        mSpilled.push_back(spilled);
+        mSpills++;
+        return spilled;
+    }
+
+    mUsed = start+bytes;
+    if (mUsed > mHighWater)
+        mHighWater = mUsed;
+    return mBlock+start;
+}
+
+void FrameArena::reset()
+{
+    for (size_t i = 0; i < mSpilled.size(); i++) {
+        free(mSpilled[i]);
+    }
+    mSpilled.clear();
+    mUsed = 0;
+}
+
+size_t FrameArena::getUsed() { return mUsed; }
+
+size_t FrameArena::getHighWater() { return mHighWater; }
+
+size_t FrameArena::getCapacity() { return mCapacity; }
+
+int FrameArena::getSpills() { return mSpills; }
+
+#ifndef NDEBUG
+
+SDL_atomic_t gHeapCheckArmed;
+SDL_atomic_t gHeapAllocations;
+
+// Counts one allocation if the check is armed, then takes it from malloc
+static void *countedAlloc(size_t size)
+{
+    if (SDL_AtomicGet(&gHeapCheckArmed))
+        SDL_AtomicAdd(&gHeapAllocations, 1);
+    return malloc(size > 0 ? size : 1);
+}
+
+// Replaces the global allocator so every new (containers included) goes past the counter
+// Plain, array, nothrow and sized forms are all replaced here, rather than trusting the library's
+// defaults to forward to them. Over-aligned (C++17 align_val_t) forms aren't, and nothing here uses them
+void *operator new(size_t size)
+{
+    void *memory = countedAlloc(size);
+    if (!memory)
+        throw std::bad_alloc();
+    return memory;
+}
+
+void *operator new[](size_t size)
+{
+    void *memory = countedAlloc(size);
+    if (!memory)
+        throw std::bad_alloc();
+    return memory;
+}
+
+void *operator new(size_t size, const std::nothrow_t &) noexcept { return countedAlloc(size); }
+
+void *operator new[](size_t size, const std::nothrow_t &) noexcept { return countedAlloc(size); }
+
+void operator delete(void *memory) noexcept { free(memory); }
+
+void operator delete[](void *memory) noexcept { free(memory); }
+
+void operator delete(void *memory, const std::nothrow_t &) noexcept { free(memory); }
+
+void operator delete[](void *memory, const std::nothrow_t &) noexcept { free(memory); }
+
+#if defined(__cpp_sized_deallocation) || (defined(_MSC_VER) && _MSC_VER >= 1900)
+void operator delete(void *memory, size_t) noexcept { free(memory); }
+
+void operator delete[](void *memory, size_t) noexcept { free(memory); }
+#endif
+
+void armHeapCheck(bool armed) { SDL_AtomicSet(&gHeapCheckArmed, armed ? 1 : 0); }
+
+int takeHeapAllocations() { return SDL_AtomicSet(&gHeapAllocations, 0); }
+
+bool heapCheckAvailable() { return true; }
+
+#else
+
+void armHeapCheck(bool armed) {}
+
+int takeHeapAllocations() { return 0; }
+
+bool heapCheckAvailable() { return false; }
+
+#endif
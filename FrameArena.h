@@ -0,0 +1,67 @@
+#ifndef FRAME_ARENA_H
+#define FRAME_ARENA_H
+
+#include <stddef.h>
+#include <vector>
+
+// Bytes a FrameArena takes up front unless told otherwise
+const size_t FRAME_ARENA_BYTES = 256*1024;
+
+// Bump allocator for temporaries that only live until the end of a tick or frame
+// Allocating just moves a pointer through one block taken up front, and reset() frees
+// everything at once. Nothing is constructed or destroyed, so it only suits plain types.
+// Not thread safe: each thread that needs one has its own
+class FrameArena
+{
+    public:
+        // Takes capacity bytes up front
+        FrameArena(size_t capacity = FRAME_ARENA_BYTES);
+
+        // Deallocation
+        ~FrameArena();
+
+        // Gets bytes aligned to align (a power of two)
+        // A full arena spills to the heap instead (freed at reset() and counted in getSpills())
+        void *allocate(size_t bytes, size_t align);
+
+        // Gets room for count uninitialized Ts
+        template <typename T>
+        T *allocateArray(int count) { return (T*)allocate(sizeof(T)*(count > 0 ? count : 0), alignof(T)); }
+
+        // Frees everything allocated since the last reset
+        void reset();
+
+        // Gets bytes in use, the most ever in use at once, and the block size
+        size_t getUsed();
+        size_t getHighWater();
+        size_t getCapacity();
+
+        // Gets how many allocations didn't fit and went to the heap
+        int getSpills();
+
+    private:
+        // Owns its block, so it can't be copied
+        FrameArena(const FrameArena &);
+        FrameArena &operator=(const FrameArena &);
+
+        char *mBlock;
+        size_t mCapacity;
+        size_t mUsed;
+        size_t mHighWater;
+
+        // Heap blocks handed out after the arena filled up
+        std::vector<void*> mSpilled;
+        int mSpills;
+};
+
+// Checks that gameplay frames make no heap allocations (builds without NDEBUG only)
+// While armed, every operator new on any thread is counted
+void armHeapCheck(bool armed);
+
+// Gets how many allocations were made while armed since the last call
+int takeHeapAllocations();
+
+// True if this build counts allocations at all
+bool heapCheckAvailable();
+
+#endif
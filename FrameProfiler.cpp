@@ -0,0 +1,155 @@
+#include "FrameProfiler.h"
+
+#include <stdio.h>
+#include <string.h>
+
+const char *profilePhaseName(int phase)
+{
+    switch (phase) {
+        case PHASE_INPUT: return "input";
+        case PHASE_LOGIC: return "logic";
+        case PHASE_RENDER: return "render";
+        case PHASE_PRESENT: return "present";
+    }
+    return "unknown";
+}
+
+FrameProfiler::FrameProfiler()
+{
+    memset(mFrames, 0, sizeof(mFrames));
+    memset(mPhaseStart, 0, sizeof(mPhaseStart));
+    mNext = 0;
+    mCount = 0;
+    mFrequency = SDL_GetPerformanceFrequency();
+    mFrameStart = 0;
+    for (int p = 0; p < PHASE_COUNT; p++) {
+        mBars[p].reserve(PROFILE_FRAMES);
+    }
+}
+
+void FrameProfiler::beginFrame()
+{
+    memset(&mFrames[mNext], 0, sizeof(FrameTimes));
+    mFrameStart = SDL_GetPerformanceCounter();
+}
+
+void FrameProfiler::begin(int phase) { mPhaseStart[phase] = SDL_GetPerformanceCounter(); }
+
+void FrameProfiler::end(int phase) { mFrames[mNext].phase[phase]+=SDL_GetPerformanceCounter()-mPhaseStart[phase]; }
+
+void FrameProfiler::add(int phase, Uint64 ticks) { mFrames[mNext].phase[phase]+=ticks; }
+
+void FrameProfiler::endFrame()
+{
+    mFrames[mNext].total = SDL_GetPerformanceCounter()-mFrameStart;
+    mNext = (mNext+1) % PROFILE_FRAMES;
+    if (mCount < PROFILE_FRAMES) { mCount++; }
+}
+
+int FrameProfiler::getFrameCount() { return mCount; }
+
+int FrameProfiler::slotOf(int frame) { return (mNext-mCount+frame+PROFILE_FRAMES) % PROFILE_FRAMES; }
+
+double FrameProfiler::getPhaseMs(int frame, int phase) { return mFrames[slotOf(frame)].phase[phase]*1000.0/mFrequency; }
+
+double FrameProfiler::getFrameMs(int frame) { return mFrames[slotOf(frame)].total*1000.0/mFrequency; }
+
+double FrameProfiler::getAverageMs(int phase)
+{
+    if (mCount == 0) { return 0; }
+
+    double sum = 0;
+    for (int f = 0; f < mCount; f++) {
+        sum+=getPhaseMs(f, phase);
+    }
+    return sum/mCount;
+}
+
+bool FrameProfiler::dumpCSV(const char *path)
+{
+    FILE *file = fopen(path, "w");
+    if (!file) {
+        printf("Unable to write profile %s.\n", path);
+        return false;
+    }
+
+    fprintf(file, "frame");
+    for (int p = 0; p < PHASE_COUNT; p++) {
+        fprintf(file, ",%s_ms", profilePhaseName(p));
+    }
+    fprintf(file, ",total_ms\n");
+
+    for (int f = 0; f < mCount; f++) {
+        fprintf(file, "%d", f);
+        for (int p = 0; p < PHASE_COUNT; p++) {
+            fprintf(file, ",%.4f", getPhaseMs(f, p));
+        }
+        fprintf(file, ",%.4f\n", getFrameMs(f));
+    }
+
+    bool success = ferror(file) == 0;
+    fclose(file);
+    return success;
+}
+
+SDL_Color FrameProfiler::getPhaseColor(int phase)
+{
+    static const SDL_Color colors[PHASE_COUNT] = {
+        {255, 220, 0, 255},
+        {0, 200, 255, 255},
+        {80, 255, 80, 255},
+        {255, 80, 200, 255}
+    };
+    return colors[phase];
+}
+
+void FrameProfiler::drawOverlay(SDL_Renderer *renderer, const SDL_Rect &area, double scaleMs)
+{
+    SDL_BlendMode blendMode;
+    SDL_GetRenderDrawBlendMode(renderer, &blendMode);
+
+    // Darkens what's behind the graph
+    SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_BLEND);
+    SDL_SetRenderDrawColor(renderer, 0, 0, 0, 160);
+    SDL_RenderFillRect(renderer, &area);
+
+    // One rect list per phase, stacked bottom up, newest frame on the right
+    int barWidth = area.w/PROFILE_FRAMES > 0 ? area.w/PROFILE_FRAMES : 1;
+    for (int p = 0; p < PHASE_COUNT; p++) {
+        mBars[p].clear();
+    }
+    for (int f = 0; f < mCount; f++) {
+        int x = area.x+area.w-(mCount-f)*barWidth;
+        int bottom = area.y+area.h;
+        for (int p = 0; p < PHASE_COUNT; p++) {
+            int height = (int)(getPhaseMs(f, p)/scaleMs*area.h + .5);
+            if (height <= 0) { continue; }
+            if (bottom-height < area.y) { height = bottom-area.y; }
+            SDL_Rect bar = {x, bottom-height, barWidth, height};
+            mBars[p].push_back(bar);
+            bottom-=height;
+        }
+    }
+    for (int p = 0; p < PHASE_COUNT; p++) {
+        if (mBars[p].empty()) { continue; }
+        SDL_Color color = getPhaseColor(p);
+        SDL_SetRenderDrawColor(renderer, color.r, color.g, color.b, color.a);
+        SDL_RenderFillRects(renderer, &mBars[p][0], (int)mBars[p].size());
+    }
+
+    // Lines at 60 and 30 fps
+    SDL_SetRenderDrawColor(renderer, 255, 255, 255, 200);
+    int y60 = area.y+area.h-(int)(1000.0/60/scaleMs*area.h);
+    int y30 = area.y+area.h-(int)(1000.0/30/scaleMs*area.h);
+    if (y60 >= area.y) { SDL_RenderDrawLine(renderer, area.x, y60, area.x+area.w-1, y60); }
+    if (y30 >= area.y) { SDL_RenderDrawLine(renderer, area.x, y30, area.x+area.w-1, y30); }
+
+    SDL_SetRenderDrawBlendMode(renderer, blendMode);
+}
+
+ProfileScope::ProfileScope(FrameProfiler &profiler, int phase) : mProfiler(profiler), mPhase(phase)
+{
+    mProfiler.begin(mPhase);
+}
+
+ProfileScope::~ProfileScope() { mProfiler.end(mPhase); }
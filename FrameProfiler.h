@@ -0,0 +1,97 @@
+#ifndef FRAME_PROFILER_H
+#define FRAME_PROFILER_H
+
+#include <SDL.h>
+#include <vector>
+
+// Frames kept in the profiler's ring buffer
+const int PROFILE_FRAMES = 240;
+
+// Parts of a frame that get timed
+enum ProfilePhase
+{
+    PHASE_INPUT,
+    PHASE_LOGIC,
+    PHASE_RENDER,
+    // SDL_RenderPresent, including any time blocked on vsync
+    PHASE_PRESENT,
+    PHASE_COUNT
+};
+
+// Gets a phase's name (as used in the CSV header)
+const char *profilePhaseName(int phase);
+
+// Times each phase of the last PROFILE_FRAMES frames with the performance counter
+class FrameProfiler
+{
+    public:
+        FrameProfiler();
+
+        // Starts timing a new frame (overwrites the oldest once the buffer is full)
+        void beginFrame();
+
+        // Times one phase; a phase can run several times per frame and adds up
+        void begin(int phase);
+        void end(int phase);
+
+        // Adds time measured elsewhere (e.g. on another thread) to a phase, in performance counter ticks
+        void add(int phase, Uint64 ticks);
+
+        // Finishes the frame and records its total time
+        void endFrame();
+
+        // Gets how many frames are stored (up to PROFILE_FRAMES)
+        int getFrameCount();
+
+        // Gets stored frame times in ms, frame 0 is the oldest
+        double getPhaseMs(int frame, int phase);
+        double getFrameMs(int frame);
+
+        // Gets a phase's average over the stored frames in ms
+        double getAverageMs(int phase);
+
+        // Writes every stored frame to a CSV file, returns false if it can't be written
+        bool dumpCSV(const char *path);
+
+        // Draws one stacked bar per stored frame inside area (scaleMs is the full bar height)
+        void drawOverlay(SDL_Renderer *renderer, const SDL_Rect &area, double scaleMs);
+
+        // Gets the color a phase is drawn with
+        SDL_Color getPhaseColor(int phase);
+
+    private:
+        // Stored frame n (0 is the oldest) as a ring buffer index
+        int slotOf(int frame);
+
+        // Times of one frame, in performance counter ticks
+        struct FrameTimes
+        {
+            Uint64 phase[PHASE_COUNT];
+            Uint64 total;
+        };
+
+        FrameTimes mFrames[PROFILE_FRAMES];
+        int mNext;
+        int mCount;
+
+        Uint64 mFrequency;
+        Uint64 mFrameStart;
+        Uint64 mPhaseStart[PHASE_COUNT];
+
+        // Reused for every overlay draw, one list per phase
+        std::vector<SDL_Rect> mBars[PHASE_COUNT];
+};
+
+// Times a phase from construction to the end of the enclosing scope
+class ProfileScope
+{
+    public:
+        ProfileScope(FrameProfiler &profiler, int phase);
+        ~ProfileScope();
+
+    private:
+        FrameProfiler &mProfiler;
+        int mPhase;
+};
+
+#endif
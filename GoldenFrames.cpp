@@ -0,0 +1,170 @@
+#include "GoldenFrames.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+
+const Uint64 FNV_OFFSET = 14695981039346656037ULL;
+const Uint64 FNV_PRIME = 1099511628211ULL;
+
+Uint64 hashSurface(SDL_Surface *surface)
+{
+    if (SDL_MUSTLOCK(surface)) { SDL_LockSurface(surface); }
+
+    Uint64 hash = FNV_OFFSET;
+    int rowBytes = surface->w*surface->format->BytesPerPixel;
+    for (int y = 0; y < surface->h; y++) {
+        const Uint8 *row = (const Uint8*)surface->pixels+y*surface->pitch;
+        for (int x = 0; x < rowBytes; x++) {
+            hash = (hash ^ row[x])*FNV_PRIME;
+        }
+    }
+
+    if (SDL_MUSTLOCK(surface)) { SDL_UnlockSurface(surface); }
+    return hash;
+}
+
+GoldenFrames::GoldenFrames()
+{
+    mSeed = 0;
+}
+
+bool GoldenFrames::load(const char *path)
+{
+    reset(0);
+
+    FILE *file = fopen(path, "r");
+    if (!file) {
+        printf("Unable to open golden frames %s.\n", path);
+        return false;
+    }
+
+    bool seedRead = false;
+    bool success = true;
+    char line[256];
+    for (int lineNumber = 1; success && fgets(line, sizeof(line), file); lineNumber++) {
+        char *comment = strchr(line, '#');
+        if (comment) { *comment = '\0'; }
+
+        unsigned int seed, tick;
+        unsigned long long hash;
+        char extra;
+        if (sscanf(line, " %c", &extra) != 1) {
+            continue;
+        } else if (sscanf(line, " seed %u %c", &seed, &extra) == 1) {
+            mSeed = seed;
+            seedRead = true;
+        } else if (sscanf(line, " %u %llx %c", &tick, &hash, &extra) == 2 && (mFrames.empty() || tick > getLastTick())) {
+            add(tick, hash);
+        } else {
+            printf("Golden frames %s line %d: expected \"seed N\" or \"<tick> <hash>\" with ticks in order.\n", path, lineNumber);
+            success = false;
+        }
+    }
+    fclose(file);
+
+    if (success && !seedRead) {
+        printf("Golden frames %s has no seed.\n", path);
+        success = false;
+    }
+    if (!success) { reset(0); }
+    return success;
+}
+
+bool GoldenFrames::save(const char *path)
+{
+    FILE *file = fopen(path, "w");
+    if (!file) {
+        printf("Unable to write golden frames %s.\n", path);
+        return false;
+    }
+
+    fprintf(file, "# Frame hashes from StarCollider --golden-write, check with --golden\n");
+    fprintf(file, "seed %u\n", mSeed);
+    for (size_t i = 0; i < mFrames.size(); i++) {
+        fprintf(file, "%u %016llx\n", mFrames[i].tick, (unsigned long long)mFrames[i].hash);
+    }
+
+    bool success = ferror(file) == 0;
+    if (fclose(file) != 0) {
+        success = false;
+    }
+    return success;
+}
+
+void GoldenFrames::reset(unsigned int seed)
+{
+    mFrames.clear();
+    mSeed = seed;
+}
+
+void GoldenFrames::add(Uint32 tick, Uint64 hash)
+{
+    Frame frame = {tick, hash};
+    mFrames.push_back(frame);
+}
+
+bool GoldenFrames::find(Uint32 tick, Uint64 &hash)
+{
+    // Binary search (frames are in tick order)
+    size_t low = 0;
+    size_t high = mFrames.size();
+    while (low < high) {
+        size_t middle = (low+high)/2;
+        if (mFrames[middle].tick < tick)
+            low = middle+1;
+        else
+            high = middle;
+    }
+    if (low == mFrames.size() || mFrames[low].tick != tick) { return false; }
+
+    hash = mFrames[low].hash;
+    return true;
+}
+
+unsigned int GoldenFrames::getSeed() { return mSeed; }
+
+int GoldenFrames::getFrameCount() { return (int)mFrames.size(); }
+
+Uint32 GoldenFrames::getLastTick() { return mFrames.empty() ? 0 : mFrames.back().tick; }
+
+RenderTimeStats summarizeRenderTimes(const std::vector<double> &ms)
+{
+    RenderTimeStats stats = {(int)ms.size(), 0, 0, 0, 0};
+    if (ms.empty()) { return stats; }
+
+    std::vector<double> sorted(ms);
+    std::sort(sorted.begin(), sorted.end());
+    double sum = 0;
+    for (size_t i = 0; i < sorted.size(); i++) {
+        sum+=sorted[i];
+    }
+
+    // Nearest rank
+    stats.averageMs = sum/sorted.size();
+    stats.medianMs = sorted[(size_t)ceil(0.5*sorted.size())-1];
+    stats.p99Ms = sorted[(size_t)ceil(0.99*sorted.size())-1];
+    stats.maxMs = sorted.back();
+    return stats;
+}
+
+bool dumpRenderTimes(const char *path, const std::vector<double> &ms)
+{
+    FILE *file = fopen(path, "w");
+    if (!file) {
+        printf("Unable to write render times %s.\n", path);
+        return false;
+    }
+
+    fprintf(file, "tick,render_ms\n");
+    for (size_t i = 0; i < ms.size(); i++) {
+        fprintf(file, "%u,%.4f\n", (unsigned int)i+1, ms[i]);
+    }
+
+    bool success = ferror(file) == 0;
+    if (fclose(file) != 0) {
+        success = false;
+    }
+    return success;
+}
@@ -0,0 +1,72 @@
+#ifndef GOLDEN_FRAMES_H
+#define GOLDEN_FRAMES_H
+
+#include <SDL.h>
+#include <vector>
+
+// Ticks between hashed frames in a new golden list (once per simulated second)
+const Uint32 GOLDEN_INTERVAL = 60;
+
+// Ticks a new golden list covers unless --ticks says otherwise (one minute of game time)
+const Uint32 GOLDEN_TICKS = 60*60;
+
+// Hashes a surface's pixels (64-bit FNV-1a over each row, leaving out the pitch padding)
+Uint64 hashSurface(SDL_Surface *surface);
+
+// Frame hashes taken at chosen ticks of a headless run, so two builds can be shown to draw the same pixels
+// Text file: a "seed N" line, then "<tick> <hash in hex>" per frame in tick order; # starts a comment
+class GoldenFrames
+{
+    public:
+        GoldenFrames();
+
+        // Reads a list, returns false if it can't be read or is malformed
+        bool load(const char *path);
+
+        // Writes the list, returns false if it can't be written
+        bool save(const char *path);
+
+        // Starts an empty list for a run seeded with seed
+        void reset(unsigned int seed);
+
+        // Adds the hash of the frame drawn after tick (ticks must be added in order)
+        void add(Uint32 tick, Uint64 hash);
+
+        // True if the list has a hash for tick (put in hash)
+        bool find(Uint32 tick, Uint64 &hash);
+
+        // Gets the seed the listed run used
+        unsigned int getSeed();
+
+        // Gets how many frames are listed, and the last one's tick (0 for none)
+        int getFrameCount();
+        Uint32 getLastTick();
+
+    private:
+        struct Frame
+        {
+            Uint32 tick;
+            Uint64 hash;
+        };
+
+        std::vector<Frame> mFrames;
+        unsigned int mSeed;
+};
+
+// Render times over a run, in ms
+struct RenderTimeStats
+{
+    int frames;
+    double averageMs;
+    double medianMs;
+    double p99Ms;
+    double maxMs;
+};
+
+// Sums up one render time per frame
+RenderTimeStats summarizeRenderTimes(const std::vector<double> &ms);
+
+// Writes one render time per frame as CSV, returns false if it can't be written
+bool dumpRenderTimes(const char *path, const std::vector<double> &ms);
+
+#endif
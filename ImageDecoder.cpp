@@ -0,0 +1,151 @@
+#include "ImageDecoder.h"
+
+#include <SDL2/SDL_image.h>
+#include <stdio.h>
+
+SDL_Surface *loadKeyedImage(const char *path)
+{
+    SDL_Surface *loadedSurface = IMG_Load(path);
+    if (!loadedSurface) {
+        printf("Unable to load image %s. SDL_image Error: %s\n", path, IMG_GetError());
+        return NULL;
+    }
+
+    // Converts to 8-bit RGBA (bytes in memory are R, G, B, A)
+    SDL_Surface *rgba = SDL_ConvertSurfaceFormat(loadedSurface, SDL_PIXELFORMAT_RGBA32, 0);
+    SDL_FreeSurface(loadedSurface);
+    if (!rgba) {
+        printf("Unable to convert %s. SDL Error: %s\n", path, SDL_GetError());
+        return NULL;
+    }
+
+    // Color keys the image (opaque cyan becomes transparent)
+    SDL_LockSurface(rgba);
+    for (int y = 0; y < rgba->h; y++) {
+        Uint8 *pixel = (Uint8*)rgba->pixels + y*rgba->pitch;
+        for (int x = 0; x < rgba->w; x++, pixel += 4) {
+            if (pixel[0] == 0 && pixel[1] == 0xFF && pixel[2] == 0xFF && pixel[3] == 0xFF) {
+                pixel[3] = 0;
+            }
+        }
+    }
+    SDL_UnlockSurface(rgba);
+
+    // Copies pixels as-is when blitted (alpha included)
+    SDL_SetSurfaceBlendMode(rgba, SDL_BLENDMODE_NONE);
+
+    return rgba;
+}
+
+ImageDecoder::ImageDecoder()
+{
+    mLock = SDL_CreateMutex();
+    mJobDone = SDL_CreateCond();
+    mNextJob = 0;
+    mCollected = 0;
+}
+
+ImageDecoder::~ImageDecoder()
+{
+    wait();
+    for (size_t i = 0; i < mJobs.size(); i++) {
+        SDL_FreeSurface(mJobs[i].surface);
+    }
+    SDL_DestroyCond(mJobDone);
+    SDL_DestroyMutex(mLock);
+}
+
+int ImageDecoder::add(const char *path)
+{
+    Job job = {path, NULL, 0};
+    mJobs.push_back(job);
+    return (int)mJobs.size()-1;
+}
+
+void ImageDecoder::start(int threadCount)
+{
+    if (threadCount > (int)mJobs.size()) { threadCount = (int)mJobs.size(); }
+    if (threadCount < 1) { threadCount = 1; }
+    mFinished.reserve(mJobs.size());
+
+    for (int i = 0; i < threadCount; i++) {
+        SDL_Thread *thread = SDL_CreateThread(workerMain, "ImageDecoder", this);
+        if (!thread) {
+            printf("Warning: Unable to start decoder thread. SDL Error: %s\n", SDL_GetError());
+        } else {
+            mThreads.push_back(thread);
+        }
+    }
+
+    // No threads at all, decodes everything right here instead
+    if (mThreads.empty()) {
+        workerMain(this);
+    }
+}
+
+int ImageDecoder::workerMain(void *data)
+{
+    ImageDecoder *decoder = (ImageDecoder*)data;
+
+    while (true) {
+        // Takes the next job
+        SDL_LockMutex(decoder->mLock);
+        int i = decoder->mNextJob;
+        if (i < (int)decoder->mJobs.size()) {
+            decoder->mNextJob++;
+        }
+        SDL_UnlockMutex(decoder->mLock);
+        if (i >= (int)decoder->mJobs.size()) { break; }
+
+        // Decodes it (only this worker touches the job until it's marked finished)
+        Uint64 startCounter = SDL_GetPerformanceCounter();
+        decoder->mJobs[i].surface = loadKeyedImage(decoder->mJobs[i].path);
+        decoder->mJobs[i].decodeMs = (double)(SDL_GetPerformanceCounter()-startCounter)*1000/SDL_GetPerformanceFrequency();
+
+        // Hands it to the main thread
+        SDL_LockMutex(decoder->mLock);
+        decoder->mFinished.push_back(i);
+        SDL_CondSignal(decoder->mJobDone);
+        SDL_UnlockMutex(decoder->mLock);
+    }
+
+    return 0;
+}
+
+int ImageDecoder::next()
+{
+    int i = -1;
+
+    SDL_LockMutex(mLock);
+    if (mCollected < (int)mJobs.size()) {
+        while (mCollected == (int)mFinished.size()) {
+            SDL_CondWait(mJobDone, mLock);
+        }
+        i = mFinished[mCollected];
+        mCollected++;
+    }
+    SDL_UnlockMutex(mLock);
+
+    return i;
+}
+
+SDL_Surface *ImageDecoder::takeSurface(int i)
+{
+    SDL_Surface *surface = mJobs[i].surface;
+    mJobs[i].surface = NULL;
+    return surface;
+}
+
+const char *ImageDecoder::getPath(int i) { return mJobs[i].path; }
+
+double ImageDecoder::getDecodeMs(int i) { return mJobs[i].decodeMs; }
+
+int ImageDecoder::getThreadCount() { return (int)mThreads.size(); }
+
+void ImageDecoder::wait()
+{
+    for (size_t i = 0; i < mThreads.size(); i++) {
+        SDL_WaitThread(mThreads[i], NULL);
+    }
+    mThreads.clear();
+}
@@ -0,0 +1,69 @@
+#ifndef IMAGE_DECODER_H
+#define IMAGE_DECODER_H
+
+#include <SDL.h>
+#include <vector>
+
+// Loads an image as RGBA32 with the cyan color key (0, 255, 255) made transparent
+SDL_Surface *loadKeyedImage(const char *path);
+
+// Decodes images with loadKeyedImage() on worker threads
+// The main thread collects finished surfaces with next() as they come in
+class ImageDecoder
+{
+    public:
+        // Initialization
+        ImageDecoder();
+
+        // Waits for workers and frees uncollected surfaces
+        ~ImageDecoder();
+
+        // Queues an image (before start()), returns its index
+        int add(const char *path);
+
+        // Starts decoding on up to threadCount workers
+        void start(int threadCount);
+
+        // Blocks until another image is decoded, returns its index (-1 once all are collected)
+        int next();
+
+        // Takes ownership of a decoded surface (NULL if decoding failed)
+        SDL_Surface *takeSurface(int i);
+
+        // Gets an image's path and how long it took to decode (milliseconds)
+        const char *getPath(int i);
+        double getDecodeMs(int i);
+
+        // Gets how many workers were started
+        int getThreadCount();
+
+    private:
+        // Worker thread entry point
+        static int workerMain(void *data);
+
+        // Waits for the workers to exit
+        void wait();
+
+        struct Job
+        {
+            const char *path;
+            SDL_Surface *surface;
+            double decodeMs;
+        };
+
+        std::vector<Job> mJobs;
+        std::vector<SDL_Thread*> mThreads;
+
+        // Everything below is guarded by mLock
+        SDL_mutex *mLock;
+        SDL_cond *mJobDone;
+
+        // Next job a worker takes
+        int mNextJob;
+
+        // Finished jobs in completion order, and how many of them next() returned
+        std::vector<int> mFinished;
+        int mCollected;
+};
+
+#endif
@@ -0,0 +1,97 @@
+#include "InputLatency.h"
+
+#include <math.h>
+
+InputLatency::InputLatency()
+{
+    mFirst = 0;
+    mCount = 0;
+    mNewest = 0;
+    clearHistogram(mRecent);
+    clearHistogram(mSession);
+    mFrequency = SDL_GetPerformanceFrequency();
+}
+
+void InputLatency::addEvent(Uint64 time)
+{
+    // Stamps have to stay in order for presented() (SDL's ms resolution can put one a hair behind)
+    if (time < mNewest) { time = mNewest; }
+    mNewest = time;
+
+    if (mCount == MAX_PENDING_EVENTS) {
+        mFirst = (mFirst+1) % MAX_PENDING_EVENTS;
+        mCount--;
+    }
+    mPending[(mFirst+mCount) % MAX_PENDING_EVENTS] = time;
+    mCount++;
+}
+
+Uint64 InputLatency::getNewestEvent() { return mNewest; }
+
+void InputLatency::presented(Uint64 newestShown, Uint64 presentTime)
+{
+    while (mCount > 0 && mPending[mFirst] <= newestShown) {
+        Uint64 time = mPending[mFirst];
+        mFirst = (mFirst+1) % MAX_PENDING_EVENTS;
+        mCount--;
+
+        double ms = presentTime > time ? (presentTime-time)*1000.0/mFrequency : 0;
+        int bin = (int)(ms/LATENCY_BIN_MS);
+        if (bin >= LATENCY_BINS) { bin = LATENCY_BINS-1; }
+
+        Histogram *histograms[2] = {&mRecent, &mSession};
+        for (int h = 0; h < 2; h++) {
+            histograms[h]->bins[bin]++;
+            histograms[h]->samples++;
+            if (ms > histograms[h]->maxMs)
+                histograms[h]->maxMs = ms;
+        }
+    }
+}
+
+LatencyStats InputLatency::takeStats()
+{
+    LatencyStats stats = summarize(mRecent);
+    clearHistogram(mRecent);
+    return stats;
+}
+
+LatencyStats InputLatency::getSessionStats() { return summarize(mSession); }
+
+void InputLatency::clearHistogram(Histogram &histogram)
+{
+    for (int i = 0; i < LATENCY_BINS; i++) {
+        histogram.bins[i] = 0;
+    }
+    histogram.samples = 0;
+    histogram.maxMs = 0;
+}
+
+LatencyStats InputLatency::summarize(const Histogram &histogram)
+{
+    LatencyStats stats = {histogram.samples, 0, 0, 0, histogram.maxMs};
+    double percents[3] = {0.5, 0.9, 0.99};
+    double *results[3] = {&stats.p50Ms, &stats.p90Ms, &stats.p99Ms};
+
+    // Nearest rank, reported as the top of its bin (but never past the slowest seen)
+    for (int p = 0; p < 3 && histogram.samples > 0; p++) {
+        int rank = (int)ceil(percents[p]*histogram.samples);
+        int seen = 0;
+        int bin = 0;
+        while (bin < LATENCY_BINS-1 && seen+histogram.bins[bin] < rank) {
+            seen += histogram.bins[bin];
+            bin++;
+        }
+        double ms = (bin+1)*LATENCY_BIN_MS;
+        *results[p] = ms < histogram.maxMs ? ms : histogram.maxMs;
+    }
+    return stats;
+}
+
+Uint64 eventTime(const SDL_Event &event)
+{
+    Uint64 now = SDL_GetPerformanceCounter();
+    Uint32 age = SDL_GetTicks()-event.common.timestamp;
+    Uint64 ticks = (Uint64)age*SDL_GetPerformanceFrequency()/1000;
+    return ticks < now ? now-ticks : 0;
+}
@@ -0,0 +1,76 @@
+#ifndef INPUT_LATENCY_H
+#define INPUT_LATENCY_H
+
+#include <SDL.h>
+
+// Latencies are binned this finely (event timestamps only have 1 ms resolution anyway)
+const double LATENCY_BIN_MS = 0.25;
+
+// Bins up to 200 ms, the last one holds everything slower
+const int LATENCY_BINS = 800;
+
+// Input events waiting for a present that shows them (older ones are dropped past this)
+const int MAX_PENDING_EVENTS = 256;
+
+// Percentiles over a set of input latencies, in ms
+struct LatencyStats
+{
+    int samples;
+    double p50Ms;
+    double p90Ms;
+    double p99Ms;
+    double maxMs;
+};
+
+// Measures input to present latency on the main thread
+// Every input event is stamped as it's handled, and the snapshot of each tick carries the newest
+// stamp its input included. Once a frame drawn from a snapshot is presented, every stamp up to
+// the snapshot's gets that frame's present time. Nothing allocates after construction
+class InputLatency
+{
+    public:
+        // Initialization
+        InputLatency();
+
+        // Stamps an input event with the performance counter time it happened
+        void addEvent(Uint64 time);
+
+        // Gets the newest stamp (0 before any), posted along with the input it changed
+        Uint64 getNewestEvent();
+
+        // A frame showing every event up to newestShown was presented at presentTime
+        void presented(Uint64 newestShown, Uint64 presentTime);
+
+        // Gets the stats since the last call, and starts counting again
+        LatencyStats takeStats();
+
+        // Gets the stats over every event measured
+        LatencyStats getSessionStats();
+
+    private:
+        struct Histogram
+        {
+            int bins[LATENCY_BINS];
+            int samples;
+            double maxMs;
+        };
+
+        static void clearHistogram(Histogram &histogram);
+        static LatencyStats summarize(const Histogram &histogram);
+
+        // Ring buffer of stamps not presented yet, oldest at mFirst
+        Uint64 mPending[MAX_PENDING_EVENTS];
+        int mFirst;
+        int mCount;
+        Uint64 mNewest;
+
+        Histogram mRecent;
+        Histogram mSession;
+
+        Uint64 mFrequency;
+};
+
+// Gets an event's time on the performance counter (SDL stamps events in ms when they're queued)
+Uint64 eventTime(const SDL_Event &event);
+
+#endif
@@ -0,0 +1,211 @@
+#include "JobSystem.h"
+
+#include <stdio.h>
+
+JobCounter::JobCounter() { SDL_AtomicSet(&mPending, 0); }
+
+void JobCounter::add(int count) { SDL_AtomicAdd(&mPending, count); }
+
+void JobCounter::done() { SDL_AtomicAdd(&mPending, -1); }
+
+bool JobCounter::finished() { return SDL_AtomicGet(&mPending) == 0; }
+
+JobSystem::JobSystem()
+{
+    mNextQueue = 0;
+    mWake = NULL;
+    SDL_AtomicSet(&mQuit, 0);
+    SDL_AtomicSet(&mSteals, 0);
+}
+
+JobSystem::~JobSystem() { stop(); }
+
+bool JobSystem::start(int workers)
+{
+    stop();
+    if (workers < 0) { workers = 0; }
+    if (workers > MAX_JOB_WORKERS) { workers = MAX_JOB_WORKERS; }
+
+    mWake = SDL_CreateSemaphore(0);
+    if (!mWake) {
+        printf("Unable to create job semaphore. SDL Error: %s\n", SDL_GetError());
+        return false;
+    }
+    SDL_AtomicSet(&mQuit, 0);
+    SDL_AtomicSet(&mSteals, 0);
+    mNextQueue = 0;
+
+    // Every queue exists before any worker starts stealing from them
+    for (int i = 0; i <= workers; i++) {
+        JobQueue *queue = new JobQueue;
+        queue->system = this;
+        queue->index = i;
+        queue->thread = NULL;
+        queue->lock = SDL_CreateMutex();
+        queue->top = 0;
+        queue->bottom = 0;
+        mQueues.push_back(queue);
+        if (!queue->lock) {
+            printf("Unable to create job queue lock. SDL Error: %s\n", SDL_GetError());
+            stop();
+            return false;
+        }
+    }
+    for (int i = 1; i <= workers; i++) {
+        mQueues[i]->thread = SDL_CreateThread(workerMain, "Job worker", mQueues[i]);
+        if (!mQueues[i]->thread) {
+            printf("Unable to create job worker. SDL Error: %s\n", SDL_GetError());
+            stop();
+            return false;
+        }
+    }
+    return true;
+}
+
+void JobSystem::stop()
+{
+    SDL_AtomicSet(&mQuit, 1);
+    for (size_t i = 1; i < mQueues.size(); i++) {
+        SDL_SemPost(mWake);
+    }
+    for (size_t i = 0; i < mQueues.size(); i++) {
+        if (mQueues[i]->thread)
+            SDL_WaitThread(mQueues[i]->thread, NULL);
+    }
+    for (size_t i = 0; i < mQueues.size(); i++) {
+        if (mQueues[i]->lock)
+            SDL_DestroyMutex(mQueues[i]->lock);
+        delete mQueues[i];
+    }
+    mQueues.clear();
+
+    if (mWake) {
+        SDL_DestroySemaphore(mWake);
+        mWake = NULL;
+    }
+}
+
+bool JobSystem::push(JobQueue &queue, const Job &job)
+{
+    SDL_LockMutex(queue.lock);
+    bool pushed = queue.bottom-queue.top < JOB_QUEUE_SIZE;
+    if (pushed) {
+        queue.jobs[queue.bottom % JOB_QUEUE_SIZE] = job;
+        queue.bottom++;
+    }
+    SDL_UnlockMutex(queue.lock);
+    return pushed;
+}
+
+bool JobSystem::pop(JobQueue &queue, Job &job)
+{
+    SDL_LockMutex(queue.lock);
+    bool popped = queue.bottom > queue.top;
+    if (popped) {
+        queue.bottom--;
+        job = queue.jobs[queue.bottom % JOB_QUEUE_SIZE];
+    }
+    SDL_UnlockMutex(queue.lock);
+    return popped;
+}
+
+bool JobSystem::steal(JobQueue &queue, Job &job)
+{
+    SDL_LockMutex(queue.lock);
+    bool stolen = queue.bottom > queue.top;
+    if (stolen) {
+        job = queue.jobs[queue.top % JOB_QUEUE_SIZE];
+        queue.top++;
+    }
+    SDL_UnlockMutex(queue.lock);
+    return stolen;
+}
+
+void JobSystem::submit(JobFunction function, void *data, int begin, int end, JobCounter &counter)
+{
+    Job job = {function, data, begin, end, &counter};
+    counter.add(1);
+
+    int queue = mNextQueue;
+    if (mQueues.size() <= 1 || !push(*mQueues[queue], job)) {
+        function(data, begin, end);
+        counter.done();
+        return;
+    }
+    mNextQueue = (mNextQueue+1) % (int)mQueues.size();
+
+    // The submitting thread runs its own deque in wait(), so only jobs on a worker's deque need a wake
+    if (queue != 0)
+        SDL_SemPost(mWake);
+}
+
+bool JobSystem::runOne(int queue)
+{
+    Job job;
+    bool found = pop(*mQueues[queue], job);
+
+    // Steals from the next thread along first, so thieves spread out
+    int count = (int)mQueues.size();
+    for (int i = 1; i < count && !found; i++) {
+        found = steal(*mQueues[(queue+i) % count], job);
+        if (found)
+            SDL_AtomicAdd(&mSteals, 1);
+    }
+    if (!found) { return false; }
+
+    job.function(job.data, job.begin, job.end);
+    job.counter->done();
+    return true;
+}
+
+void JobSystem::wait(JobCounter &counter)
+{
+    if (mQueues.empty()) { return; }
+
+    // Helps out instead of blocking; only spins once every job left is already running elsewhere
+    while (!counter.finished()) {
+        runOne(0);
+    }
+}
+
+void JobSystem::parallelFor(int count, int grain, JobFunction function, void *data)
+{
+    if (count <= 0) { return; }
+    if (grain < 1) { grain = 1; }
+    if (mQueues.size() <= 1 || count <= grain) {
+        function(data, 0, count);
+        return;
+    }
+
+    // About four ranges per thread so a slow one can be stolen from, but never under grain
+    int threads = (int)mQueues.size();
+    int size = (count+threads*4-1)/(threads*4);
+    if (size < grain) { size = grain; }
+
+    JobCounter counter;
+    mNextQueue = 0;
+    for (int begin = 0; begin < count; begin+=size) {
+        int end = begin+size < count ? begin+size : count;
+        submit(function, data, begin, end, counter);
+    }
+    wait(counter);
+
+    // Every job is done, so wakes left over from jobs some other thread stole would only spin workers
+    while (SDL_SemTryWait(mWake) == 0) {}
+}
+
+int JobSystem::getWorkerCount() { return mQueues.empty() ? 0 : (int)mQueues.size()-1; }
+
+int JobSystem::getSteals() { return SDL_AtomicGet(&mSteals); }
+
+int JobSystem::workerMain(void *data)
+{
+    JobQueue &queue = *(JobQueue*)data;
+    JobSystem &system = *queue.system;
+
+    while (!SDL_AtomicGet(&system.mQuit)) {
+        if (!system.runOne(queue.index))
+            SDL_SemWait(system.mWake);
+    }
+    return 0;
+}
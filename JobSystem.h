@@ -0,0 +1,107 @@
+#ifndef JOB_SYSTEM_H
+#define JOB_SYSTEM_H
+
+#include <SDL.h>
+#include <vector>
+
+// Most workers a job system will start
+const int MAX_JOB_WORKERS = 16;
+
+// Jobs one deque can hold (submit() runs a job at once if its deque is full)
+const int JOB_QUEUE_SIZE = 256;
+
+// Work on items begin to end-1 of whatever data points to
+typedef void (*JobFunction)(void *data, int begin, int end);
+
+// Counts unfinished jobs; JobSystem::wait() returns once it reaches 0
+class JobCounter
+{
+    public:
+        JobCounter();
+
+        // Adds count pending jobs / marks one done
+        void add(int count);
+        void done();
+
+        // True once every job counted on it is done
+        bool finished();
+
+    private:
+        SDL_atomic_t mPending;
+};
+
+// Small work-stealing scheduler
+// Every thread (the one submitting jobs, plus each worker) has its own deque. A thread
+// runs its newest job first, and once its deque is empty it steals the oldest job from
+// another. Only one thread may submit and wait at a time, and while it does it owns queue 0
+// (that needn't be the thread that called start()). Jobs must not submit jobs themselves
+class JobSystem
+{
+    public:
+        JobSystem();
+        ~JobSystem();
+
+        // Starts worker threads (0 runs every job on the submitting thread), returns false if one can't be created
+        bool start(int workers);
+
+        // Finishes the workers (any queued jobs must have been waited on first)
+        void stop();
+
+        // Queues function(data, begin, end) on the next deque in turn and counts it on counter
+        void submit(JobFunction function, void *data, int begin, int end, JobCounter &counter);
+
+        // Runs and steals jobs on this thread until counter is finished
+        void wait(JobCounter &counter);
+
+        // Splits 0 to count-1 into ranges of at least grain items, runs them on every thread and waits
+        // Runs function(data, 0, count) directly if there are no workers or count fits in one grain
+        void parallelFor(int count, int grain, JobFunction function, void *data);
+
+        // Gets how many worker threads are running
+        int getWorkerCount();
+
+        // Gets how many jobs have been stolen from another thread's deque since start()
+        int getSteals();
+
+    private:
+        struct Job
+        {
+            JobFunction function;
+            void *data;
+            int begin;
+            int end;
+            JobCounter *counter;
+        };
+
+        // One thread's jobs; the owner pushes and pops at the bottom, thieves take from the top
+        struct JobQueue
+        {
+            JobSystem *system;
+            int index;
+            SDL_Thread *thread;
+            SDL_mutex *lock;
+            Job jobs[JOB_QUEUE_SIZE];
+            int top;
+            int bottom;
+        };
+
+        bool push(JobQueue &queue, const Job &job);
+        bool pop(JobQueue &queue, Job &job);
+        bool steal(JobQueue &queue, Job &job);
+
+        // Runs one job from queue's own deque or stolen from another, returns false if there were none
+        bool runOne(int queue);
+
+        static int workerMain(void *data);
+
+        // Queue 0 belongs to whichever thread is submitting, the rest to the workers
+        std::vector<JobQueue*> mQueues;
+        int mNextQueue;
+
+        // Posted once per job queued on a worker's deque so idle workers wake up
+        SDL_sem *mWake;
+        SDL_atomic_t mQuit;
+        SDL_atomic_t mSteals;
+};
+
+#endif
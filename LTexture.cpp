@@ -0,0 +1,281 @@
+// SDL_ttf comes first so loadFromRenderedText is declared
+#include <SDL2/SDL_image.h>
+#include <SDL2/SDL_ttf.h>
+#include <stdio.h>
+
+#include "LTexture.h"
+#include "DirtyRects.h"
+
+// Creates window renderer
+SDL_Renderer *gRenderer = NULL;
+
+// Draw calls issued this frame
+int gDrawCalls = 0;
+
+LTexture::LTexture()
+{
+	// Initialize texture stuff
+	mTexture = NULL;
+	mWidth = 0;
+	mHeight = 0;
+	mIsView = false;
+	mView.x = mView.y = mView.w = mView.h = 0;
+	mRed = mGreen = mBlue = mAlpha = 0xFF;
+	mBlendMode = SDL_BLENDMODE_BLEND;
+}
+
+LTexture::~LTexture()
+{
+	// Deallocate texture stuff
+	free();
+}
+
+bool LTexture::loadFromFile (std::string path)
+{
+	// Deallocate preexisting texture
+	free();
+
+	// The usable texture
+	SDL_Texture *newTexture = NULL;
+
+	// Load image from path
+	SDL_Surface *loadedSurface = IMG_Load(path.c_str());
+	if (!loadedSurface) {
+        // Spits out specific error if something goes wrong
+		printf("Unable to load image %s. SDL_image Error: %s\n", path.c_str(), IMG_GetError());
+	} else {
+		// Color keys the image
+		SDL_SetColorKey(loadedSurface, SDL_TRUE, SDL_MapRGB(loadedSurface->format, 0, 0xFF, 0xFF));
+
+		// Creates texture from surface
+        newTexture = SDL_CreateTextureFromSurface(gRenderer, loadedSurface);
+		if (!newTexture) {
+            // Spits out specific error if something goes wrong
+			printf("Unable to create texture from %s. SDL Error: %s\n", path.c_str(), SDL_GetError());
+		} else {
+			// Gets image dimensions
+			mWidth = loadedSurface->w;
+			mHeight = loadedSurface->h;
+
+			// Solid pixels, from the keyed surface
+			buildMask(loadedSurface);
+		}
+
+		// Gets rid of the old surface
+		SDL_FreeSurface(loadedSurface);
+	}
+
+	// Return success
+	mTexture = newTexture;
+	return mTexture != NULL;
+}
+
+bool LTexture::loadFromSurface (SDL_Surface *surface)
+{
+	// Deallocate preexisting texture
+	free();
+
+	// Creates texture from surface
+	mTexture = SDL_CreateTextureFromSurface(gRenderer, surface);
+	if (!mTexture) {
+		printf("Unable to create texture from surface. SDL Error: %s\n", SDL_GetError());
+	} else {
+		// Gets image dimensions
+		mWidth = surface->w;
+		mHeight = surface->h;
+		buildMask(surface);
+	}
+
+	// Return success
+	return mTexture != NULL;
+}
+
+#ifdef _SDL_TTF_H
+bool LTexture::loadFromRenderedText (std::string textureText, SDL_Color textColor, TTF_Font *Font)
+{
+	// Gets rid of the preexisting texture
+	free();
+
+	// Renders text surface
+	SDL_Surface *textSurface = TTF_RenderText_Solid(Font, textureText.c_str(), textColor);
+	if (!textSurface) {
+        printf("Unable to render text surface. SDL_ttf Error: %s\n", TTF_GetError());
+	} else {
+		// Creates texture from surface
+        mTexture = SDL_CreateTextureFromSurface(gRenderer, textSurface);
+		if (!mTexture) {
+            // Spits out specific error if something goes wrong
+			printf("Unable to create texture from rendered text. SDL Error: %s\n", SDL_GetError());
+		} else {
+			// Gets image dimensions
+			mWidth = textSurface->w;
+			mHeight = textSurface->h;
+		}
+
+		// Gets rid of old surface
+		SDL_FreeSurface( textSurface );
+	}
+
+	// Return success
+	return mTexture != NULL;
+}
+#endif
+
+void LTexture::setView (SDL_Texture *texture, SDL_Rect view)
+{
+	// Deallocate preexisting texture
+	free();
+
+	mTexture = texture;
+	mIsView = true;
+	mView = view;
+	mWidth = view.w;
+	mHeight = view.h;
+}
+
+void LTexture::free()
+{
+	// If texture exists, free it (views don't own theirs)
+	if (mTexture) {
+		if (!mIsView) {
+			SDL_DestroyTexture(mTexture);
+		}
+		mTexture = NULL;
+		mWidth = 0;
+		mHeight = 0;
+	}
+	mIsView = false;
+	mMask.resize(0, 0);
+}
+
+void LTexture::setColorMod (Uint8 red, Uint8 green, Uint8 blue)
+{
+	// Modulates texture RGB
+	mRed = red;
+	mGreen = green;
+	mBlue = blue;
+	if (!mIsView) {
+		SDL_SetTextureColorMod(mTexture, red, green, blue);
+	}
+}
+
+void LTexture::setBlendMode (SDL_BlendMode blending)
+{
+	// Sets blending function
+	mBlendMode = blending;
+	if (!mIsView) {
+		SDL_SetTextureBlendMode(mTexture, blending);
+	}
+}
+
+void LTexture::setAlphaMod (Uint8 alpha)
+{
+	// Modulates texture alpha (transparency)
+	mAlpha = alpha;
+	if (!mIsView) {
+		SDL_SetTextureAlphaMod(mTexture, alpha);
+	}
+}
+
+void LTexture::render (int x, int y, SDL_Rect* clip, double angle, SDL_Point* center, SDL_RendererFlip flip)
+{
+	// Set rendering space in window
+	SDL_Rect renderQuad = {x, y, mWidth, mHeight};
+
+	// Sets clip rendering dimensions
+	if (clip) {
+		renderQuad.w = clip->w;
+		renderQuad.h = clip->h;
+	}
+
+	// Views draw from their part of the shared texture with their own modulation
+	SDL_Rect viewClip = mView;
+	if (mIsView && clip) {
+		viewClip.x += clip->x;
+		viewClip.y += clip->y;
+		viewClip.w = clip->w;
+		viewClip.h = clip->h;
+	}
+
+	// Partial redraws only want to know where this lands and what it looks like
+	if (gDirty.isRecording()) {
+		SDL_Rect source = {0, 0, mWidth, mHeight};
+		if (mIsView) {
+			source = viewClip;
+		} else if (clip) {
+			source = *clip;
+		}
+		SDL_Color modulation = {mRed, mGreen, mBlue, mAlpha};
+		Uint32 key = mixKey(drawKey(mTexture, source, modulation), (int)(angle*256));
+		gDirty.record(rotatedBounds(renderQuad, angle, center), mixKey(key, flip*16+mBlendMode));
+		return;
+	}
+
+	if (mIsView) {
+		SDL_SetTextureColorMod(mTexture, mRed, mGreen, mBlue);
+		SDL_SetTextureAlphaMod(mTexture, mAlpha);
+		SDL_SetTextureBlendMode(mTexture, mBlendMode);
+		SDL_RenderCopyEx(gRenderer, mTexture, &viewClip, &renderQuad, angle, center, flip);
+		gDrawCalls++;
+		return;
+	}
+
+	// Renders to screen
+	SDL_RenderCopyEx(gRenderer, mTexture, clip, &renderQuad, angle, center, flip);
+	gDrawCalls++;
+}
+
+int LTexture::getWidth() { return mWidth; }
+
+int LTexture::getHeight() { return mHeight; }
+
+SDL_Texture *LTexture::getTexture() { return mTexture; }
+
+SDL_Rect LTexture::getSourceRect()
+{
+	if (mIsView) { return mView; }
+	SDL_Rect whole = {0, 0, mWidth, mHeight};
+	return whole;
+}
+
+SDL_Color LTexture::getModulation()
+{
+	SDL_Color modulation = {mRed, mGreen, mBlue, mAlpha};
+	return modulation;
+}
+
+void LTexture::buildMask (SDL_Surface *surface)
+{
+	mMask.resize(surface->w, surface->h);
+
+	Uint32 key = 0;
+	bool keyed = SDL_GetColorKey(surface, &key) == 0;
+	int bytes = surface->format->BytesPerPixel;
+
+	// Reads each pixel in the surface's own format (like SDL's getpixel example)
+	SDL_LockSurface(surface);
+	for (int y = 0; y < surface->h; y++) {
+		const Uint8 *pixel = (const Uint8*)surface->pixels + y*surface->pitch;
+		for (int x = 0; x < surface->w; x++, pixel += bytes) {
+			Uint32 value;
+			if (bytes == 1) {
+				value = *pixel;
+			} else if (bytes == 2) {
+				value = *(const Uint16*)pixel;
+			} else if (bytes == 3) {
+				value = SDL_BYTEORDER == SDL_BIG_ENDIAN ? pixel[0] << 16 | pixel[1] << 8 | pixel[2] : pixel[0] | pixel[1] << 8 | pixel[2] << 16;
+			} else {
+				value = *(const Uint32*)pixel;
+			}
+			if (keyed && value == key) { continue; }
+
+			Uint8 r, g, b, a;
+			SDL_GetRGBA(value, surface->format, &r, &g, &b, &a);
+			if (a > 0)
+				mMask.set(x, y);
+		}
+	}
+	SDL_UnlockSurface(surface);
+}
+
+const CollisionMask &LTexture::getMask() { return mMask; }
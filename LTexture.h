@@ -0,0 +1,93 @@
+#ifndef LTEXTURE_H
+#define LTEXTURE_H
+
+#include <SDL.h>
+#include <string>
+
+#include "Collision.h"
+
+// Renderer every texture is created for and drawn with (set up by the game)
+extern SDL_Renderer *gRenderer;
+
+// Draw calls issued this frame (LTexture::render counts itself)
+extern int gDrawCalls;
+
+// Class for textures
+class LTexture
+{
+	public:
+		// Initialization
+		LTexture();
+
+		// Deallocation
+		~LTexture();
+
+		// Image loading
+		bool loadFromFile (std::string path);
+
+		// Creates texture from an already decoded surface (surface stays with the caller)
+		bool loadFromSurface (SDL_Surface *surface);
+
+        // ifdef in case SDL_TTF isn't installed
+		#ifdef _SDL_TTF_H
+		// Font string -> image
+		bool loadFromRenderedText( std::string textureText, SDL_Color textColor, TTF_Font *Font );
+		#endif
+
+		// Builds the collision mask from the image's surface (color keyed and fully transparent pixels are empty)
+		void buildMask(SDL_Surface *surface);
+
+		// Makes this a view of part of a shared texture (e.g. an atlas page, which owns it)
+		void setView(SDL_Texture *texture, SDL_Rect view);
+
+		// Texture deallocation
+		void free();
+
+		// Sets color modulation
+		void setColorMod(Uint8 red, Uint8 green, Uint8 blue);
+
+		// Sets blending
+		void setBlendMode(SDL_BlendMode blending);
+
+		// Sets alpha modulation
+		void setAlphaMod(Uint8 alpha);
+
+		// Renders texture at point
+		void render(int x, int y, SDL_Rect *clip = NULL, double angle = 0.0, SDL_Point *center = NULL, SDL_RendererFlip flip = SDL_FLIP_NONE);
+
+		// Gets image dimensions (mWidth, mHeight)
+		int getWidth();
+		int getHeight();
+
+		// Gets the texture, the image's rect within it and its modulation (for batching)
+		SDL_Texture *getTexture();
+		SDL_Rect getSourceRect();
+		SDL_Color getModulation();
+
+		// Gets the solid pixels (empty for textures loaded without a surface to build it from)
+		const CollisionMask &getMask();
+
+	private:
+		// The actual texture
+		SDL_Texture* mTexture;
+
+		// Image dimensions
+		int mWidth;
+		int mHeight;
+
+		// Where the image sits in mTexture if this is a view
+		bool mIsView;
+		SDL_Rect mView;
+
+		// Modulation/blending (views share a texture, so they set these on every render)
+		Uint8 mRed;
+		Uint8 mGreen;
+		Uint8 mBlue;
+		Uint8 mAlpha;
+		SDL_BlendMode mBlendMode;
+
+		// Solid pixels, for pixel-perfect hits
+		CollisionMask mMask;
+};
+
+#endif
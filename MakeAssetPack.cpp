@@ -0,0 +1,58 @@
+#include <SDL.h>
+#include <SDL2/SDL_image.h>
+#include <stdio.h>
+#include <vector>
+
+#include "AssetPack.h"
+#include "ImageDecoder.h"
+
+// Offline tool: decodes and color keys images once and bakes them into a pack file
+// Usage (from the repo root): MakeAssetPack DS_Game/assets.pack DS_Game/*.png
+int main (int argc, char *args[])
+{
+    if (argc < 3) {
+        printf("Usage: %s <output.pack> <image.png>...\n", args[0]);
+        return 1;
+    }
+
+    if (SDL_Init(0) < 0) {
+        printf("SDL could not initialize. SDL Error: %s\n", SDL_GetError());
+        return 1;
+    }
+    int imgFlags = IMG_INIT_PNG;
+    if (!(IMG_Init(imgFlags) & imgFlags)) {
+        printf("SDL_image could not initialize. SDL_image Error: %s\n", IMG_GetError());
+        SDL_Quit();
+        return 1;
+    }
+
+    // Images are stored under the path given on the command line (what the game asks for)
+    bool success = true;
+    std::vector<const char*> names;
+    std::vector<SDL_Surface*> surfaces;
+    for (int i = 2; i < argc; i++) {
+        SDL_Surface *surface = loadKeyedImage(args[i]);
+        if (!surface) {
+            success = false;
+            continue;
+        }
+        names.push_back(args[i]);
+        surfaces.push_back(surface);
+        printf("Packed %s (%dx%d)\n", args[i], surface->w, surface->h);
+    }
+
+    if (success) {
+        success = writeAssetPack(args[1], names, surfaces);
+    }
+    if (success) {
+        printf("Wrote %d images to %s\n", (int)names.size(), args[1]);
+    }
+
+    for (size_t i = 0; i < surfaces.size(); i++) {
+        SDL_FreeSurface(surfaces[i]);
+    }
+    IMG_Quit();
+    SDL_Quit();
+
+    return success ? 0 : 1;
+}
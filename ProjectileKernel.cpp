@@ -0,0 +1,178 @@
+#include "ProjectileKernel.h"
+
+#include <stddef.h>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define KERNEL_X86 1
+#include <immintrin.h>
+#endif
+
+#if defined(KERNEL_X86) && defined(_MSC_VER)
+#include <intrin.h>
+#define KERNEL_SSE2_TARGET
+#define KERNEL_AVX2_TARGET
+#elif defined(KERNEL_X86) && defined(__GNUC__)
+#define KERNEL_SSE2_TARGET __attribute__((target("sse2")))
+#define KERNEL_AVX2_TARGET __attribute__((target("avx2")))
+#else
+#undef KERNEL_X86
+#endif
+
+// Scalar path, also finishes the last few projectiles for the SIMD paths
+template <bool uniform>
+static void integrateScalar(int *posX, int *posY, const int *velX, const int *velY, int vx, int vy,
+                            int first, int count, const CollisionBox &bounds, unsigned char *kill)
+{
+    for (int i = first; i < count; i++) {
+        posX[i]+=uniform ? vx : velX[i];
+        posY[i]+=uniform ? vy : velY[i];
+        kill[i] = !boxContains(bounds, posX[i], posY[i]);
+    }
+}
+
+#ifdef KERNEL_X86
+
+// 8 projectiles per step as two 4-wide halves
+template <bool uniform>
+KERNEL_SSE2_TARGET static void integrateSSE2(int *posX, int *posY, const int *velX, const int *velY, int vx, int vy,
+                                             int count, const CollisionBox &bounds, unsigned char *kill)
+{
+    // Inside means left-1 < x < right and top-1 < y < bottom
+    const __m128i left = _mm_set1_epi32(bounds.x-1);
+    const __m128i right = _mm_set1_epi32(bounds.x+bounds.w);
+    const __m128i top = _mm_set1_epi32(bounds.y-1);
+    const __m128i bottom = _mm_set1_epi32(bounds.y+bounds.h);
+    const __m128i uniformX = _mm_set1_epi32(vx);
+    const __m128i uniformY = _mm_set1_epi32(vy);
+    const __m128i ones = _mm_set1_epi8(1);
+
+    int i = 0;
+    for (; i+8 <= count; i+=8) {
+        __m128i outside[2];
+        for (int half = 0; half < 2; half++) {
+            int at = i+half*4;
+            __m128i x = _mm_loadu_si128((const __m128i*)(posX+at));
+            __m128i y = _mm_loadu_si128((const __m128i*)(posY+at));
+            x = _mm_add_epi32(x, uniform ? uniformX : _mm_loadu_si128((const __m128i*)(velX+at)));
+            y = _mm_add_epi32(y, uniform ? uniformY : _mm_loadu_si128((const __m128i*)(velY+at)));
+            _mm_storeu_si128((__m128i*)(posX+at), x);
+            _mm_storeu_si128((__m128i*)(posY+at), y);
+
+            __m128i inside = _mm_and_si128(_mm_cmpgt_epi32(x, left), _mm_cmpgt_epi32(right, x));
+            inside = _mm_and_si128(inside, _mm_and_si128(_mm_cmpgt_epi32(y, top), _mm_cmpgt_epi32(bottom, y)));
+            outside[half] = _mm_cmpeq_epi32(inside, _mm_setzero_si128());
+        }
+
+        // 8 lanes of all-ones/zero narrowed to 8 bytes of 1/0
+        __m128i words = _mm_packs_epi32(outside[0], outside[1]);
+        __m128i bytes = _mm_and_si128(_mm_packs_epi16(words, words), ones);
+        _mm_storel_epi64((__m128i*)(kill+i), bytes);
+    }
+
+    integrateScalar<uniform>(posX, posY, velX, velY, vx, vy, i, count, bounds, kill);
+}
+
+// 8 projectiles per step in one 8-wide register
+template <bool uniform>
+KERNEL_AVX2_TARGET static void integrateAVX2(int *posX, int *posY, const int *velX, const int *velY, int vx, int vy,
+                                             int count, const CollisionBox &bounds, unsigned char *kill)
+{
+    const __m256i left = _mm256_set1_epi32(bounds.x-1);
+    const __m256i right = _mm256_set1_epi32(bounds.x+bounds.w);
+    const __m256i top = _mm256_set1_epi32(bounds.y-1);
+    const __m256i bottom = _mm256_set1_epi32(bounds.y+bounds.h);
+    const __m256i uniformX = _mm256_set1_epi32(vx);
+    const __m256i uniformY = _mm256_set1_epi32(vy);
+    const __m128i ones = _mm_set1_epi8(1);
+
+    int i = 0;
+    for (; i+8 <= count; i+=8) {
+        __m256i x = _mm256_loadu_si256((const __m256i*)(posX+i));
+        __m256i y = _mm256_loadu_si256((const __m256i*)(posY+i));
+        x = _mm256_add_epi32(x, uniform ? uniformX : _mm256_loadu_si256((const __m256i*)(velX+i)));
+        y = _mm256_add_epi32(y, uniform ? uniformY : _mm256_loadu_si256((const __m256i*)(velY+i)));
+        _mm256_storeu_si256((__m256i*)(posX+i), x);
+        _mm256_storeu_si256((__m256i*)(posY+i), y);
+
+        __m256i inside = _mm256_and_si256(_mm256_cmpgt_epi32(x, left), _mm256_cmpgt_epi32(right, x));
+        inside = _mm256_and_si256(inside, _mm256_and_si256(_mm256_cmpgt_epi32(y, top), _mm256_cmpgt_epi32(bottom, y)));
+        __m256i outside = _mm256_cmpeq_epi32(inside, _mm256_setzero_si256());
+
+        __m128i words = _mm_packs_epi32(_mm256_castsi256_si128(outside), _mm256_extracti128_si256(outside, 1));
+        __m128i bytes = _mm_and_si128(_mm_packs_epi16(words, words), ones);
+        _mm_storel_epi64((__m128i*)(kill+i), bytes);
+    }
+
+    integrateScalar<uniform>(posX, posY, velX, velY, vx, vy, i, count, bounds, kill);
+}
+
+#endif
+
+// Checks the CPU (and that the OS saves AVX registers)
+static SimdPath detectSimdPath()
+{
+#if defined(KERNEL_X86) && defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 1);
+    bool sse2 = (info[3] & (1 << 26)) != 0;
+    bool osAvx = (info[2] & (1 << 27)) != 0 && (_xgetbv(0) & 6) == 6;
+    __cpuidex(info, 7, 0);
+    bool avx2 = osAvx && (info[1] & (1 << 5)) != 0;
+    if (avx2) { return SIMD_AVX2; }
+    if (sse2) { return SIMD_SSE2; }
+#elif defined(KERNEL_X86)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) { return SIMD_AVX2; }
+    if (__builtin_cpu_supports("sse2")) { return SIMD_SSE2; }
+#endif
+    return SIMD_SCALAR;
+}
+
+SimdPath bestSimdPath()
+{
+    // Job workers can ask at the same time on the first tick; C++11 runs this initializer exactly once
+    static const SimdPath best = detectSimdPath();
+    return best;
+}
+
+bool simdPathSupported(SimdPath path)
+{
+    return path >= SIMD_SCALAR && path <= bestSimdPath();
+}
+
+const char *simdPathName(SimdPath path)
+{
+    if (path == SIMD_SSE2) { return "sse2"; }
+    if (path == SIMD_AVX2) { return "avx2"; }
+    return "scalar";
+}
+
+// Runs one path, falling back to scalar for anything this build or CPU can't run
+template <bool uniform>
+static void integrate(int *posX, int *posY, const int *velX, const int *velY, int vx, int vy, int count,
+                      const CollisionBox &bounds, unsigned char *kill, SimdPath path)
+{
+    if (!simdPathSupported(path)) { path = SIMD_SCALAR; }
+#ifdef KERNEL_X86
+    if (path == SIMD_AVX2) {
+        integrateAVX2<uniform>(posX, posY, velX, velY, vx, vy, count, bounds, kill);
+        return;
+    } else if (path == SIMD_SSE2) {
+        integrateSSE2<uniform>(posX, posY, velX, velY, vx, vy, count, bounds, kill);
+        return;
+    }
+#endif
+    integrateScalar<uniform>(posX, posY, velX, velY, vx, vy, 0, count, bounds, kill);
+}
+
+void integrateProjectiles(int *posX, int *posY, const int *velX, const int *velY, int count,
+                          const CollisionBox &bounds, unsigned char *kill, SimdPath path)
+{
+    integrate<false>(posX, posY, velX, velY, 0, 0, count, bounds, kill, path);
+}
+
+void integrateProjectiles(int *posX, int *posY, int velX, int velY, int count,
+                          const CollisionBox &bounds, unsigned char *kill, SimdPath path)
+{
+    integrate<true>(posX, posY, NULL, NULL, velX, velY, count, bounds, kill, path);
+}
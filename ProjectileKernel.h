@@ -0,0 +1,33 @@
+#ifndef PROJECTILE_KERNEL_H
+#define PROJECTILE_KERNEL_H
+
+#include "Collision.h"
+
+// Instruction sets the projectile kernel can run on
+enum SimdPath
+{
+    SIMD_SCALAR,
+    SIMD_SSE2,
+    SIMD_AVX2,
+    SIMD_PATH_COUNT
+};
+
+// Gets the fastest path this CPU supports (checked once)
+SimdPath bestSimdPath();
+
+// True if this build and CPU can run path
+bool simdPathSupported(SimdPath path);
+
+// Gets a path's name for logs and benchmarks
+const char *simdPathName(SimdPath path);
+
+// Moves count projectiles by their own velocity in one pass
+// kill[i] is set to 1 if projectile i ended up outside bounds, 0 otherwise
+void integrateProjectiles(int *posX, int *posY, const int *velX, const int *velY, int count,
+                          const CollisionBox &bounds, unsigned char *kill, SimdPath path = bestSimdPath());
+
+// Same, with every projectile moving by (velX, velY)
+void integrateProjectiles(int *posX, int *posY, int velX, int velY, int count,
+                          const CollisionBox &bounds, unsigned char *kill, SimdPath path = bestSimdPath());
+
+#endif
@@ -0,0 +1,97 @@
+#include "ProjectileKernel.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+// Extra elements past count in every array, which no path may touch
+const int GUARD = 8;
+const int GUARD_VALUE = 0x5A5A5A5A;
+
+// Uniform velocities to try, including none and ones that jump far past the bounds
+const int UNIFORM_VELOCITIES[][2] = {{0, 0}, {5, -12}, {-3, 7}, {0, -640}, {1000, 1000}};
+const int UNIFORM_VELOCITY_COUNT = sizeof(UNIFORM_VELOCITIES)/sizeof(UNIFORM_VELOCITIES[0]);
+
+struct KernelCase
+{
+    std::vector<int> posX;
+    std::vector<int> posY;
+    std::vector<int> velX;
+    std::vector<int> velY;
+    std::vector<unsigned char> kill;
+};
+
+// Positions within 50 pixels of bounds on every side, so both kill outcomes and the exact edges show up
+void fillCase(KernelCase &test, int count, const CollisionBox &bounds)
+{
+    test.posX.assign(count+GUARD, GUARD_VALUE);
+    test.posY.assign(count+GUARD, GUARD_VALUE);
+    test.velX.assign(count+GUARD, GUARD_VALUE);
+    test.velY.assign(count+GUARD, GUARD_VALUE);
+    test.kill.assign(count+GUARD, 0xA5);
+    for (int i = 0; i < count; i++) {
+        test.posX[i] = bounds.x-50+rand() % (bounds.w+100);
+        test.posY[i] = bounds.y-50+rand() % (bounds.h+100);
+        test.velX[i] = rand() % 81-40;
+        test.velY[i] = rand() % 81-40;
+    }
+}
+
+void runCase(KernelCase &test, int count, const CollisionBox &bounds, int uniform, SimdPath path)
+{
+    if (uniform < 0) {
+        integrateProjectiles(&test.posX[0], &test.posY[0], &test.velX[0], &test.velY[0], count, bounds, &test.kill[0], path);
+    } else {
+        integrateProjectiles(&test.posX[0], &test.posY[0], UNIFORM_VELOCITIES[uniform][0], UNIFORM_VELOCITIES[uniform][1],
+                             count, bounds, &test.kill[0], path);
+    }
+}
+
+// Checks every SIMD path this CPU supports against the scalar one, over every tail length and both velocity forms
+// Exits with 1 on any mismatch
+int main()
+{
+    srand(1);
+    const CollisionBox bounds = {10, 20, 300, 400};
+
+    // 0 to 70 covers every remainder after 4 and 8 lanes a few times over, 1027 a long run
+    std::vector<int> counts;
+    for (int count = 0; count <= 70; count++) {
+        counts.push_back(count);
+    }
+    counts.push_back(1027);
+
+    int cases = 0;
+    int failures = 0;
+    for (size_t c = 0; c < counts.size(); c++) {
+        int count = counts[c];
+        for (int uniform = -1; uniform < UNIFORM_VELOCITY_COUNT; uniform++) {
+            KernelCase input;
+            fillCase(input, count, bounds);
+            KernelCase expected = input;
+            runCase(expected, count, bounds, uniform, SIMD_SCALAR);
+
+            for (int p = SIMD_SCALAR+1; p < SIMD_PATH_COUNT; p++) {
+                SimdPath path = (SimdPath)p;
+                if (!simdPathSupported(path)) { continue; }
+
+                KernelCase actual = input;
+                runCase(actual, count, bounds, uniform, path);
+                cases++;
+                if (actual.posX != expected.posX || actual.posY != expected.posY || actual.kill != expected.kill) {
+                    printf("Error: %s kernel doesn't match scalar (%d projectiles, %s velocity)\n",
+                           simdPathName(path), count, uniform < 0 ? "per-shot" : "uniform");
+                    failures++;
+                }
+            }
+        }
+    }
+
+    printf("Projectile kernel: %d cases against scalar, %d mismatched (best path %s", cases, failures, simdPathName(bestSimdPath()));
+    for (int p = SIMD_SCALAR+1; p < SIMD_PATH_COUNT; p++) {
+        if (!simdPathSupported((SimdPath)p))
+            printf(", %s not supported here", simdPathName((SimdPath)p));
+    }
+    printf(")\n");
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,223 @@
+#include "Projectiles.h"
+#include "ProjectileKernel.h"
+
+ProjectilePool::ProjectilePool(int capacity)
+{
+    // Storage never grows after this
+    posX.resize(capacity);
+    posY.resize(capacity);
+    lastX.resize(capacity);
+    lastY.resize(capacity);
+    mSlotOf.resize(capacity);
+    mIndexOf.resize(capacity);
+    mGeneration.resize(capacity, 0);
+    mKill.resize(capacity);
+    mCount = 0;
+
+    // Every slot starts out free
+    for (int i = 0; i < capacity; i++) {
+        mSlotOf[i] = i;
+        mIndexOf[i] = i;
+    }
+}
+
+ProjectileHandle ProjectilePool::spawn(int x, int y)
+{
+    if (mCount == capacity()) { return NULL_PROJECTILE; }
+
+    // Takes the first free slot (always parked right after the live ones)
+    int slot = mSlotOf[mCount];
+    mIndexOf[slot] = mCount;
+    posX[mCount] = x;
+    posY[mCount] = y;
+    lastX[mCount] = x;
+    lastY[mCount] = y;
+    mCount++;
+
+    ProjectileHandle handle = {slot, mGeneration[slot]};
+    return handle;
+}
+
+void ProjectilePool::removeAt(int i)
+{
+    if (i < 0 || i >= mCount) { return; }
+
+    int slot = mSlotOf[i];
+    int last = mCount-1;
+
+    // Fills the hole with the last projectile
+    posX[i] = posX[last];
+    posY[i] = posY[last];
+    lastX[i] = lastX[last];
+    lastY[i] = lastY[last];
+    mSlotOf[i] = mSlotOf[last];
+    mIndexOf[mSlotOf[i]] = i;
+
+    // Parks the freed slot in the free region and invalidates its handles
+    mSlotOf[last] = slot;
+    mIndexOf[slot] = last;
+    mGeneration[slot]++;
+    mCount--;
+}
+
+bool ProjectilePool::remove(ProjectileHandle handle)
+{
+    int i = indexOf(handle);
+    if (i < 0) { return false; }
+    removeAt(i);
+    return true;
+}
+
+void ProjectilePool::clear()
+{
+    for (int i = 0; i < mCount; i++) {
+        mGeneration[mSlotOf[i]]++;
+    }
+    mCount = 0;
+}
+
+void ProjectilePool::storePositions()
+{
+    for (int i = 0; i < mCount; i++) {
+        lastX[i] = posX[i];
+        lastY[i] = posY[i];
+    }
+}
+
+void ProjectilePool::update(int velX, int velY, const CollisionBox &bounds)
+{
+    integrateRange(velX, velY, bounds, 0, mCount);
+    removeKilled();
+}
+
+void ProjectilePool::integrateRange(int velX, int velY, const CollisionBox &bounds, int begin, int end)
+{
+    if (begin >= end) { return; }
+    integrateProjectiles(&posX[begin], &posY[begin], velX, velY, end-begin, bounds, &mKill[begin]);
+}
+
+void ProjectilePool::removeKilled()
+{
+    // Back to front, so removal only ever moves in a projectile that was already kept
+    for (int i = mCount-1; i >= 0; i--) {
+        if (mKill[i]) { removeAt(i); }
+    }
+}
+
+bool ProjectilePool::isAlive(ProjectileHandle handle) { return indexOf(handle) >= 0; }
+
+int ProjectilePool::indexOf(ProjectileHandle handle)
+{
+    if (handle.slot < 0 || handle.slot >= capacity()) { return -1; }
+    if (mGeneration[handle.slot] != handle.generation) { return -1; }
+    if (mIndexOf[handle.slot] >= mCount) { return -1; }
+    return mIndexOf[handle.slot];
+}
+
+ProjectileHandle ProjectilePool::handleAt(int i)
+{
+    if (i < 0 || i >= mCount) { return NULL_PROJECTILE; }
+    ProjectileHandle handle = {mSlotOf[i], mGeneration[mSlotOf[i]]};
+    return handle;
+}
+
+int ProjectilePool::size() { return mCount; }
+
+int ProjectilePool::capacity() { return (int)mSlotOf.size(); }
+
+EnemyShotPool::EnemyShotPool(int capacity)
+{
+    // Storage never grows after this
+    posX.resize(capacity);
+    posY.resize(capacity);
+    velX.resize(capacity);
+    velY.resize(capacity);
+    damage.resize(capacity);
+    owner.resize(capacity);
+    lastX.resize(capacity);
+    lastY.resize(capacity);
+    mKill.resize(capacity);
+    mCount = 0;
+}
+
+bool EnemyShotPool::spawn(int x, int y, int vx, int vy, int d, unsigned int o)
+{
+    if (mCount == capacity()) { return false; }
+
+    posX[mCount] = x;
+    posY[mCount] = y;
+    velX[mCount] = vx;
+    velY[mCount] = vy;
+    damage[mCount] = d;
+    owner[mCount] = o;
+    lastX[mCount] = x;
+    lastY[mCount] = y;
+    mCount++;
+    return true;
+}
+
+void EnemyShotPool::removeAt(int i)
+{
+    if (i < 0 || i >= mCount) { return; }
+
+    // Fills the hole with the last shot
+    int last = mCount-1;
+    posX[i] = posX[last];
+    posY[i] = posY[last];
+    velX[i] = velX[last];
+    velY[i] = velY[last];
+    damage[i] = damage[last];
+    owner[i] = owner[last];
+    lastX[i] = lastX[last];
+    lastY[i] = lastY[last];
+    mCount--;
+}
+
+void EnemyShotPool::clear() { mCount = 0; }
+
+void EnemyShotPool::storePositions()
+{
+    for (int i = 0; i < mCount; i++) {
+        lastX[i] = posX[i];
+        lastY[i] = posY[i];
+    }
+}
+
+void EnemyShotPool::update(const CollisionBox &bounds)
+{
+    integrateRange(bounds, 0, mCount);
+    removeKilled();
+}
+
+void EnemyShotPool::integrateRange(const CollisionBox &bounds, int begin, int end)
+{
+    if (begin >= end) { return; }
+    integrateProjectiles(&posX[begin], &posY[begin], &velX[begin], &velY[begin], end-begin, bounds, &mKill[begin]);
+}
+
+void EnemyShotPool::removeKilled()
+{
+    // Back to front, so removal only ever moves in a shot that was already kept
+    for (int i = mCount-1; i >= 0; i--) {
+        if (mKill[i]) { removeAt(i); }
+    }
+}
+
+int EnemyShotPool::hit(const CollisionBox &box, std::vector<unsigned int> &hitOwners, HitTest hitTest, void *context)
+{
+    int dealt = 0;
+    for (int i = 0; i < mCount; ) {
+        if (boxContains(box, posX[i], posY[i]) && (!hitTest || hitTest(context, 0, i))) {
+            dealt+=damage[i];
+            hitOwners.push_back(owner[i]);
+            removeAt(i);
+        } else {
+            i++;
+        }
+    }
+    return dealt;
+}
+
+int EnemyShotPool::size() { return mCount; }
+
+int EnemyShotPool::capacity() { return (int)posX.size(); }
@@ -0,0 +1,145 @@
+#ifndef PROJECTILES_H
+#define PROJECTILES_H
+
+#include <vector>
+
+#include "Collision.h"
+
+// Max number of live player projectiles
+const int MAX_PROJECTILES = 1024;
+
+// Max number of live enemy shots
+const int MAX_ENEMY_SHOTS = 8192;
+
+// Refers to one projectile; stays valid until that projectile is removed
+struct ProjectileHandle
+{
+    int slot;
+    unsigned int generation;
+};
+
+// Handle that never refers to a live projectile
+const ProjectileHandle NULL_PROJECTILE = {-1, 0};
+
+// Fixed-capacity pool of projectiles
+// Positions are stored as packed arrays (index 0 to size()-1), removal swaps
+// the last projectile into the hole so the arrays never have gaps
+class ProjectilePool
+{
+    public:
+        // Allocates all storage up front
+        ProjectilePool(int capacity = MAX_PROJECTILES);
+
+        // Adds a projectile in O(1), returns NULL_PROJECTILE if the pool is full
+        ProjectileHandle spawn(int x, int y);
+
+        // Removes projectile at packed index i (moves the last one into i)
+        void removeAt(int i);
+
+        // Removes projectile by handle, returns false if it was already gone
+        bool remove(ProjectileHandle handle);
+
+        // Removes every projectile (all outstanding handles become stale)
+        void clear();
+
+        // Copies positions into lastX/lastY (call before each simulation tick)
+        void storePositions();
+
+        // Moves every projectile by (velX, velY), then removes the ones outside bounds
+        void update(int velX, int velY, const CollisionBox &bounds);
+
+        // update() in two steps so the first can be split across threads
+        // integrateRange() moves projectiles begin to end-1 and flags the ones outside bounds
+        // (ranges can run at once), then removeKilled() removes every flagged projectile
+        void integrateRange(int velX, int velY, const CollisionBox &bounds, int begin, int end);
+        void removeKilled();
+
+        // Handle lookups
+        bool isAlive(ProjectileHandle handle);
+        int indexOf(ProjectileHandle handle);
+        ProjectileHandle handleAt(int i);
+
+        // Gets live count and capacity
+        int size();
+        int capacity();
+
+        // Packed positions, valid from 0 to size()-1
+        std::vector<int> posX;
+        std::vector<int> posY;
+
+        // Packed positions as of the previous tick (for render interpolation)
+        std::vector<int> lastX;
+        std::vector<int> lastY;
+
+    private:
+        int mCount;
+
+        // Packed index -> slot; entries past mCount are the free slots
+        std::vector<int> mSlotOf;
+
+        // Slot -> packed index
+        std::vector<int> mIndexOf;
+
+        // Slot -> bumped each time the slot is freed
+        std::vector<unsigned int> mGeneration;
+
+        // Per-projectile flags written by update()
+        std::vector<unsigned char> mKill;
+};
+
+// Fixed-capacity pool of enemy shots, packed the same way as ProjectilePool
+// Shots are fire-and-forget, so there are no handles
+class EnemyShotPool
+{
+    public:
+        // Allocates all storage up front
+        EnemyShotPool(int capacity = MAX_ENEMY_SHOTS);
+
+        // Adds a shot moving (velX, velY) pixels per tick, returns false if the pool is full
+        bool spawn(int x, int y, int velX, int velY, int damage, unsigned int owner);
+
+        // Removes shot at packed index i (moves the last one into i)
+        void removeAt(int i);
+
+        // Removes every shot
+        void clear();
+
+        // Copies positions into lastX/lastY (call before each simulation tick)
+        void storePositions();
+
+        // Moves every shot by its velocity, then drops the ones outside bounds
+        void update(const CollisionBox &bounds);
+
+        // update() in two steps, split the same way as ProjectilePool's
+        void integrateRange(const CollisionBox &bounds, int begin, int end);
+        void removeKilled();
+
+        // Removes every shot inside box, returns their total damage
+        // The owner of each removed shot is appended to hitOwners
+        // A hitTest (if given) is asked about each shot inside box (as box 0), and only shots it passes count
+        int hit(const CollisionBox &box, std::vector<unsigned int> &hitOwners, HitTest hitTest = NULL, void *context = NULL);
+
+        // Gets live count and capacity
+        int size();
+        int capacity();
+
+        // Packed shot state, valid from 0 to size()-1
+        std::vector<int> posX;
+        std::vector<int> posY;
+        std::vector<int> velX;
+        std::vector<int> velY;
+        std::vector<int> damage;
+        std::vector<unsigned int> owner;
+
+        // Packed positions as of the previous tick (for render interpolation)
+        std::vector<int> lastX;
+        std::vector<int> lastY;
+
+    private:
+        int mCount;
+
+        // Per-shot flags written by update()
+        std::vector<unsigned char> mKill;
+};
+
+#endif
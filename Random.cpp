@@ -0,0 +1,30 @@
+#include "Random.h"
+
+Random::Random(unsigned int seed) { this->seed(seed); }
+
+void Random::seed(unsigned int seed)
+{
+    mSeed = seed;
+    mState = 0;
+    next();
+    mState+=seed;
+    next();
+}
+
+unsigned int Random::next()
+{
+    // PCG-XSH-RR: 64-bit LCG step, output is a rotated xorshift of the old state
+    unsigned long long old = mState;
+    mState = old*6364136223846793005ULL+1442695040888963407ULL;
+    unsigned int xorshifted = (unsigned int)(((old >> 18) ^ old) >> 27);
+    unsigned int rotation = (unsigned int)(old >> 59);
+    return (xorshifted >> rotation) | (xorshifted << ((32-rotation) & 31));
+}
+
+int Random::below(int bound)
+{
+    if (bound <= 0) { return 0; }
+    return (int)(next() % (unsigned int)bound);
+}
+
+unsigned int Random::getSeed() { return mSeed; }
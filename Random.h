@@ -0,0 +1,28 @@
+#ifndef RANDOM_H
+#define RANDOM_H
+
+// Small seeded generator (PCG32) so a session's randomness can be replayed
+// Every copy with the same seed gives the same sequence on every platform
+class Random
+{
+    public:
+        Random(unsigned int seed = 1);
+
+        // Restarts the sequence from seed
+        void seed(unsigned int seed);
+
+        // Gets the next 32 random bits
+        unsigned int next();
+
+        // Gets a number from 0 to bound-1 (use like rand() % bound)
+        int below(int bound);
+
+        // Gets the seed the sequence started from
+        unsigned int getSeed();
+
+    private:
+        unsigned long long mState;
+        unsigned int mSeed;
+};
+
+#endif
@@ -0,0 +1,242 @@
+#include "Replay.h"
+
+#include <string.h>
+
+// File starts with these, then the version byte and the seed
+const char REPLAY_MAGIC[4] = {'S', 'C', 'R', 'P'};
+const size_t REPLAY_HEADER_SIZE = 13;
+
+unsigned int packTickInput(const TickInput &input)
+{
+    unsigned int bits = 0;
+    bits |= input.up << 0;
+    bits |= input.down << 1;
+    bits |= input.left << 2;
+    bits |= input.right << 3;
+    bits |= input.fire << 4;
+    bits |= input.start << 5;
+    bits |= input.volumeUp << 6;
+    bits |= input.volumeDown << 7;
+    bits |= input.quit << 8;
+
+    // Axes are -1, 0 or 1, stored as 0 to 2
+    int xDir = input.xDir < 0 ? 0 : (input.xDir > 0 ? 2 : 1);
+    int yDir = input.yDir < 0 ? 0 : (input.yDir > 0 ? 2 : 1);
+    bits |= xDir << 9;
+    bits |= yDir << 11;
+    return bits;
+}
+
+TickInput unpackTickInput(unsigned int bits)
+{
+    TickInput input;
+    input.up = (bits >> 0) & 1;
+    input.down = (bits >> 1) & 1;
+    input.left = (bits >> 2) & 1;
+    input.right = (bits >> 3) & 1;
+    input.fire = (bits >> 4) & 1;
+    input.start = (bits >> 5) & 1;
+    input.volumeUp = (bits >> 6) & 1;
+    input.volumeDown = (bits >> 7) & 1;
+    input.quit = (bits >> 8) & 1;
+    input.xDir = (int)((bits >> 9) & 3)-1;
+    input.yDir = (int)((bits >> 11) & 3)-1;
+    return input;
+}
+
+ReplayRecorder::ReplayRecorder()
+{
+    mFile = NULL;
+    mPrevious = 0;
+    mHeld = 0;
+    mHeldTicks = 0;
+    mTickCount = 0;
+}
+
+ReplayRecorder::~ReplayRecorder() { close(); }
+
+bool ReplayRecorder::open(const char *path, unsigned int seed, unsigned int wavesHash)
+{
+    close();
+
+    mFile = fopen(path, "wb");
+    if (!mFile) {
+        printf("Unable to write replay %s.\n", path);
+        return false;
+    }
+
+    unsigned char header[REPLAY_HEADER_SIZE];
+    memcpy(header, REPLAY_MAGIC, 4);
+    header[4] = (unsigned char)REPLAY_VERSION;
+    for (int b = 0; b < 4; b++) {
+        header[5+b] = (unsigned char)(seed >> (b*8));
+        header[9+b] = (unsigned char)(wavesHash >> (b*8));
+    }
+    fwrite(header, 1, sizeof(header), mFile);
+
+    mPrevious = 0;
+    mHeld = 0;
+    mHeldTicks = 0;
+    mTickCount = 0;
+    return true;
+}
+
+void ReplayRecorder::record(const TickInput &input)
+{
+    if (!mFile) { return; }
+
+    unsigned int bits = packTickInput(input);
+    if (mHeldTicks > 0 && bits != mHeld) {
+        writeEntry();
+    }
+    mHeld = bits;
+    mHeldTicks++;
+    mTickCount++;
+}
+
+void ReplayRecorder::writeEntry()
+{
+    unsigned char entry[7];
+    unsigned int flipped = mHeld ^ mPrevious;
+    entry[0] = (unsigned char)flipped;
+    entry[1] = (unsigned char)(flipped >> 8);
+
+    // Tick count as a varint: 7 bits per byte, high bit set on all but the last
+    int size = 2;
+    unsigned int ticks = mHeldTicks;
+    while (ticks >= 0x80) {
+        entry[size++] = (unsigned char)(ticks | 0x80);
+        ticks >>= 7;
+    }
+    entry[size++] = (unsigned char)ticks;
+    fwrite(entry, 1, size, mFile);
+
+    mPrevious = mHeld;
+    mHeldTicks = 0;
+}
+
+bool ReplayRecorder::close()
+{
+    if (!mFile) { return true; }
+
+    if (mHeldTicks > 0) {
+        writeEntry();
+    }
+    bool success = ferror(mFile) == 0;
+    if (fclose(mFile) != 0) {
+        success = false;
+    }
+    mFile = NULL;
+    return success;
+}
+
+bool ReplayRecorder::isOpen() { return mFile != NULL; }
+
+unsigned int ReplayRecorder::getTickCount() { return mTickCount; }
+
+ReplayPlayer::ReplayPlayer()
+{
+    mOffset = 0;
+    mLoaded = false;
+    mSeed = 0;
+    mWavesHash = 0;
+    mHeld = 0;
+    mHeldTicks = 0;
+    mTickCount = 0;
+    mTicksPlayed = 0;
+}
+
+bool ReplayPlayer::load(const char *path)
+{
+    mLoaded = false;
+    mData.clear();
+
+    FILE *file = fopen(path, "rb");
+    if (!file) {
+        printf("Unable to open replay %s.\n", path);
+        return false;
+    }
+    unsigned char buffer[4096];
+    size_t read;
+    while ((read = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+        mData.insert(mData.end(), buffer, buffer+read);
+    }
+    fclose(file);
+
+    if (mData.size() < REPLAY_HEADER_SIZE || memcmp(&mData[0], REPLAY_MAGIC, 4) != 0) {
+        printf("%s is not a replay file.\n", path);
+        return false;
+    }
+    if (mData[4] != REPLAY_VERSION) {
+        printf("Replay %s is version %d, expected %u.\n", path, mData[4], REPLAY_VERSION);
+        return false;
+    }
+    mSeed = 0;
+    mWavesHash = 0;
+    for (int b = 0; b < 4; b++) {
+        mSeed |= (unsigned int)mData[5+b] << (b*8);
+        mWavesHash |= (unsigned int)mData[9+b] << (b*8);
+    }
+
+    // Walks every entry once so a truncated file is caught before playback
+    mTickCount = 0;
+    size_t offset = REPLAY_HEADER_SIZE;
+    unsigned int flipped, ticks;
+    while (offset < mData.size()) {
+        if (!readEntry(offset, flipped, ticks)) {
+            printf("Replay %s is cut short.\n", path);
+            return false;
+        }
+        mTickCount+=ticks;
+    }
+
+    mOffset = REPLAY_HEADER_SIZE;
+    mHeld = 0;
+    mHeldTicks = 0;
+    mTicksPlayed = 0;
+    mLoaded = true;
+    return true;
+}
+
+bool ReplayPlayer::readEntry(size_t &offset, unsigned int &flipped, unsigned int &ticks)
+{
+    if (offset+3 > mData.size()) { return false; }
+    flipped = mData[offset] | (mData[offset+1] << 8);
+    offset+=2;
+
+    ticks = 0;
+    for (int shift = 0; shift < 32; shift+=7) {
+        if (offset >= mData.size()) { return false; }
+        unsigned char byte = mData[offset++];
+        ticks |= (unsigned int)(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) { return true; }
+    }
+    return false;
+}
+
+bool ReplayPlayer::next(TickInput &input)
+{
+    if (!mLoaded) { return false; }
+
+    // Steps to the next change once the current input has been held long enough
+    while (mHeldTicks == 0) {
+        unsigned int flipped;
+        if (mOffset >= mData.size() || !readEntry(mOffset, flipped, mHeldTicks)) { return false; }
+        mHeld^=flipped;
+    }
+
+    mHeldTicks--;
+    mTicksPlayed++;
+    input = unpackTickInput(mHeld);
+    return true;
+}
+
+bool ReplayPlayer::isLoaded() { return mLoaded; }
+
+unsigned int ReplayPlayer::getSeed() { return mSeed; }
+
+unsigned int ReplayPlayer::getWavesHash() { return mWavesHash; }
+
+unsigned int ReplayPlayer::getTickCount() { return mTickCount; }
+
+unsigned int ReplayPlayer::getTicksPlayed() { return mTicksPlayed; }
@@ -0,0 +1,105 @@
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include <stdio.h>
+#include <vector>
+
+// Everything one simulation tick reads from the player
+struct TickInput
+{
+    bool up;
+    bool down;
+    bool left;
+    bool right;
+    bool fire;
+    bool start;
+    bool volumeUp;
+    bool volumeDown;
+    bool quit;
+    int xDir;
+    int yDir;
+};
+
+// Replay file version, bumped whenever the format or the simulation changes
+const unsigned int REPLAY_VERSION = 3;
+
+// Packs one tick of input into 13 bits (9 keys/buttons, 2 bits per stick axis) and back
+unsigned int packTickInput(const TickInput &input);
+TickInput unpackTickInput(unsigned int bits);
+
+// Streams per-tick input to a replay file
+// Layout: "SCRP", version (1 byte), session seed and wave script hash (4 bytes each, little endian), then one
+// entry per input change: the bits that flipped (2 bytes) and how many ticks the
+// new input was held (varint). Held keys cost nothing until something changes
+class ReplayRecorder
+{
+    public:
+        ReplayRecorder();
+        ~ReplayRecorder();
+
+        // Starts a new file for a session seeded with seed and playing the waves with wavesHash
+        // (WaveScript::getHash()), returns false if it can't be written
+        bool open(const char *path, unsigned int seed, unsigned int wavesHash);
+
+        // Adds one tick of input
+        void record(const TickInput &input);
+
+        // Writes the last entry and closes the file, returns false if any write failed
+        bool close();
+
+        bool isOpen();
+
+        // Gets how many ticks have been recorded
+        unsigned int getTickCount();
+
+    private:
+        // Writes the entry for the input held right now
+        void writeEntry();
+
+        FILE *mFile;
+        unsigned int mPrevious;
+        unsigned int mHeld;
+        unsigned int mHeldTicks;
+        unsigned int mTickCount;
+};
+
+// Plays a replay file back one tick at a time
+class ReplayPlayer
+{
+    public:
+        ReplayPlayer();
+
+        // Reads and checks the whole file, returns false if it can't be read or is malformed
+        bool load(const char *path);
+
+        // Gets the next tick's input, returns false once every recorded tick has been played
+        bool next(TickInput &input);
+
+        bool isLoaded();
+
+        // Gets the seed the recorded session used
+        unsigned int getSeed();
+
+        // Gets the hash of the wave script the recorded session played
+        unsigned int getWavesHash();
+
+        // Gets how many ticks the replay holds and how many have been played
+        unsigned int getTickCount();
+        unsigned int getTicksPlayed();
+
+    private:
+        // Reads the entry at offset and steps past it, returns false if the data ends first
+        bool readEntry(size_t &offset, unsigned int &flipped, unsigned int &ticks);
+
+        std::vector<unsigned char> mData;
+        size_t mOffset;
+        bool mLoaded;
+        unsigned int mSeed;
+        unsigned int mWavesHash;
+        unsigned int mHeld;
+        unsigned int mHeldTicks;
+        unsigned int mTickCount;
+        unsigned int mTicksPlayed;
+};
+
+#endif
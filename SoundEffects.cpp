@@ -0,0 +1,241 @@
+#include "SoundEffects.h"
+
+#include <stdio.h>
+#include <vector>
+
+// How each effect plays, and the tone generated for it when its file is missing
+struct SoundInfo
+{
+    const char *name;
+    // Higher priorities can steal voices from lower ones
+    int priority;
+    Uint32 minGapMs;
+    int volume;
+    // Generated tone: pitch sweeps from startHz to endHz, noise holds random levels at that rate instead
+    int startHz;
+    int endHz;
+    int lengthMs;
+    bool noise;
+};
+
+const SoundInfo SOUND_INFO[SFX_COUNT] = {
+    {"shot",       1, 60,  40, 1400, 700,  50,  false},
+    {"hit",        2, 40,  56, 3000, 1500, 60,  true},
+    {"explosion",  3, 80,  80, 1200, 200,  350, true},
+    {"player_hit", 4, 100, 96, 220,  110,  160, false},
+    {"pickup",     5, 0,   96, 600,  1500, 220, false}
+};
+
+// Generated tones are 16-bit mono at this rate (the mixer converts them on load)
+const int SYNTH_RATE = 22050;
+
+void putLE(std::vector<Uint8> &data, Uint32 value, int bytes)
+{
+    for (int i = 0; i < bytes; i++) {
+        data.push_back((Uint8)(value >> (i*8)));
+    }
+}
+
+// Builds an effect's stand-in tone as an in-memory WAV and loads it like a file
+Mix_Chunk *synthesize(const SoundInfo &info)
+{
+    int samples = SYNTH_RATE*info.lengthMs/1000;
+
+    std::vector<Uint8> wav;
+    wav.reserve(44+samples*2);
+    wav.push_back('R'); wav.push_back('I'); wav.push_back('F'); wav.push_back('F');
+    putLE(wav, 36+samples*2, 4);
+    wav.push_back('W'); wav.push_back('A'); wav.push_back('V'); wav.push_back('E');
+    wav.push_back('f'); wav.push_back('m'); wav.push_back('t'); wav.push_back(' ');
+    putLE(wav, 16, 4);
+    putLE(wav, 1, 2);
+    putLE(wav, 1, 2);
+    putLE(wav, SYNTH_RATE, 4);
+    putLE(wav, SYNTH_RATE*2, 4);
+    putLE(wav, 2, 2);
+    putLE(wav, 16, 2);
+    wav.push_back('d'); wav.push_back('a'); wav.push_back('t'); wav.push_back('a');
+    putLE(wav, samples*2, 4);
+
+    // Square wave (or held noise) sweeping in pitch, fading out linearly
+    double phase = 0;
+    Uint32 noise = 1;
+    int level = 1;
+    for (int i = 0; i < samples; i++) {
+        double t = (double)i/samples;
+        phase += (info.startHz+(info.endHz-info.startHz)*t)/SYNTH_RATE;
+        if (phase >= 1) {
+            phase -= 1;
+            noise = noise*1664525u+1013904223u;
+            level = info.noise ? (noise >> 31 ? 1 : -1) : -level;
+        }
+        Sint16 sample = (Sint16)(level*(1-t)*8000);
+        putLE(wav, (Uint16)sample, 2);
+    }
+
+    return Mix_LoadWAV_RW(SDL_RWFromConstMem(&wav[0], (int)wav.size()), 1);
+}
+
+SoundEffects::SoundEffects()
+{
+    for (int i = 0; i < SFX_COUNT; i++) {
+        mChunks[i] = NULL;
+        mLastPlayed[i] = 0;
+        mHasPlayed[i] = false;
+    }
+    for (int v = 0; v < SFX_VOICES; v++) {
+        mVoices[v].owner = this;
+        mVoices[v].priority = 0;
+        mVoices[v].serial = 0;
+        mVoices[v].triggered = 0;
+        SDL_AtomicSet(&mVoices[v].waiting, 0);
+    }
+    mSerial = 0;
+    mBufferTicks = 0;
+    mLoaded = false;
+    mLatencyLock = 0;
+    takeStats();
+}
+
+SoundEffects::~SoundEffects() { free(); }
+
+bool SoundEffects::load(int bufferFrames)
+{
+    free();
+
+    int frequency;
+    Uint16 format;
+    int channels;
+    if (!Mix_QuerySpec(&frequency, &format, &channels)) {
+        printf("Sound effects need the mixer open. SDL_mixer Error: %s\n", Mix_GetError());
+        return false;
+    }
+    mBufferTicks = SDL_GetPerformanceFrequency()*bufferFrames/frequency;
+
+    if (Mix_AllocateChannels(SFX_VOICES) < SFX_VOICES) {
+        printf("Unable to allocate sound effect voices. SDL_mixer Error: %s\n", Mix_GetError());
+        return false;
+    }
+    mLoaded = true;
+
+    bool success = true;
+    for (int i = 0; i < SFX_COUNT; i++) {
+        char path[64];
+        snprintf(path, sizeof(path), "DS_Game/sfx_%s.wav", SOUND_INFO[i].name);
+        mChunks[i] = Mix_LoadWAV(path);
+        if (!mChunks[i])
+            mChunks[i] = synthesize(SOUND_INFO[i]);
+        if (!mChunks[i]) {
+            printf("Failed to load sound effect %s. SDL_mixer Error: %s\n", SOUND_INFO[i].name, Mix_GetError());
+            success = false;
+        } else {
+            Mix_VolumeChunk(mChunks[i], SOUND_INFO[i].volume);
+        }
+    }
+
+    return success;
+}
+
+void SoundEffects::free()
+{
+    // Voices still playing a chunk have to stop before it goes
+    if (mLoaded) {
+        for (int v = 0; v < SFX_VOICES; v++) {
+            Mix_HaltChannel(v);
+        }
+        mLoaded = false;
+    }
+    for (int i = 0; i < SFX_COUNT; i++) {
+        Mix_FreeChunk(mChunks[i]);
+        mChunks[i] = NULL;
+        mHasPlayed[i] = false;
+    }
+}
+
+bool SoundEffects::play(SoundEffect effect, Uint32 now)
+{
+    const SoundInfo &info = SOUND_INFO[effect];
+    if (!mChunks[effect]) { return false; }
+
+    if (mHasPlayed[effect] && now-mLastPlayed[effect] < info.minGapMs) {
+        SDL_AtomicAdd(&mLimited, 1);
+        return false;
+    }
+
+    // A free voice, or else the least important one (oldest first) that isn't more important than this
+    int voice = -1;
+    for (int v = 0; v < SFX_VOICES && voice < 0; v++) {
+        if (!Mix_Playing(v))
+            voice = v;
+    }
+    if (voice < 0) {
+        for (int v = 0; v < SFX_VOICES; v++) {
+            if (mVoices[v].priority > info.priority) { continue; }
+            if (voice < 0 || mVoices[v].priority < mVoices[voice].priority ||
+                (mVoices[v].priority == mVoices[voice].priority && mVoices[v].serial < mVoices[voice].serial))
+                voice = v;
+        }
+        if (voice < 0) {
+            SDL_AtomicAdd(&mDropped, 1);
+            return false;
+        }
+        SDL_AtomicAdd(&mStolen, 1);
+    }
+
+    // Halting also drops the voice's old latency callback, the new one goes on before it starts
+    Voice &slot = mVoices[voice];
+    Mix_HaltChannel(voice);
+    slot.priority = info.priority;
+    slot.serial = ++mSerial;
+    slot.triggered = SDL_GetPerformanceCounter();
+    SDL_AtomicSet(&slot.waiting, 1);
+    Mix_RegisterEffect(voice, measureLatency, NULL, &slot);
+    if (Mix_PlayChannel(voice, mChunks[effect], 0) < 0) {
+        SDL_AtomicSet(&slot.waiting, 0);
+        SDL_AtomicAdd(&mDropped, 1);
+        return false;
+    }
+
+    mLastPlayed[effect] = now;
+    mHasPlayed[effect] = true;
+    SDL_AtomicAdd(&mPlayed, 1);
+    return true;
+}
+
+SoundStats SoundEffects::takeStats()
+{
+    SoundStats stats;
+    stats.played = SDL_AtomicSet(&mPlayed, 0);
+    stats.stolen = SDL_AtomicSet(&mStolen, 0);
+    stats.limited = SDL_AtomicSet(&mLimited, 0);
+    stats.dropped = SDL_AtomicSet(&mDropped, 0);
+    SDL_AtomicLock(&mLatencyLock);
+    stats.measured = mMeasured;
+    Uint64 sum = mLatencySum;
+    mMeasured = 0;
+    mLatencySum = 0;
+    SDL_AtomicUnlock(&mLatencyLock);
+    int max = SDL_AtomicSet(&mLatencyMax, 0);
+    stats.averageLatencyMs = stats.measured > 0 ? sum/1000.0/stats.measured : 0;
+    stats.maxLatencyMs = max/1000.0;
+    return stats;
+}
+
+void SoundEffects::measureLatency(int channel, void *stream, int length, void *data)
+{
+    Voice &voice = *(Voice*)data;
+    if (!SDL_AtomicCAS(&voice.waiting, 1, 0)) { return; }
+
+    SoundEffects &owner = *voice.owner;
+    Uint64 ticks = SDL_GetPerformanceCounter()-voice.triggered+owner.mBufferTicks;
+    int us = (int)(ticks*1000000/SDL_GetPerformanceFrequency());
+    SDL_AtomicLock(&owner.mLatencyLock);
+    owner.mLatencySum+=us;
+    owner.mMeasured++;
+    SDL_AtomicUnlock(&owner.mLatencyLock);
+
+    int max = SDL_AtomicGet(&owner.mLatencyMax);
+    while (us > max && !SDL_AtomicCAS(&owner.mLatencyMax, max, us)) {
+        max = SDL_AtomicGet(&owner.mLatencyMax);
+    }
+}
@@ -0,0 +1,110 @@
+#ifndef SOUND_EFFECTS_H
+#define SOUND_EFFECTS_H
+
+#include <SDL.h>
+#include <SDL2/SDL_mixer.h>
+
+// Every sound effect (loaded from DS_Game/sfx_<name>.wav, or generated if that's missing)
+enum SoundEffect
+{
+    SFX_SHOT,
+    SFX_HIT,
+    SFX_EXPLOSION,
+    SFX_PLAYER_HIT,
+    SFX_PICKUP,
+    SFX_COUNT
+};
+
+// Mixer channels kept for sound effects (music streams separately)
+const int SFX_VOICES = 8;
+
+// Default audio buffer in sample frames, about 12 ms at 44.1 kHz (SDL_mixer's usual 2048 is 46 ms)
+const int DEFAULT_AUDIO_BUFFER = 512;
+
+// Counts since the last SoundEffects::takeStats()
+struct SoundStats
+{
+    int played;
+    // Played by cutting off a less important sound
+    int stolen;
+    // Skipped for retriggering too soon after the last one
+    int limited;
+    // Skipped because every voice was playing something more important
+    int dropped;
+    // Trigger to leaving the audio device, over the sounds measured
+    int measured;
+    double averageLatencyMs;
+    double maxLatencyMs;
+};
+
+// Plays preloaded chunks on a fixed pool of voices
+// When every voice is busy a sound takes over the one playing the least important sound
+// (the oldest of those), as long as that isn't more important than itself. Each sound also
+// has a shortest gap between triggers, so a tick full of hits still only plays one.
+// play() must only be called from one thread (the simulation's)
+class SoundEffects
+{
+    public:
+        // Initialization
+        SoundEffects();
+
+        // Deallocation
+        ~SoundEffects();
+
+        // Loads every effect and takes the voices (the mixer must be open with bufferFrames)
+        bool load(int bufferFrames);
+
+        // Stops the voices and frees the chunks
+        void free();
+
+        // Plays an effect at game time now (ms), returns false if it was limited or dropped
+        bool play(SoundEffect effect, Uint32 now);
+
+        // Gets the counts and latencies since the last call, and starts counting again
+        SoundStats takeStats();
+
+    private:
+        struct Voice
+        {
+            SoundEffects *owner;
+            int priority;
+            // Order voices started in, for stealing the oldest
+            Uint32 serial;
+            // When play() was called, measured on the first mix after it
+            Uint64 triggered;
+            SDL_atomic_t waiting;
+        };
+
+        // Mixer effect callback, runs on the audio thread when a voice's samples are mixed
+        static void measureLatency(int channel, void *stream, int length, void *data);
+
+        Mix_Chunk *mChunks[SFX_COUNT];
+        Voice mVoices[SFX_VOICES];
+        Uint32 mSerial;
+
+        // Game time each effect last played
+        Uint32 mLastPlayed[SFX_COUNT];
+        bool mHasPlayed[SFX_COUNT];
+
+        // Whether the voices are ours to halt
+        bool mLoaded;
+
+        // One buffer's time, added to each measurement (a mixed buffer plays after the one before it)
+        Uint64 mBufferTicks;
+
+        // Written by play() and the audio thread, read by takeStats()
+        SDL_atomic_t mPlayed;
+        SDL_atomic_t mStolen;
+        SDL_atomic_t mLimited;
+        SDL_atomic_t mDropped;
+        // Microseconds
+        SDL_atomic_t mLatencyMax;
+
+        // Guards the measurement count and latency sum, which are taken together
+        // The sum is 64-bit so a long session without --audio-stats taking it can't overflow
+        SDL_SpinLock mLatencyLock;
+        int mMeasured;
+        Uint64 mLatencySum;
+};
+
+#endif
@@ -0,0 +1,52 @@
+#ifndef TRIPLE_BUFFER_H
+#define TRIPLE_BUFFER_H
+
+#include <SDL.h>
+
+// Lock-free handoff of whole values from one writer thread to one reader thread
+// The writer fills back() and publishes it; the reader always gets the newest
+// published value from front(). Neither side ever waits, and a value is never
+// written while the reader holds it (the third buffer is the one in between)
+template <typename T>
+class TripleBuffer
+{
+    public:
+        TripleBuffer()
+        {
+            mBack = 0;
+            mFront = 1;
+            SDL_AtomicSet(&mMiddle, 2);
+        }
+
+        // Writer: buffer to fill next (may still hold an old value)
+        T &back() { return mBuffers[mBack]; }
+
+        // Writer: hands back() to the reader and takes the spare buffer as the new back()
+        void publish()
+        {
+            SDL_MemoryBarrierRelease();
+            mBack = SDL_AtomicSet(&mMiddle, mBack | FRESH) & INDEX;
+        }
+
+        // Reader: swaps in the newest published value if there is one, then returns it
+        const T &front()
+        {
+            if (SDL_AtomicGet(&mMiddle) & FRESH) {
+                mFront = SDL_AtomicSet(&mMiddle, mFront) & INDEX;
+                SDL_MemoryBarrierAcquire();
+            }
+            return mBuffers[mFront];
+        }
+
+    private:
+        // mMiddle holds the spare buffer's index, plus FRESH if the writer published it since the reader last looked
+        static const int INDEX = 3;
+        static const int FRESH = 4;
+
+        T mBuffers[3];
+        int mBack;
+        int mFront;
+        SDL_atomic_t mMiddle;
+};
+
+#endif
@@ -0,0 +1,238 @@
+#include "Waves.h"
+#include "Enemies.h"
+
+#include <algorithm>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+
+// Longest wave file line
+const int MAX_WAVE_LINE = 256;
+
+// Most enemies one spawn line can send in
+const int MAX_SPAWN_COUNT = 10000;
+
+// Sorts spawns earliest first (file order on ties)
+struct EarlierSpawn
+{
+    bool operator() (const WaveSpawn &a, const WaveSpawn &b) const { return a.time < b.time; }
+};
+
+// Returns the enemy type called name, or -1
+static int enemyTypeNamed(const char *name)
+{
+    if (strcmp(name, "raider") == 0) { return ENEMY_RAIDER; }
+    if (strcmp(name, "striker") == 0) { return ENEMY_STRIKER; }
+    if (strcmp(name, "thrasher") == 0) { return ENEMY_THRASHER; }
+    return -1;
+}
+
+// Returns the power-up called name, or POWERUP_TYPE_COUNT if there is none
+static int powerUpNamed(const char *name)
+{
+    if (strcmp(name, "speed") == 0) { return POWERUP_SPEED; }
+    if (strcmp(name, "damage") == 0) { return POWERUP_DAMAGE; }
+    if (strcmp(name, "none") == 0) { return POWERUP_NONE; }
+    return POWERUP_TYPE_COUNT;
+}
+
+WaveScript::WaveScript() {}
+
+bool WaveScript::loadFromFile(const char *path)
+{
+    FILE *file = fopen(path, "rb");
+    if (!file) {
+        printf("Unable to open wave file %s.\n", path);
+        return false;
+    }
+
+    std::string text;
+    char buffer[4096];
+    size_t read;
+    while ((read = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+        text.append(buffer, read);
+    }
+    fclose(file);
+
+    return parse(text.c_str(), path);
+}
+
+bool WaveScript::parse(const char *text, const char *name)
+{
+    std::vector<Wave> waves;
+    std::vector<WaveSpawn> spawns;
+
+    int lineNumber = 0;
+    const char *lineStart = text;
+    while (*lineStart) {
+        lineNumber++;
+        const char *lineEnd = strchr(lineStart, '\n');
+        if (!lineEnd) { lineEnd = lineStart+strlen(lineStart); }
+
+        // Copies the line without its comment
+        char line[MAX_WAVE_LINE];
+        size_t length = lineEnd-lineStart;
+        if (length >= sizeof(line)) {
+            printf("Bad wave file %s, line %d is too long.\n", name, lineNumber);
+            return false;
+        }
+        memcpy(line, lineStart, length);
+        line[length] = '\0';
+        char *comment = strchr(line, '#');
+        if (comment) { *comment = '\0'; }
+        lineStart = *lineEnd ? lineEnd+1 : lineEnd;
+
+        char command[32];
+        char what[32];
+        unsigned int time;
+        int count = 1;
+        unsigned int interval = 0;
+        int xPercent = 50;
+        if (sscanf(line, "%31s", command) != 1) {
+            // Blank line
+        } else if (strcmp(command, "wave") == 0) {
+            Wave wave = {0, POWERUP_NONE, (int)spawns.size(), 0};
+            if (sscanf(line, "%*s %u", &wave.bannerTime) != 1) {
+                printf("Bad wave file %s, line %d: expected wave <banner ms>.\n", name, lineNumber);
+                return false;
+            }
+            waves.push_back(wave);
+        } else if (waves.empty()) {
+            printf("Bad wave file %s, line %d: %s before the first wave.\n", name, lineNumber, command);
+            return false;
+        } else if (strcmp(command, "spawn") == 0) {
+            if (sscanf(line, "%*s %u %31s %d %u %d", &time, what, &count, &interval, &xPercent) < 2) {
+                printf("Bad wave file %s, line %d: expected spawn <ms> <enemy> [count [interval ms [x %%]]].\n", name, lineNumber);
+                return false;
+            }
+            int type = enemyTypeNamed(what);
+            if (type < 0 || count < 1 || count > MAX_SPAWN_COUNT || xPercent < 0 || xPercent > 100) {
+                printf("Bad wave file %s, line %d: bad enemy, count or position.\n", name, lineNumber);
+                return false;
+            }
+            for (int i = 0; i < count; i++) {
+                WaveSpawn spawn = {time+i*interval, type, xPercent};
+                spawns.push_back(spawn);
+            }
+            waves.back().spawnCount+=count;
+        } else if (strcmp(command, "drop") == 0) {
+            int drop = POWERUP_TYPE_COUNT;
+            if (sscanf(line, "%*s %31s", what) == 1) { drop = powerUpNamed(what); }
+            if (drop == POWERUP_TYPE_COUNT) {
+                printf("Bad wave file %s, line %d: expected drop speed, damage or none.\n", name, lineNumber);
+                return false;
+            }
+            waves.back().drop = drop;
+        } else {
+            printf("Bad wave file %s, line %d: unknown command %s.\n", name, lineNumber, command);
+            return false;
+        }
+    }
+
+    if (waves.empty()) {
+        printf("Bad wave file %s, it has no waves.\n", name);
+        return false;
+    }
+
+    // Each wave's timeline is walked in time order
+    for (size_t i = 0; i < waves.size(); i++) {
+        std::vector<WaveSpawn>::iterator first = spawns.begin()+waves[i].firstSpawn;
+        std::stable_sort(first, first+waves[i].spawnCount, EarlierSpawn());
+    }
+
+    mWaves.swap(waves);
+    mSpawns.swap(spawns);
+    return true;
+}
+
+int WaveScript::getWaveCount() { return (int)mWaves.size(); }
+const Wave &WaveScript::getWave(int i) { return mWaves[i]; }
+const WaveSpawn &WaveScript::getSpawn(int i) { return mSpawns[i]; }
+
+int WaveScript::getSpawnCount() { return (int)mSpawns.size(); }
+
+// Folds a value into a 32-bit FNV-1a hash a byte at a time (low byte first, so it's the same on any CPU)
+static unsigned int hashValue(unsigned int hash, unsigned int value)
+{
+    for (int b = 0; b < 4; b++) {
+        hash = (hash ^ ((value >> (b*8)) & 0xFF))*16777619u;
+    }
+    return hash;
+}
+
+unsigned int WaveScript::getHash()
+{
+    unsigned int hash = 2166136261u;
+    for (size_t w = 0; w < mWaves.size(); w++) {
+        hash = hashValue(hash, mWaves[w].bannerTime);
+        hash = hashValue(hash, (unsigned int)mWaves[w].drop);
+        hash = hashValue(hash, (unsigned int)mWaves[w].spawnCount);
+    }
+    for (size_t i = 0; i < mSpawns.size(); i++) {
+        hash = hashValue(hash, mSpawns[i].time);
+        hash = hashValue(hash, (unsigned int)mSpawns[i].type);
+        hash = hashValue(hash, (unsigned int)mSpawns[i].xPercent);
+    }
+    return hash;
+}
+
+WaveScheduler::WaveScheduler()
+{
+    mScript = NULL;
+    mWave = 0;
+    mWaveStart = 0;
+    mNextSpawn = 0;
+    mEndSpawn = 0;
+}
+
+void WaveScheduler::start(WaveScript *script, unsigned int now)
+{
+    mScript = script;
+    mWave = -1;
+    nextWave(now);
+}
+
+bool WaveScheduler::nextWave(unsigned int now)
+{
+    if (!mScript || finished()) { return false; }
+
+    mWave++;
+    mWaveStart = now;
+    if (finished()) {
+        mNextSpawn = mEndSpawn = 0;
+        return false;
+    }
+
+    const Wave &wave = mScript->getWave(mWave);
+    mNextSpawn = wave.firstSpawn;
+    mEndSpawn = wave.firstSpawn+wave.spawnCount;
+    return true;
+}
+
+void WaveScheduler::due(unsigned int now, std::vector<WaveSpawn> &spawns)
+{
+    while (mNextSpawn < mEndSpawn && mWaveStart+mScript->getSpawn(mNextSpawn).time <= now) {
+        spawns.push_back(mScript->getSpawn(mNextSpawn));
+        mNextSpawn++;
+    }
+}
+
+bool WaveScheduler::waveSpawned() { return mNextSpawn >= mEndSpawn; }
+
+bool WaveScheduler::showBanner(unsigned int now)
+{
+    if (!mScript || finished()) { return false; }
+    return now < mWaveStart+mScript->getWave(mWave).bannerTime;
+}
+
+bool WaveScheduler::finished() { return !mScript || mWave >= mScript->getWaveCount(); }
+
+int WaveScheduler::getWave() { return mWave; }
+
+int WaveScheduler::getDrop()
+{
+    if (finished()) { return POWERUP_NONE; }
+    return mScript->getWave(mWave).drop;
+}
+
+bool WaveScheduler::isLastWave() { return mScript && mWave == mScript->getWaveCount()-1; }
@@ -0,0 +1,106 @@
+#ifndef WAVES_H
+#define WAVES_H
+
+#include <vector>
+
+// Power-ups a wave can leave behind when cleared
+enum PowerUpType
+{
+    POWERUP_NONE = -1,
+    POWERUP_SPEED,
+    POWERUP_DAMAGE,
+    POWERUP_TYPE_COUNT
+};
+
+// One enemy entering the screen
+struct WaveSpawn
+{
+    // Milliseconds after the wave starts
+    unsigned int time;
+    int type;
+    // Where it enters, in percent of the screen width (50 is centered)
+    int xPercent;
+};
+
+// One wave: a banner, a timeline of spawns, then an optional power-up
+struct Wave
+{
+    unsigned int bannerTime;
+    int drop;
+    // Spawns are mSpawns[firstSpawn] to [firstSpawn+spawnCount-1], sorted by time
+    int firstSpawn;
+    int spawnCount;
+};
+
+// Parsed wave file (read once, shared by every game)
+//
+// One command per line, '#' starts a comment:
+//   wave <banner ms>                                    starts the next wave
+//   spawn <ms> <enemy> [count [interval ms [x %]]]     enemies to send in, ms after the wave starts
+//   drop <power-up>                                     dropped once the wave is cleared
+// Enemies are raider, striker or thrasher; power-ups are speed or damage
+class WaveScript
+{
+    public:
+        WaveScript();
+
+        // Reads a wave file, returns false (keeping the old waves) on a bad file
+        bool loadFromFile(const char *path);
+
+        // Parses wave commands from text, name is only used in error messages
+        bool parse(const char *text, const char *name);
+
+        // Gets waves and their spawns
+        int getWaveCount();
+        const Wave &getWave(int i);
+        const WaveSpawn &getSpawn(int i);
+        int getSpawnCount();
+
+        // Gets a hash of the parsed waves (comments and spacing don't change it), so a
+        // replay can tell it's being played with the script it was recorded with
+        unsigned int getHash();
+
+    private:
+        std::vector<Wave> mWaves;
+        std::vector<WaveSpawn> mSpawns;
+};
+
+// Walks a WaveScript in simulated time
+class WaveScheduler
+{
+    public:
+        WaveScheduler();
+
+        // Starts the first wave of script at time now
+        void start(WaveScript *script, unsigned int now);
+
+        // Appends every spawn that has come due by now (O(spawns due))
+        void due(unsigned int now, std::vector<WaveSpawn> &spawns);
+
+        // Moves on to the next wave, returns false after the last one
+        bool nextWave(unsigned int now);
+
+        // True once every spawn in the current wave has been handed out
+        bool waveSpawned();
+
+        // True while the current wave's banner should be shown
+        bool showBanner(unsigned int now);
+
+        // True once nextWave() has gone past the last wave
+        bool finished();
+
+        // Gets current wave (0 based), its power-up, and whether more waves follow
+        int getWave();
+        int getDrop();
+        bool isLastWave();
+
+    private:
+        WaveScript *mScript;
+        int mWave;
+        unsigned int mWaveStart;
+        // Next spawn (index into the script) to hand out, and the end of this wave's spawns
+        int mNextSpawn;
+        int mEndSpawn;
+};
+
+#endif